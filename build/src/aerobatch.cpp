@@ -0,0 +1,185 @@
+/*
+ * Implementation file for the batched aerodynamic surfaces.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <cyclone/aerobatch.h>
+
+using namespace cyclone;
+
+AeroBatch::AeroBatch(const Vector3 *windspeed)
+:
+windspeed(windspeed)
+{
+}
+
+unsigned AeroBatch::addBody(RigidBody *body)
+{
+    bodies.push_back(body);
+    return (unsigned)bodies.size() - 1;
+}
+
+unsigned AeroBatch::addSurface(unsigned body, const Matrix3 &tensor,
+                               const Vector3 &position)
+{
+    return addControlSurface(body, tensor, tensor, tensor, position);
+}
+
+unsigned AeroBatch::addControlSurface(unsigned body, const Matrix3 &base,
+                                      const Matrix3 &min, const Matrix3 &max,
+                                      const Vector3 &position)
+{
+    surfaceBodies.push_back(body);
+    for (unsigned c = 0; c < 9; c++)
+    {
+        baseTensors[c].push_back(base.data[c]);
+        minTensors[c].push_back(min.data[c]);
+        maxTensors[c].push_back(max.data[c]);
+    }
+    positions[0].push_back(position.x);
+    positions[1].push_back(position.y);
+    positions[2].push_back(position.z);
+    controls.push_back(0);
+    return (unsigned)surfaceBodies.size() - 1;
+}
+
+void AeroBatch::setControl(unsigned surface, real value)
+{
+    if (value < -1) value = -1;
+    else if (value > 1) value = 1;
+    controls[surface] = value;
+}
+
+real AeroBatch::getControl(unsigned surface) const
+{
+    return controls[surface];
+}
+
+unsigned AeroBatch::getBodyCount() const
+{
+    return (unsigned)bodies.size();
+}
+
+unsigned AeroBatch::getSurfaceCount() const
+{
+    return (unsigned)surfaceBodies.size();
+}
+
+void AeroBatch::clear()
+{
+    bodies.clear();
+    surfaceBodies.clear();
+    for (unsigned c = 0; c < 9; c++)
+    {
+        baseTensors[c].clear();
+        minTensors[c].clear();
+        maxTensors[c].clear();
+    }
+    for (unsigned c = 0; c < 3; c++) positions[c].clear();
+    controls.clear();
+}
+
+void AeroBatch::updateForces(real duration)
+{
+    unsigned surfaceCount = (unsigned)surfaceBodies.size();
+    unsigned bodyCount = (unsigned)bodies.size();
+    if (surfaceCount == 0) return;
+
+    // Blend each tensor towards the extreme its control points at.
+    // This is the same blend AeroControl makes, without the branches.
+    const real *control = &controls[0];
+    for (unsigned c = 0; c < 9; c++)
+    {
+        tensors[c].resize(surfaceCount);
+        const real *base = &baseTensors[c][0];
+        const real *min = &minTensors[c][0];
+        const real *max = &maxTensors[c][0];
+        real *tensor = &tensors[c][0];
+        for (unsigned i = 0; i < surfaceCount; i++)
+        {
+            real amount = control[i] < 0 ? -control[i] : control[i];
+            real extreme = control[i] < 0 ? min[i] : max[i];
+            tensor[i] = base[i] + (extreme - base[i]) * amount;
+        }
+    }
+
+    // Find the velocity of each body through the air, in body
+    // coordinates.
+    bodyVelocities.resize(bodyCount);
+    for (unsigned b = 0; b < bodyCount; b++)
+    {
+        Vector3 velocity = bodies[b]->getVelocity();
+        velocity += *windspeed;
+        bodyVelocities[b] =
+            bodies[b]->getTransform().transformInverseDirection(velocity);
+    }
+
+    // Give each surface the velocity of its body.
+    for (unsigned c = 0; c < 3; c++)
+    {
+        velocities[c].resize(surfaceCount);
+        forces[c].resize(surfaceCount);
+        torques[c].resize(surfaceCount);
+    }
+    for (unsigned i = 0; i < surfaceCount; i++)
+    {
+        const Vector3 &velocity = bodyVelocities[surfaceBodies[i]];
+        velocities[0][i] = velocity.x;
+        velocities[1][i] = velocity.y;
+        velocities[2][i] = velocity.z;
+    }
+
+    // Work out the force and torque of every surface in body
+    // coordinates.
+    {
+        const real *t[9];
+        for (unsigned c = 0; c < 9; c++) t[c] = &tensors[c][0];
+        const real *vx = &velocities[0][0];
+        const real *vy = &velocities[1][0];
+        const real *vz = &velocities[2][0];
+        const real *px = &positions[0][0];
+        const real *py = &positions[1][0];
+        const real *pz = &positions[2][0];
+        real *fx = &forces[0][0], *fy = &forces[1][0], *fz = &forces[2][0];
+        real *tx = &torques[0][0], *ty = &torques[1][0], *tz = &torques[2][0];
+        for (unsigned i = 0; i < surfaceCount; i++)
+        {
+            real x = t[0][i]*vx[i] + t[1][i]*vy[i] + t[2][i]*vz[i];
+            real y = t[3][i]*vx[i] + t[4][i]*vy[i] + t[5][i]*vz[i];
+            real z = t[6][i]*vx[i] + t[7][i]*vy[i] + t[8][i]*vz[i];
+            fx[i] = x;
+            fy[i] = y;
+            fz[i] = z;
+            tx[i] = py[i]*z - pz[i]*y;
+            ty[i] = pz[i]*x - px[i]*z;
+            tz[i] = px[i]*y - py[i]*x;
+        }
+    }
+
+    // Total them up for each body.
+    bodyForces.assign(bodyCount, Vector3());
+    bodyTorques.assign(bodyCount, Vector3());
+    for (unsigned i = 0; i < surfaceCount; i++)
+    {
+        unsigned b = surfaceBodies[i];
+        bodyForces[b] += Vector3(forces[0][i], forces[1][i], forces[2][i]);
+        bodyTorques[b] += Vector3(torques[0][i], torques[1][i], torques[2][i]);
+    }
+
+    // And turn them into world space. Rotating the body's summed
+    // torque gives the same result as summing each surface's force
+    // applied at its world space point.
+    for (unsigned b = 0; b < bodyCount; b++)
+    {
+        Matrix4 transform = bodies[b]->getTransform();
+        bodies[b]->addForce(transform.transformDirection(bodyForces[b]));
+        bodies[b]->addTorque(transform.transformDirection(bodyTorques[b]));
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * Implementation file for the per-frame memory arena.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <cyclone/arena.h>
+#include <cstdlib>
+#include <assert.h>
+
+using namespace cyclone;
+
+FrameArena::FrameArena(size_t blockSize)
+:
+current(NULL),
+blockSize(blockSize),
+bytesUsed(0)
+{
+}
+
+FrameArena::~FrameArena()
+{
+    releaseBlocks();
+}
+
+void FrameArena::addBlock(size_t minimumSize)
+{
+    size_t size = blockSize;
+    if (size < minimumSize) size = minimumSize;
+
+    Block *block = static_cast<Block*>(malloc(sizeof(Block) + size));
+    assert(block != NULL);
+    block->next = current;
+    block->size = size;
+    block->used = 0;
+    current = block;
+}
+
+void FrameArena::releaseBlocks()
+{
+    while (current)
+    {
+        Block *next = current->next;
+        free(current);
+        current = next;
+    }
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment)
+{
+    assert((alignment & (alignment-1)) == 0);
+
+    if (current)
+    {
+        char *base = reinterpret_cast<char*>(current + 1);
+        size_t start = current->used;
+        size_t misalign = reinterpret_cast<size_t>(base + start) & (alignment-1);
+        if (misalign) start += alignment - misalign;
+
+        if (start + bytes <= current->size)
+        {
+            bytesUsed += start + bytes - current->used;
+            current->used = start + bytes;
+            return base + start;
+        }
+    }
+
+    // The current block is full (or we don't have one), so chain a
+    // new one on, big enough for this request at any alignment.
+    addBlock(bytes + alignment);
+    return allocate(bytes, alignment);
+}
+
+void FrameArena::reset()
+{
+    if (current && current->next)
+    {
+        // Last frame overflowed into several blocks. Replace them
+        // with a single block big enough to hold the whole frame.
+        size_t total = getCapacity();
+        releaseBlocks();
+        addBlock(total);
+    }
+    else if (current)
+    {
+        current->used = 0;
+    }
+    bytesUsed = 0;
+}
+
+size_t FrameArena::getCapacity() const
+{
+    size_t total = 0;
+    for (Block *block = current; block; block = block->next)
+    {
+        total += block->size;
+    }
+    return total;
+}
@@ -152,8 +152,61 @@ void RigidBody::calculateDerivedData()
 
 }
 
+RigidBody::RigidBody()
+:
+type(DYNAMIC)
+{
+}
+
+void RigidBody::setType(Type type)
+{
+    RigidBody::type = type;
+    lastFrameAcceleration.clear();
+    clearAccumulators();
+
+    if (type == STATIC)
+    {
+        velocity.clear();
+        rotation.clear();
+        isAwake = false;
+    }
+    else if (type == KINEMATIC)
+    {
+        isAwake = velocity.squareMagnitude() > 0 ||
+            rotation.squareMagnitude() > 0;
+    }
+}
+
 void RigidBody::integrate(real duration)
 {
+    integrate(duration,
+        real_pow(linearDamping, duration),
+        real_pow(angularDamping, duration),
+        real_pow(0.5, duration));
+}
+
+void RigidBody::integrate(real duration, real linearFactor,
+                          real angularFactor, real sleepBias,
+                          bool sleepAlone)
+{
+    if (type == STATIC) return;
+
+    if (type == KINEMATIC)
+    {
+        // Kinematic bodies follow their velocity and rotation
+        // exactly. They count as awake only while they are moving,
+        // so they don't keep the bodies resting on them awake.
+        isAwake = velocity.squareMagnitude() > 0 ||
+            rotation.squareMagnitude() > 0;
+        if (!isAwake) return;
+
+        position.addScaledVector(velocity, duration);
+        orientation.addScaledVector(rotation, duration);
+        calculateDerivedData();
+        clearAccumulators();
+        return;
+    }
+
     if (!isAwake) return;
 
     // Calculate linear acceleration from force inputs.
@@ -172,8 +225,8 @@ void RigidBody::integrate(real duration)
     rotation.addScaledVector(angularAcceleration, duration);
 
     // Impose drag.
-    velocity *= real_pow(linearDamping, duration);
-    rotation *= real_pow(angularDamping, duration);
+    velocity *= linearFactor;
+    rotation *= angularFactor;
 
     // Adjust positions
     // Update linear position.
@@ -195,10 +248,12 @@ void RigidBody::integrate(real duration)
         real currentMotion = velocity.scalarProduct(velocity) +
             rotation.scalarProduct(rotation);
 
-        real bias = real_pow(0.5, duration);
-        motion = bias*motion + (1-bias)*currentMotion;
+        motion = sleepBias*motion + (1-sleepBias)*currentMotion;
 
-        if (motion < sleepEpsilon) setAwake(false);
+        if (motion < sleepEpsilon)
+        {
+            if (sleepAlone) setAwake(false);
+        }
         else if (motion > 10 * sleepEpsilon) motion = 10 * sleepEpsilon;
     }
 }
@@ -211,7 +266,7 @@ void RigidBody::setMass(const real mass)
 
 real RigidBody::getMass() const
 {
-    if (inverseMass == 0) {
+    if (inverseMass == 0 || type != DYNAMIC) {
         return REAL_MAX;
     } else {
         return ((real)1.0)/inverseMass;
@@ -225,6 +280,7 @@ void RigidBody::setInverseMass(const real inverseMass)
 
 real RigidBody::getInverseMass() const
 {
+    if (type != DYNAMIC) return 0;
     return inverseMass;
 }
 
@@ -281,11 +337,13 @@ Matrix3 RigidBody::getInverseInertiaTensor() const
 
 void RigidBody::getInverseInertiaTensorWorld(Matrix3 *inverseInertiaTensor) const
 {
-    *inverseInertiaTensor = inverseInertiaTensorWorld;
+    if (type != DYNAMIC) *inverseInertiaTensor = Matrix3();
+    else *inverseInertiaTensor = inverseInertiaTensorWorld;
 }
 
 Matrix3 RigidBody::getInverseInertiaTensorWorld() const
 {
+    if (type != DYNAMIC) return Matrix3();
     return inverseInertiaTensorWorld;
 }
 
@@ -424,6 +482,60 @@ Matrix4 RigidBody::getTransform() const
     return transformMatrix;
 }
 
+void RigidBody::storePreviousTransform()
+{
+    previousPosition = position;
+    previousOrientation = orientation;
+}
+
+void RigidBody::getInterpolatedTransform(real alpha, Matrix4 *transform) const
+{
+    Vector3 blendPosition = previousPosition * (1 - alpha) + position * alpha;
+
+    // Blend the orientations linearly and renormalise. The steps are
+    // short, so this is indistinguishable from a proper slerp. We go
+    // the short way round if the two are in opposite hemispheres.
+    real dot = previousOrientation.r * orientation.r +
+        previousOrientation.i * orientation.i +
+        previousOrientation.j * orientation.j +
+        previousOrientation.k * orientation.k;
+    real current = dot < 0 ? -alpha : alpha;
+    Quaternion blendOrientation(
+        previousOrientation.r * (1 - alpha) + orientation.r * current,
+        previousOrientation.i * (1 - alpha) + orientation.i * current,
+        previousOrientation.j * (1 - alpha) + orientation.j * current,
+        previousOrientation.k * (1 - alpha) + orientation.k * current);
+    blendOrientation.normalise();
+
+    _calculateTransformMatrix(*transform, blendPosition, blendOrientation);
+}
+
+void RigidBody::getInterpolatedGLTransform(real alpha, float matrix[16]) const
+{
+    Matrix4 transform;
+    getInterpolatedTransform(alpha, &transform);
+
+    matrix[0] = (float)transform.data[0];
+    matrix[1] = (float)transform.data[4];
+    matrix[2] = (float)transform.data[8];
+    matrix[3] = 0;
+
+    matrix[4] = (float)transform.data[1];
+    matrix[5] = (float)transform.data[5];
+    matrix[6] = (float)transform.data[9];
+    matrix[7] = 0;
+
+    matrix[8] = (float)transform.data[2];
+    matrix[9] = (float)transform.data[6];
+    matrix[10] = (float)transform.data[10];
+    matrix[11] = 0;
+
+    matrix[12] = (float)transform.data[3];
+    matrix[13] = (float)transform.data[7];
+    matrix[14] = (float)transform.data[11];
+    matrix[15] = 1;
+}
+
 
 Vector3 RigidBody::getPointInLocalSpace(const Vector3 &point) const
 {
@@ -538,6 +650,16 @@ void RigidBody::clearAccumulators()
     torqueAccum.clear();
 }
 
+Vector3 RigidBody::getAccumulatedForce() const
+{
+    return forceAccum;
+}
+
+Vector3 RigidBody::getAccumulatedTorque() const
+{
+    return torqueAccum;
+}
+
 void RigidBody::addForce(const Vector3 &force)
 {
     forceAccum += force;
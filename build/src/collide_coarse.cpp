@@ -75,4 +75,39 @@ real BoundingSphere::getGrowth(const BoundingSphere &other) const
     // We return a value proportional to the change in surface
     // area of the sphere.
     return newSphere.radius*newSphere.radius - radius*radius;
-}
\ No newline at end of file
+}
+
+BodyGrid::BodyGrid(real cellSize)
+:
+grid(cellSize)
+{
+}
+
+void BodyGrid::setCellSize(real size)
+{
+    grid.setCellSize(size);
+}
+
+void BodyGrid::build(RigidBody * const *bodies, unsigned count)
+{
+    BodyGrid::bodies.assign(bodies, bodies + count);
+
+    grid.setCount(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        grid.setPoint(i, bodies[i]->getPosition());
+    }
+    grid.sort();
+}
+
+unsigned BodyGrid::query(const Vector3 &centre, real radius,
+                         std::vector<RigidBody*> *results) const
+{
+    found.clear();
+    unsigned count = grid.findNear(centre, radius, &found);
+    for (unsigned i = 0; i < count; i++)
+    {
+        results->push_back(bodies[found[i]]);
+    }
+    return count;
+}
@@ -0,0 +1,871 @@
+/*
+ * Implementation file for the convex hull collision primitive.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <cyclone/collide_convex.h>
+#include <algorithm>
+#include <utility>
+
+using namespace cyclone;
+
+/**
+ * Hulls with no more vertices than this are searched exhaustively,
+ * even if their edges are known: for small hulls a straight run
+ * through the coordinate arrays beats walking the edges.
+ */
+static const unsigned hillClimbThreshold = 32;
+
+/** The most iterations GJK or EPA will take before giving up. */
+static const unsigned maxIterations = 64;
+
+/** The relative progress below which GJK has converged. */
+static const real gjkTolerance = (real)0.0001;
+
+/** The absolute progress below which EPA has converged. */
+static const real epaTolerance = (real)0.0001;
+
+CollisionConvex::CollisionConvex()
+:
+lastSupport(0),
+boundingRadius(0)
+{
+}
+
+void CollisionConvex::setVertices(const Vector3 *vertices, unsigned count)
+{
+    vertexX.resize(count);
+    vertexY.resize(count);
+    vertexZ.resize(count);
+    adjacencyStart.clear();
+    adjacency.clear();
+    lastSupport = 0;
+
+    real maxSquare = 0;
+    for (unsigned i = 0; i < count; i++)
+    {
+        vertexX[i] = vertices[i].x;
+        vertexY[i] = vertices[i].y;
+        vertexZ[i] = vertices[i].z;
+        if (vertices[i].squareMagnitude() > maxSquare)
+        {
+            maxSquare = vertices[i].squareMagnitude();
+        }
+    }
+    boundingRadius = real_sqrt(maxSquare);
+}
+
+void CollisionConvex::setTriangles(const unsigned *indices,
+                                   unsigned triangleCount)
+{
+    unsigned count = getVertexCount();
+
+    // Collect each edge in both directions, then sort them so the
+    // neighbours of each vertex are together and duplicates (each
+    // edge is shared by two triangles) are adjacent.
+    std::vector< std::pair<unsigned, unsigned> > edges;
+    edges.reserve(triangleCount * 6);
+    for (unsigned i = 0; i < triangleCount; i++)
+    {
+        const unsigned *tri = indices + i*3;
+        for (unsigned j = 0; j < 3; j++)
+        {
+            unsigned a = tri[j], b = tri[(j+1)%3];
+            edges.push_back(std::make_pair(a, b));
+            edges.push_back(std::make_pair(b, a));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    adjacencyStart.assign(count + 1, 0);
+    adjacency.resize(edges.size());
+    for (unsigned i = 0; i < edges.size(); i++)
+    {
+        adjacencyStart[edges[i].first + 1]++;
+        adjacency[i] = edges[i].second;
+    }
+    for (unsigned i = 0; i < count; i++)
+    {
+        adjacencyStart[i+1] += adjacencyStart[i];
+    }
+}
+
+unsigned CollisionConvex::findSupportIndex(const Vector3 &localDirection) const
+{
+    const real dx = localDirection.x;
+    const real dy = localDirection.y;
+    const real dz = localDirection.z;
+    unsigned count = getVertexCount();
+
+    if (count > hillClimbThreshold && !adjacency.empty())
+    {
+        // Walk uphill from the last support point until no
+        // neighbour is further in the given direction. A hull has no
+        // local maxima, so this finds the furthest point.
+        unsigned best = lastSupport < count ? lastSupport : 0;
+        real bestDot = vertexX[best]*dx + vertexY[best]*dy + vertexZ[best]*dz;
+        bool improved = true;
+        while (improved)
+        {
+            improved = false;
+            unsigned end = adjacencyStart[best+1];
+            for (unsigned i = adjacencyStart[best]; i < end; i++)
+            {
+                unsigned n = adjacency[i];
+                real dot = vertexX[n]*dx + vertexY[n]*dy + vertexZ[n]*dz;
+                if (dot > bestDot)
+                {
+                    best = n;
+                    bestDot = dot;
+                    improved = true;
+                    break;
+                }
+            }
+        }
+        lastSupport = best;
+        return best;
+    }
+
+    // Check every vertex.
+    unsigned best = 0;
+    real bestDot = -REAL_MAX;
+    for (unsigned i = 0; i < count; i++)
+    {
+        real dot = vertexX[i]*dx + vertexY[i]*dy + vertexZ[i]*dz;
+        if (dot > bestDot)
+        {
+            best = i;
+            bestDot = dot;
+        }
+    }
+    return best;
+}
+
+Vector3 CollisionConvex::getSupport(const Vector3 &direction) const
+{
+    Vector3 local = getTransform().transformInverseDirection(direction);
+    return getTransform().transform(getVertex(findSupportIndex(local)));
+}
+
+// GJK and EPA implementation
+
+/**
+ * The convex tests work on anything that can give a support point,
+ * so they can be used for hulls against boxes and points as well as
+ * against other hulls.
+ */
+class SupportMap
+{
+public:
+    virtual ~SupportMap() {}
+    virtual Vector3 support(const Vector3 &direction) const = 0;
+};
+
+class ConvexSupport : public SupportMap
+{
+    const CollisionConvex &convex;
+public:
+    ConvexSupport(const CollisionConvex &convex) : convex(convex) {}
+    virtual Vector3 support(const Vector3 &direction) const
+    {
+        return convex.getSupport(direction);
+    }
+};
+
+class BoxSupport : public SupportMap
+{
+    const CollisionBox &box;
+public:
+    BoxSupport(const CollisionBox &box) : box(box) {}
+    virtual Vector3 support(const Vector3 &direction) const
+    {
+        Vector3 local = box.getTransform().transformInverseDirection(direction);
+        Vector3 corner(
+            local.x < 0 ? -box.halfSize.x : box.halfSize.x,
+            local.y < 0 ? -box.halfSize.y : box.halfSize.y,
+            local.z < 0 ? -box.halfSize.z : box.halfSize.z
+            );
+        return box.getTransform().transform(corner);
+    }
+};
+
+class PointSupport : public SupportMap
+{
+    Vector3 point;
+public:
+    PointSupport(const Vector3 &point) : point(point) {}
+    virtual Vector3 support(const Vector3 &) const
+    {
+        return point;
+    }
+};
+
+/**
+ * Holds one point of the Minkowski difference of the two shapes,
+ * along with the support points of each shape that made it.
+ */
+struct SupportPoint
+{
+    Vector3 w;
+    Vector3 a;
+    Vector3 b;
+};
+
+static inline void findSupportPoint(const SupportMap &one,
+                                    const SupportMap &two,
+                                    const Vector3 &direction,
+                                    SupportPoint *result)
+{
+    result->a = one.support(direction);
+    result->b = two.support(direction * -1);
+    result->w = result->a - result->b;
+}
+
+/**
+ * Finds the point on a triangle of the simplex closest to the
+ * origin. The triangle is reduced to the smallest set of vertices
+ * whose region contains the closest point, and the barycentric
+ * weights of the remaining vertices are returned.
+ */
+static void closestOnTriangle(SupportPoint *simplex, unsigned *count,
+                              real *lambda)
+{
+    const Vector3 a = simplex[0].w, b = simplex[1].w, c = simplex[2].w;
+    Vector3 ab = b - a, ac = c - a;
+
+    real d1 = ab * (a * -1), d2 = ac * (a * -1);
+    if (d1 <= 0 && d2 <= 0)
+    {
+        *count = 1; lambda[0] = 1;
+        return;
+    }
+
+    real d3 = ab * (b * -1), d4 = ac * (b * -1);
+    if (d3 >= 0 && d4 <= d3)
+    {
+        simplex[0] = simplex[1];
+        *count = 1; lambda[0] = 1;
+        return;
+    }
+
+    real vc = d1*d4 - d3*d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+    {
+        real v = d1 / (d1 - d3);
+        *count = 2; lambda[0] = 1 - v; lambda[1] = v;
+        return;
+    }
+
+    real d5 = ab * (c * -1), d6 = ac * (c * -1);
+    if (d6 >= 0 && d5 <= d6)
+    {
+        simplex[0] = simplex[2];
+        *count = 1; lambda[0] = 1;
+        return;
+    }
+
+    real vb = d5*d2 - d1*d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+    {
+        real w = d2 / (d2 - d6);
+        simplex[1] = simplex[2];
+        *count = 2; lambda[0] = 1 - w; lambda[1] = w;
+        return;
+    }
+
+    real va = d3*d6 - d5*d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+    {
+        real w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        simplex[0] = simplex[1];
+        simplex[1] = simplex[2];
+        *count = 2; lambda[0] = 1 - w; lambda[1] = w;
+        return;
+    }
+
+    real denom = ((real)1) / (va + vb + vc);
+    real v = vb * denom, w = vc * denom;
+    *count = 3; lambda[0] = 1 - v - w; lambda[1] = v; lambda[2] = w;
+}
+
+/**
+ * Finds the point on the simplex closest to the origin, reducing the
+ * simplex to the vertices needed to express it. Returns true if the
+ * simplex is a tetrahedron that contains the origin.
+ */
+static bool closestOnSimplex(SupportPoint *simplex, unsigned *count,
+                             real *lambda)
+{
+    switch (*count)
+    {
+    case 1:
+        lambda[0] = 1;
+        return false;
+
+    case 2:
+        {
+            Vector3 ab = simplex[1].w - simplex[0].w;
+            real t = (simplex[0].w * -1) * ab;
+            real lengthSquared = ab.squareMagnitude();
+            if (t <= 0 || lengthSquared <= 0)
+            {
+                *count = 1; lambda[0] = 1;
+            }
+            else if (t >= lengthSquared)
+            {
+                simplex[0] = simplex[1];
+                *count = 1; lambda[0] = 1;
+            }
+            else
+            {
+                t /= lengthSquared;
+                lambda[0] = 1 - t; lambda[1] = t;
+            }
+        }
+        return false;
+
+    case 3:
+        closestOnTriangle(simplex, count, lambda);
+        return false;
+    }
+
+    // We have a tetrahedron. Check each face to see if the origin is
+    // on the far side of it from the remaining vertex.
+    static const unsigned faces[4][4] = {
+        {0,1,2,3}, {0,2,3,1}, {0,3,1,2}, {1,3,2,0}
+    };
+    bool outside = false;
+    real bestSquare = REAL_MAX;
+    SupportPoint best[3];
+    unsigned bestCount = 0;
+    real bestLambda[3];
+
+    for (unsigned f = 0; f < 4; f++)
+    {
+        const Vector3 &a = simplex[faces[f][0]].w;
+        const Vector3 &b = simplex[faces[f][1]].w;
+        const Vector3 &c = simplex[faces[f][2]].w;
+        const Vector3 &d = simplex[faces[f][3]].w;
+        Vector3 normal = (b - a) % (c - a);
+        real originSide = normal * (a * -1);
+        real vertexSide = normal * (d - a);
+
+        // A flat tetrahedron can't contain the origin, so treat
+        // each of its faces as a candidate.
+        if (originSide * vertexSide >= 0 &&
+            real_abs(vertexSide) > real_epsilon) continue;
+        outside = true;
+
+        SupportPoint face[3];
+        face[0] = simplex[faces[f][0]];
+        face[1] = simplex[faces[f][1]];
+        face[2] = simplex[faces[f][2]];
+        unsigned faceCount = 3;
+        real faceLambda[3];
+        closestOnTriangle(face, &faceCount, faceLambda);
+
+        Vector3 closest;
+        for (unsigned i = 0; i < faceCount; i++)
+        {
+            closest += face[i].w * faceLambda[i];
+        }
+        if (closest.squareMagnitude() < bestSquare)
+        {
+            bestSquare = closest.squareMagnitude();
+            bestCount = faceCount;
+            for (unsigned i = 0; i < faceCount; i++)
+            {
+                best[i] = face[i];
+                bestLambda[i] = faceLambda[i];
+            }
+        }
+    }
+
+    if (!outside) return true;
+
+    *count = bestCount;
+    for (unsigned i = 0; i < bestCount; i++)
+    {
+        simplex[i] = best[i];
+        lambda[i] = bestLambda[i];
+    }
+    return false;
+}
+
+/**
+ * Holds the working state of a GJK query.
+ */
+struct GjkResult
+{
+    SupportPoint simplex[4];
+    unsigned count;
+    real lambda[4];
+    bool overlapping;
+    Vector3 closest;
+};
+
+/**
+ * Runs GJK on the two shapes. If the shapes are separated, the
+ * result holds the simplex whose closest point to the origin gives
+ * the separation. If they overlap, the result holds the simplex
+ * that encloses the origin, ready for EPA.
+ */
+static void runGjk(const SupportMap &one, const SupportMap &two,
+                   GjkResult *result)
+{
+    findSupportPoint(one, two, Vector3(1, 0, 0), result->simplex);
+    result->count = 1;
+    result->lambda[0] = 1;
+    result->overlapping = false;
+    Vector3 v = result->simplex[0].w;
+
+    for (unsigned iteration = 0; iteration < maxIterations; iteration++)
+    {
+        real vv = v.squareMagnitude();
+        if (vv <= real_epsilon)
+        {
+            result->overlapping = true;
+            break;
+        }
+
+        SupportPoint p;
+        findSupportPoint(one, two, v * -1, &p);
+
+        // Stop if the new point gets us no closer to the origin.
+        if (vv - v * p.w <= gjkTolerance * vv) break;
+
+        result->simplex[result->count++] = p;
+        if (closestOnSimplex(result->simplex, &result->count, result->lambda))
+        {
+            result->overlapping = true;
+            break;
+        }
+
+        v.clear();
+        for (unsigned i = 0; i < result->count; i++)
+        {
+            v += result->simplex[i].w * result->lambda[i];
+        }
+    }
+    result->closest = v;
+}
+
+/**
+ * Holds one face of the expanding polytope.
+ */
+struct PolytopeFace
+{
+    unsigned vertex[3];
+    Vector3 normal;
+    real distance;
+    bool obsolete;
+};
+
+static bool makeFace(const std::vector<SupportPoint> &vertices,
+                     unsigned a, unsigned b, unsigned c,
+                     PolytopeFace *face)
+{
+    face->vertex[0] = a;
+    face->vertex[1] = b;
+    face->vertex[2] = c;
+    face->normal = (vertices[b].w - vertices[a].w) %
+        (vertices[c].w - vertices[a].w);
+    real length = face->normal.magnitude();
+    face->obsolete = length <= real_epsilon;
+    if (face->obsolete) return false;
+    face->normal *= ((real)1) / length;
+    face->distance = face->normal * vertices[a].w;
+    return true;
+}
+
+/**
+ * Grows a simplex that touches the origin into a tetrahedron, so EPA
+ * has a volume to work with. Returns false if the Minkowski
+ * difference is flat, in which case there is no penetration to find.
+ */
+static bool expandSimplex(const SupportMap &one, const SupportMap &two,
+                          GjkResult *gjk)
+{
+    static const Vector3 axes[6] = {
+        Vector3(1,0,0), Vector3(-1,0,0), Vector3(0,1,0),
+        Vector3(0,-1,0), Vector3(0,0,1), Vector3(0,0,-1)
+    };
+
+    SupportPoint *simplex = gjk->simplex;
+    if (gjk->count == 1)
+    {
+        for (unsigned i = 0; i < 6 && gjk->count == 1; i++)
+        {
+            findSupportPoint(one, two, axes[i], simplex + 1);
+            if ((simplex[1].w - simplex[0].w).squareMagnitude() > real_epsilon)
+            {
+                gjk->count = 2;
+            }
+        }
+        if (gjk->count == 1) return false;
+    }
+
+    if (gjk->count == 2)
+    {
+        Vector3 line = simplex[1].w - simplex[0].w;
+        for (unsigned i = 0; i < 6 && gjk->count == 2; i += 2)
+        {
+            Vector3 direction = line % axes[i];
+            if (direction.squareMagnitude() <= real_epsilon) continue;
+            for (unsigned sign = 0; sign < 2 && gjk->count == 2; sign++)
+            {
+                findSupportPoint(one, two, direction, simplex + 2);
+                Vector3 offset = (simplex[2].w - simplex[0].w) % line;
+                if (offset.squareMagnitude() > real_epsilon) gjk->count = 3;
+                direction.invert();
+            }
+        }
+        if (gjk->count == 2) return false;
+    }
+
+    if (gjk->count == 3)
+    {
+        Vector3 normal = (simplex[1].w - simplex[0].w) %
+            (simplex[2].w - simplex[0].w);
+        for (unsigned sign = 0; sign < 2 && gjk->count == 3; sign++)
+        {
+            findSupportPoint(one, two, normal, simplex + 3);
+            real height = normal * (simplex[3].w - simplex[0].w);
+            if (real_abs(height) > real_epsilon) gjk->count = 4;
+            normal.invert();
+        }
+        if (gjk->count == 3) return false;
+    }
+    return true;
+}
+
+/**
+ * Runs EPA from a tetrahedron enclosing the origin, finding the
+ * shortest vector that separates the two shapes.
+ */
+static bool runEpa(const SupportMap &one, const SupportMap &two,
+                   GjkResult *gjk, Vector3 *normal, real *depth,
+                   Vector3 *point)
+{
+    if (!expandSimplex(one, two, gjk)) return false;
+
+    std::vector<SupportPoint> vertices(gjk->simplex, gjk->simplex + 4);
+    std::vector<PolytopeFace> faces;
+
+    // Build the tetrahedron with every face wound outwards.
+    Vector3 centre = (vertices[0].w + vertices[1].w +
+        vertices[2].w + vertices[3].w) * ((real)0.25);
+    static const unsigned tetra[4][3] = {
+        {0,1,2}, {0,3,1}, {0,2,3}, {1,3,2}
+    };
+    for (unsigned i = 0; i < 4; i++)
+    {
+        PolytopeFace face;
+        unsigned a = tetra[i][0], b = tetra[i][1], c = tetra[i][2];
+        makeFace(vertices, a, b, c, &face);
+        if (face.normal * (vertices[a].w - centre) < 0)
+        {
+            makeFace(vertices, a, c, b, &face);
+        }
+        faces.push_back(face);
+    }
+
+    std::vector< std::pair<unsigned, unsigned> > horizon;
+    PolytopeFace *closest = NULL;
+    for (unsigned iteration = 0; iteration < maxIterations; iteration++)
+    {
+        // Find the face closest to the origin.
+        closest = NULL;
+        for (unsigned i = 0; i < faces.size(); i++)
+        {
+            if (faces[i].obsolete) continue;
+            if (!closest || faces[i].distance < closest->distance)
+            {
+                closest = &faces[i];
+            }
+        }
+        if (!closest) return false;
+
+        // See if the polytope can be pushed out any further.
+        SupportPoint p;
+        findSupportPoint(one, two, closest->normal, &p);
+        if (p.w * closest->normal - closest->distance < epaTolerance) break;
+
+        // Remove every face the new point can see, keeping the edges
+        // around the hole this leaves. Faces the point lies in the
+        // plane of are removed too: hulls often have coplanar faces,
+        // and keeping some of them would fold the new faces over.
+        horizon.clear();
+        real coplanar = epaTolerance * ((real)0.01) * (1 + p.w.magnitude());
+        for (unsigned i = 0; i < faces.size(); i++)
+        {
+            PolytopeFace &face = faces[i];
+            if (face.obsolete) continue;
+            if (face.normal * p.w - face.distance < -coplanar) continue;
+            face.obsolete = true;
+
+            for (unsigned j = 0; j < 3; j++)
+            {
+                std::pair<unsigned, unsigned> edge(
+                    face.vertex[j], face.vertex[(j+1)%3]);
+                std::pair<unsigned, unsigned> reverse(edge.second, edge.first);
+                std::vector< std::pair<unsigned, unsigned> >::iterator shared =
+                    std::find(horizon.begin(), horizon.end(), reverse);
+                if (shared != horizon.end()) horizon.erase(shared);
+                else horizon.push_back(edge);
+            }
+        }
+
+        // Patch the hole with faces joining the edges to the point.
+        unsigned index = (unsigned)vertices.size();
+        vertices.push_back(p);
+        for (unsigned i = 0; i < horizon.size(); i++)
+        {
+            PolytopeFace face;
+            makeFace(vertices, horizon[i].first, horizon[i].second,
+                index, &face);
+            faces.push_back(face);
+        }
+        closest = NULL;
+    }
+    if (!closest)
+    {
+        // We ran out of iterations; use the best face we have.
+        for (unsigned i = 0; i < faces.size(); i++)
+        {
+            if (faces[i].obsolete) continue;
+            if (!closest || faces[i].distance < closest->distance)
+            {
+                closest = &faces[i];
+            }
+        }
+        if (!closest) return false;
+    }
+
+    // Find the barycentric coordinates of the origin's projection
+    // onto the face, and use them to find the witness points.
+    const SupportPoint &a = vertices[closest->vertex[0]];
+    const SupportPoint &b = vertices[closest->vertex[1]];
+    const SupportPoint &c = vertices[closest->vertex[2]];
+    Vector3 projection = closest->normal * closest->distance;
+    Vector3 v0 = b.w - a.w, v1 = c.w - a.w, v2 = projection - a.w;
+    real d00 = v0 * v0, d01 = v0 * v1, d11 = v1 * v1;
+    real d20 = v2 * v0, d21 = v2 * v1;
+    real denom = d00 * d11 - d01 * d01;
+    real v = 0, w = 0;
+    if (real_abs(denom) > real_epsilon)
+    {
+        v = (d11 * d20 - d01 * d21) / denom;
+        w = (d00 * d21 - d01 * d20) / denom;
+    }
+    real u = 1 - v - w;
+
+    Vector3 pointOne = a.a * u + b.a * v + c.a * w;
+    Vector3 pointTwo = a.b * u + b.b * v + c.b * w;
+
+    // The first shape has to move against the face normal.
+    *normal = closest->normal * -1;
+    *depth = closest->distance;
+    *point = (pointOne + pointTwo) * ((real)0.5);
+    return true;
+}
+
+/**
+ * Runs GJK and then EPA if the shapes overlap.
+ */
+static bool findPenetration(const SupportMap &one, const SupportMap &two,
+                            Vector3 *normal, real *depth, Vector3 *point)
+{
+    GjkResult gjk;
+    runGjk(one, two, &gjk);
+    if (!gjk.overlapping) return false;
+    return runEpa(one, two, &gjk, normal, depth, point);
+}
+
+bool ConvexTests::intersect(
+    const CollisionConvex &one,
+    const CollisionConvex &two)
+{
+    GjkResult gjk;
+    runGjk(ConvexSupport(one), ConvexSupport(two), &gjk);
+    return gjk.overlapping;
+}
+
+real ConvexTests::distance(
+    const CollisionConvex &one,
+    const CollisionConvex &two,
+    Vector3 *pointOne,
+    Vector3 *pointTwo)
+{
+    GjkResult gjk;
+    runGjk(ConvexSupport(one), ConvexSupport(two), &gjk);
+    if (gjk.overlapping) return 0;
+
+    if (pointOne || pointTwo)
+    {
+        Vector3 a, b;
+        for (unsigned i = 0; i < gjk.count; i++)
+        {
+            a += gjk.simplex[i].a * gjk.lambda[i];
+            b += gjk.simplex[i].b * gjk.lambda[i];
+        }
+        if (pointOne) *pointOne = a;
+        if (pointTwo) *pointTwo = b;
+    }
+    return gjk.closest.magnitude();
+}
+
+bool ConvexTests::penetration(
+    const CollisionConvex &one,
+    const CollisionConvex &two,
+    Vector3 *normal,
+    real *depth,
+    Vector3 *point)
+{
+    return findPenetration(ConvexSupport(one), ConvexSupport(two),
+        normal, depth, point);
+}
+
+// Collision detector routines for convex hulls
+
+/**
+ * Writes a single contact into the collision data.
+ */
+static unsigned addConvexContact(RigidBody *one, RigidBody *two,
+                                 const Vector3 &normal, real depth,
+                                 const Vector3 &point,
+                                 CollisionData *data)
+{
+    Contact *contact = data->contacts;
+    contact->contactNormal = normal;
+    contact->contactPoint = point;
+    contact->penetration = depth;
+    contact->setBodyData(one, two, data->friction, data->restitution);
+    data->addContacts(1);
+    return 1;
+}
+
+unsigned CollisionDetector::convexAndHalfSpace(
+    const CollisionConvex &convex,
+    const CollisionPlane &plane,
+    CollisionData *data)
+{
+    if (!data->hasMoreContacts()) return 0;
+
+    // Check the deepest point first, as an early out.
+    Vector3 deepest = convex.getSupport(plane.direction * -1);
+    if (deepest * plane.direction >= plane.offset) return 0;
+
+    // Generate a contact for every vertex below the plane.
+    const Matrix4 &transform = convex.getTransform();
+    unsigned count = convex.getVertexCount();
+    unsigned contactsUsed = 0;
+    for (unsigned i = 0; i < count; i++)
+    {
+        Vector3 vertexPos = transform.transform(convex.getVertex(i));
+        real vertexDistance = vertexPos * plane.direction;
+        if (vertexDistance >= plane.offset) continue;
+
+        if (!data->hasMoreContacts()) break;
+
+        // The contact point is halfway between the vertex and the
+        // plane, as for boxes.
+        Contact *contact = data->contacts;
+        contact->contactPoint = plane.direction;
+        contact->contactPoint *= (vertexDistance-plane.offset);
+        contact->contactPoint += vertexPos;
+        contact->contactNormal = plane.direction;
+        contact->penetration = plane.offset - vertexDistance;
+        contact->setBodyData(convex.body, NULL,
+            data->friction, data->restitution);
+        data->addContacts(1);
+        contactsUsed++;
+    }
+    return contactsUsed;
+}
+
+unsigned CollisionDetector::convexAndSphere(
+    const CollisionConvex &convex,
+    const CollisionSphere &sphere,
+    CollisionData *data)
+{
+    if (!data->hasMoreContacts()) return 0;
+
+    Vector3 centre = sphere.getAxis(3);
+    Vector3 separation = convex.getAxis(3) - centre;
+    real reach = convex.getBoundingRadius() + sphere.radius;
+    if (separation.squareMagnitude() > reach * reach) return 0;
+
+    ConvexSupport hull(convex);
+    PointSupport point(centre);
+
+    GjkResult gjk;
+    runGjk(hull, point, &gjk);
+    if (!gjk.overlapping)
+    {
+        // The centre is outside the hull: the sphere touches if the
+        // closest point of the hull is within its radius.
+        real distance = gjk.closest.magnitude();
+        if (distance >= sphere.radius) return 0;
+
+        Vector3 closest;
+        for (unsigned i = 0; i < gjk.count; i++)
+        {
+            closest += gjk.simplex[i].a * gjk.lambda[i];
+        }
+        return addConvexContact(convex.body, sphere.body,
+            gjk.closest * (((real)1) / distance),
+            sphere.radius - distance, closest, data);
+    }
+
+    // The centre is inside the hull, so push it out through the
+    // nearest face.
+    Vector3 normal, contactPoint;
+    real depth;
+    if (!runEpa(hull, point, &gjk, &normal, &depth, &contactPoint)) return 0;
+    return addConvexContact(convex.body, sphere.body,
+        normal, depth + sphere.radius, contactPoint, data);
+}
+
+unsigned CollisionDetector::convexAndBox(
+    const CollisionConvex &convex,
+    const CollisionBox &box,
+    CollisionData *data)
+{
+    if (!data->hasMoreContacts()) return 0;
+
+    Vector3 separation = convex.getAxis(3) - box.getAxis(3);
+    real reach = convex.getBoundingRadius() + box.halfSize.magnitude();
+    if (separation.squareMagnitude() > reach * reach) return 0;
+
+    Vector3 normal, point;
+    real depth;
+    if (!findPenetration(ConvexSupport(convex), BoxSupport(box),
+        &normal, &depth, &point)) return 0;
+    return addConvexContact(convex.body, box.body, normal, depth, point, data);
+}
+
+unsigned CollisionDetector::convexAndConvex(
+    const CollisionConvex &one,
+    const CollisionConvex &two,
+    CollisionData *data)
+{
+    if (!data->hasMoreContacts()) return 0;
+
+    Vector3 separation = one.getAxis(3) - two.getAxis(3);
+    real reach = one.getBoundingRadius() + two.getBoundingRadius();
+    if (separation.squareMagnitude() > reach * reach) return 0;
+
+    Vector3 normal, point;
+    real depth;
+    if (!ConvexTests::penetration(one, two, &normal, &depth, &point)) return 0;
+    return addConvexContact(one.body, two.body, normal, depth, point, data);
+}
@@ -140,6 +140,283 @@ bool IntersectionTests::boxAndHalfSpace(
     return boxDistance <= plane.offset;
 }
 
+bool SweepTests::sphereAndHalfSpace(
+    const Vector3 &start,
+    const Vector3 &end,
+    real radius,
+    const CollisionPlane &plane,
+    real *timeOfImpact,
+    Vector3 *normal
+    )
+{
+    // Find the distance of the sphere's surface from the plane at
+    // each end of the path.
+    real startDistance = plane.direction * start - plane.offset - radius;
+    real endDistance = plane.direction * end - plane.offset - radius;
+
+    // If we're already touching, we only hit the plane if we're
+    // moving further into it. Otherwise we can't get any deeper, and
+    // the contact generators will deal with the touch. If we finish
+    // clear of the plane (having started clear of it) we never touch
+    // it.
+    if (startDistance <= 0)
+    {
+        if (plane.direction * (end - start) >= 0) return false;
+        *timeOfImpact = 0;
+    }
+    else if (endDistance > 0)
+    {
+        return false;
+    }
+    else
+    {
+        *timeOfImpact = startDistance / (startDistance - endDistance);
+    }
+
+    if (normal) *normal = plane.direction;
+    return true;
+}
+
+/*
+ * Finds the first time, in the range 0 to 1, at which a point moving
+ * from origin along the given movement comes within the given radius
+ * of the centre point. Returns false if it never does.
+ */
+static inline bool sweepPointAndSphere(
+    const Vector3 &origin,
+    const Vector3 &movement,
+    const Vector3 &centre,
+    real radius,
+    real *t
+    )
+{
+    Vector3 offset = origin - centre;
+    real a = movement.squareMagnitude();
+    real b = offset * movement;
+    real c = offset.squareMagnitude() - radius*radius;
+
+    // Starting inside the sphere.
+    if (c <= 0) { *t = 0; return true; }
+
+    // Moving away, or not moving at all.
+    if (b >= 0 || a <= 0) return false;
+
+    real discriminant = b*b - a*c;
+    if (discriminant < 0) return false;
+
+    real hit = (-b - real_sqrt(discriminant)) / a;
+    if (hit > 1) return false;
+    *t = hit;
+    return true;
+}
+
+/*
+ * Finds the first time, in the range 0 to 1, at which a point moving
+ * from origin along the given movement comes within the given radius
+ * of the line segment between a and b. Returns false if it never
+ * does.
+ */
+static inline bool sweepPointAndCapsule(
+    const Vector3 &origin,
+    const Vector3 &movement,
+    const Vector3 &a,
+    const Vector3 &b,
+    real radius,
+    real *t
+    )
+{
+    real best = REAL_MAX;
+    real hit;
+
+    // Check the cylindrical section first. We work with the
+    // components of the offset and movement at right angles to the
+    // segment, which gives a circle in the plane across the segment.
+    Vector3 axis = b - a;
+    real axisSquared = axis.squareMagnitude();
+    if (axisSquared > 0)
+    {
+        Vector3 offset = origin - a;
+        Vector3 offsetAcross = offset - axis * ((offset * axis) / axisSquared);
+        Vector3 moveAcross = movement - axis * ((movement * axis) / axisSquared);
+
+        real qa = moveAcross.squareMagnitude();
+        real qb = offsetAcross * moveAcross;
+        real qc = offsetAcross.squareMagnitude() - radius*radius;
+        real discriminant = qb*qb - qa*qc;
+
+        if (qa > 0 && qb < 0 && discriminant >= 0)
+        {
+            hit = (-qb - real_sqrt(discriminant)) / qa;
+            if (hit >= 0 && hit <= 1)
+            {
+                // Make sure the hit is between the ends of the segment.
+                real along = ((offset + movement * hit) * axis) / axisSquared;
+                if (along >= 0 && along <= 1) best = hit;
+            }
+        }
+    }
+
+    // Then the spherical caps at each end.
+    if (sweepPointAndSphere(origin, movement, a, radius, &hit) && hit < best)
+    {
+        best = hit;
+    }
+    if (sweepPointAndSphere(origin, movement, b, radius, &hit) && hit < best)
+    {
+        best = hit;
+    }
+
+    if (best > 1) return false;
+    *t = best;
+    return true;
+}
+
+/*
+ * Returns the point on the box (given by its half-sizes, in its own
+ * coordinates) closest to the given point in the same coordinates.
+ */
+static inline Vector3 closestPointOnBox(const Vector3 &halfSize,
+                                        const Vector3 &point)
+{
+    Vector3 result = point;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        if (result[i] > halfSize[i]) result[i] = halfSize[i];
+        else if (result[i] < -halfSize[i]) result[i] = -halfSize[i];
+    }
+    return result;
+}
+
+bool SweepTests::sphereAndBox(
+    const Vector3 &start,
+    const Vector3 &end,
+    real radius,
+    const CollisionBox &box,
+    real *timeOfImpact,
+    Vector3 *normal
+    )
+{
+    // Work in the coordinates of the box, where it is axis aligned.
+    const Matrix4 &transform = box.getTransform();
+    Vector3 origin = transform.transformInverse(start);
+    Vector3 movement = transform.transformInverse(end) - origin;
+    const Vector3 &halfSize = box.halfSize;
+
+    // Check if we're touching the box to begin with.
+    Vector3 closest = closestPointOnBox(halfSize, origin);
+    if ((closest - origin).squareMagnitude() <= radius*radius)
+    {
+        Vector3 localNormal = origin - closest;
+        if (localNormal.squareMagnitude() <= 0)
+        {
+            // The centre is inside the box: push out through the
+            // nearest face.
+            unsigned axis = 0;
+            real smallest = REAL_MAX;
+            for (unsigned i = 0; i < 3; i++)
+            {
+                real depth = halfSize[i] - real_abs(origin[i]);
+                if (depth < smallest) { smallest = depth; axis = i; }
+            }
+            localNormal.clear();
+            localNormal[axis] = (origin[axis] < 0) ? -1 : 1;
+        }
+        localNormal.normalise();
+
+        // The distance from a box never shrinks along a path that
+        // starts off moving away from it, so unless we're moving
+        // further in, we can't get any deeper, and the contact
+        // generators will deal with the touch.
+        if (localNormal * movement >= 0) return false;
+
+        *timeOfImpact = 0;
+        if (normal) *normal = transform.transformDirection(localNormal);
+        return true;
+    }
+
+    // The sphere's centre touches the box exactly when it is inside
+    // the box grown by the radius, with its edges and corners
+    // rounded. Start by clipping the path to the box grown by the
+    // radius with square edges.
+    real entry = 0, exit = 1;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        real extent = halfSize[i] + radius;
+        if (real_abs(movement[i]) < real_epsilon)
+        {
+            if (real_abs(origin[i]) > extent) return false;
+        }
+        else
+        {
+            real inverse = ((real)1.0) / movement[i];
+            real t1 = (-extent - origin[i]) * inverse;
+            real t2 = (extent - origin[i]) * inverse;
+            if (t1 > t2) { real tmp = t1; t1 = t2; t2 = tmp; }
+            if (t1 > entry) entry = t1;
+            if (t2 < exit) exit = t2;
+            if (entry > exit) return false;
+        }
+    }
+
+    // Find which region around the box we entered through. If the
+    // entry point is outside the box on only one axis we hit a face.
+    Vector3 point = origin + movement * entry;
+    unsigned outside = 0, outsideCount = 0;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        if (real_abs(point[i]) > halfSize[i])
+        {
+            outside |= 1 << i;
+            outsideCount++;
+        }
+    }
+
+    real hit = entry;
+    if (outsideCount >= 2)
+    {
+        // We entered the square edge or corner of the grown box,
+        // which may be outside the rounded region. Check against the
+        // capsules around each box edge on the near side.
+        Vector3 corner;
+        for (unsigned i = 0; i < 3; i++)
+        {
+            corner[i] = (point[i] < 0) ? -halfSize[i] : halfSize[i];
+        }
+
+        real best = REAL_MAX;
+        for (unsigned i = 0; i < 3; i++)
+        {
+            // An edge runs along each axis we're not outside on (for
+            // an edge region), or along every axis (for a corner).
+            if (outsideCount == 2 && (outside & (1 << i))) continue;
+
+            Vector3 edgeStart = corner;
+            Vector3 edgeEnd = corner;
+            edgeStart[i] = -halfSize[i];
+            edgeEnd[i] = halfSize[i];
+
+            real t;
+            if (sweepPointAndCapsule(origin, movement,
+                edgeStart, edgeEnd, radius, &t) && t < best)
+            {
+                best = t;
+            }
+        }
+        if (best > 1) return false;
+        hit = best;
+    }
+
+    *timeOfImpact = hit;
+    if (normal)
+    {
+        point = origin + movement * hit;
+        Vector3 localNormal = point - closestPointOnBox(halfSize, point);
+        localNormal.normalise();
+        *normal = transform.transformDirection(localNormal);
+    }
+    return true;
+}
+
 unsigned CollisionDetector::sphereAndTruePlane(
     const CollisionSphere &sphere,
     const CollisionPlane &plane,
@@ -147,7 +424,7 @@ unsigned CollisionDetector::sphereAndTruePlane(
     )
 {
     // Make sure we have contacts
-    if (data->contactsLeft <= 0) return 0;
+    if (!data->hasMoreContacts()) return 0;
 
     // Cache the sphere position
     Vector3 position = sphere.getAxis(3);
@@ -190,7 +467,7 @@ unsigned CollisionDetector::sphereAndHalfSpace(
     )
 {
     // Make sure we have contacts
-    if (data->contactsLeft <= 0) return 0;
+    if (!data->hasMoreContacts()) return 0;
 
     // Cache the sphere position
     Vector3 position = sphere.getAxis(3);
@@ -222,7 +499,7 @@ unsigned CollisionDetector::sphereAndSphere(
     )
 {
     // Make sure we have contacts
-    if (data->contactsLeft <= 0) return 0;
+    if (!data->hasMoreContacts()) return 0;
 
     // Cache the sphere positions
     Vector3 positionOne = one.getAxis(3);
@@ -413,6 +690,9 @@ unsigned CollisionDetector::boxAndBox(
     CollisionData *data
     )
 {
+    // Make sure we have contacts
+    if (!data->hasMoreContacts()) return 0;
+
     //if (!IntersectionTests::boxAndBox(one, two)) return 0;
 
     // Find the vector between the two centres
@@ -540,6 +820,9 @@ unsigned CollisionDetector::boxAndPoint(
     CollisionData *data
     )
 {
+    // Make sure we have contacts
+    if (!data->hasMoreContacts()) return 0;
+
     // Transform the point into box coordinates
     Vector3 relPt = box.transform.transformInverse(point);
 
@@ -589,6 +872,9 @@ unsigned CollisionDetector::boxAndSphere(
     CollisionData *data
     )
 {
+    // Make sure we have contacts
+    if (!data->hasMoreContacts()) return 0;
+
     // Transform the centre of the sphere into box coordinates
     Vector3 centre = sphere.getAxis(3);
     Vector3 relCentre = box.transform.transformInverse(centre);
@@ -645,8 +931,8 @@ unsigned CollisionDetector::boxAndHalfSpace(
     CollisionData *data
     )
 {
-    // Make sure we have contacts
-    if (data->contactsLeft <= 0) return 0;
+    // Make sure we have room for a contact at every vertex
+    if (!data->hasMoreContacts(8)) return 0;
 
     // Check for intersection
     if (!IntersectionTests::boxAndHalfSpace(box, plane))
@@ -695,10 +981,797 @@ unsigned CollisionDetector::boxAndHalfSpace(
             // Move onto the next contact
             contact++;
             contactsUsed++;
-            if (contactsUsed == (unsigned)data->contactsLeft) return contactsUsed;
+            if (contactsUsed == (unsigned)data->contactsLeft) break;
         }
     }
 
     data->addContacts(contactsUsed);
     return contactsUsed;
 }
+
+/*
+ * Returns the parameter, between 0 and 1, of the point on the segment
+ * from start to end that is closest to the given point.
+ */
+static inline real closestOnSegment(const Vector3 &start,
+                                    const Vector3 &end,
+                                    const Vector3 &point)
+{
+    Vector3 segment = end - start;
+    real lengthSquared = segment.squareMagnitude();
+    if (lengthSquared <= 0) return 0;
+
+    real t = ((point - start) * segment) / lengthSquared;
+    if (t < 0) return 0;
+    if (t > 1) return 1;
+    return t;
+}
+
+static inline real clampUnit(real value)
+{
+    if (value < 0) return 0;
+    if (value > 1) return 1;
+    return value;
+}
+
+/*
+ * Finds the parameters, each between 0 and 1, of the closest points
+ * on the two segments p1-q1 and p2-q2.
+ */
+static void closestBetweenSegments(const Vector3 &p1, const Vector3 &q1,
+                                   const Vector3 &p2, const Vector3 &q2,
+                                   real *s, real *t)
+{
+    Vector3 d1 = q1 - p1;
+    Vector3 d2 = q2 - p2;
+    Vector3 r = p1 - p2;
+    real a = d1 * d1;
+    real e = d2 * d2;
+    real f = d2 * r;
+
+    // Check if either or both segments are really points.
+    if (a <= 0 && e <= 0)
+    {
+        *s = *t = 0;
+        return;
+    }
+    if (a <= 0)
+    {
+        *s = 0;
+        *t = clampUnit(f / e);
+        return;
+    }
+    real c = d1 * r;
+    if (e <= 0)
+    {
+        *t = 0;
+        *s = clampUnit(-c / a);
+        return;
+    }
+
+    // Find the closest point on the first segment to the second
+    // line, unless they are parallel, when any point will do.
+    real b = d1 * d2;
+    real denom = a*e - b*b;
+    *s = (denom > 0) ? clampUnit((b*f - c*e) / denom) : 0;
+
+    // Then the closest point on the second segment to that, going
+    // back to the first segment if it had to be clamped.
+    *t = (b * (*s) + f) / e;
+    if (*t < 0)
+    {
+        *t = 0;
+        *s = clampUnit(-c / a);
+    }
+    else if (*t > 1)
+    {
+        *t = 1;
+        *s = clampUnit((b - c) / a);
+    }
+}
+
+/*
+ * Generates a contact between two spheres, given by their centres
+ * and radii. The capsule routines reduce to this once they have
+ * found the closest points of their segments.
+ */
+static inline unsigned sphereContact(const Vector3 &centreOne, real radiusOne,
+                                     RigidBody *bodyOne,
+                                     const Vector3 &centreTwo, real radiusTwo,
+                                     RigidBody *bodyTwo,
+                                     CollisionData *data)
+{
+    if (!data->hasMoreContacts()) return 0;
+
+    Vector3 midline = centreOne - centreTwo;
+    real size = midline.magnitude();
+    if (size <= 0.0f || size >= radiusOne+radiusTwo) return 0;
+
+    Vector3 normal = midline * (((real)1.0)/size);
+    real penetration = radiusOne + radiusTwo - size;
+
+    // Put the contact point midway through the overlap.
+    Contact* contact = data->contacts;
+    contact->contactNormal = normal;
+    contact->contactPoint = centreTwo + normal * (radiusTwo - penetration*0.5f);
+    contact->penetration = penetration;
+    contact->setBodyData(bodyOne, bodyTwo,
+        data->friction, data->restitution);
+
+    data->addContacts(1);
+    return 1;
+}
+
+unsigned CollisionDetector::capsuleAndHalfSpace(
+    const CollisionCapsule &capsule,
+    const CollisionPlane &plane,
+    CollisionData *data
+    )
+{
+    Vector3 ends[2];
+    capsule.getSegment(ends, ends+1);
+    unsigned endCount = capsule.halfHeight > 0 ? 2 : 1;
+
+    // Treat each end as a sphere.
+    unsigned contactsUsed = 0;
+    for (unsigned i = 0; i < endCount; i++)
+    {
+        if (!data->hasMoreContacts()) break;
+
+        real distance = plane.direction * ends[i] -
+            capsule.radius - plane.offset;
+        if (distance >= 0) continue;
+
+        Contact* contact = data->contacts;
+        contact->contactNormal = plane.direction;
+        contact->penetration = -distance;
+        contact->contactPoint =
+            ends[i] - plane.direction * (distance + capsule.radius);
+        contact->setBodyData(capsule.body, NULL,
+            data->friction, data->restitution);
+
+        data->addContacts(1);
+        contactsUsed++;
+    }
+    return contactsUsed;
+}
+
+unsigned CollisionDetector::capsuleAndSphere(
+    const CollisionCapsule &capsule,
+    const CollisionSphere &sphere,
+    CollisionData *data
+    )
+{
+    Vector3 start, end;
+    capsule.getSegment(&start, &end);
+    Vector3 centre = sphere.getAxis(3);
+
+    // Collide the sphere with the closest point on the segment.
+    real t = closestOnSegment(start, end, centre);
+    return sphereContact(start + (end - start) * t, capsule.radius,
+        capsule.body, centre, sphere.radius, sphere.body, data);
+}
+
+unsigned CollisionDetector::capsuleAndCapsule(
+    const CollisionCapsule &one,
+    const CollisionCapsule &two,
+    CollisionData *data
+    )
+{
+    Vector3 startOne, endOne, startTwo, endTwo;
+    one.getSegment(&startOne, &endOne);
+    two.getSegment(&startTwo, &endTwo);
+    Vector3 axisOne = endOne - startOne;
+    Vector3 axisTwo = endTwo - startTwo;
+
+    // Early out if the segments are too far apart.
+    real reach = one.halfHeight + one.radius + two.halfHeight + two.radius;
+    if ((one.getAxis(3) - two.getAxis(3)).squareMagnitude() > reach*reach)
+    {
+        return 0;
+    }
+
+    // If the capsules lie alongside each other, a single contact
+    // would let them roll, so we put one at each end of the part
+    // of the first capsule that the second one overlaps.
+    real lengthOne = axisOne.squareMagnitude();
+    real lengthTwo = axisTwo.squareMagnitude();
+    if (lengthOne > 0 && lengthTwo > 0 &&
+        (axisOne % axisTwo).squareMagnitude() < 0.0001f*lengthOne*lengthTwo)
+    {
+        real from = closestOnSegment(startOne, endOne, startTwo);
+        real to = closestOnSegment(startOne, endOne, endTwo);
+        if (real_abs(to - from) * real_sqrt(lengthOne) > 0.01f*one.radius)
+        {
+            unsigned contactsUsed = 0;
+            real ends[2] = {from, to};
+            for (unsigned i = 0; i < 2; i++)
+            {
+                Vector3 pointOne = startOne + axisOne * ends[i];
+                real t = closestOnSegment(startTwo, endTwo, pointOne);
+                contactsUsed += sphereContact(pointOne, one.radius, one.body,
+                    startTwo + axisTwo * t, two.radius, two.body, data);
+            }
+            return contactsUsed;
+        }
+    }
+
+    real s, t;
+    closestBetweenSegments(startOne, endOne, startTwo, endTwo, &s, &t);
+    return sphereContact(startOne + axisOne * s, one.radius, one.body,
+        startTwo + axisTwo * t, two.radius, two.body, data);
+}
+
+/*
+ * Clips the segment from start to end against the box (given by its
+ * half-sizes, in its own coordinates), returning false if it misses.
+ * Otherwise the parameters of the part of the segment inside the box
+ * are returned.
+ */
+static inline bool clipSegmentToBox(const Vector3 &halfSize,
+                                    const Vector3 &start,
+                                    const Vector3 &end,
+                                    real *enter, real *exit)
+{
+    Vector3 direction = end - start;
+    *enter = 0;
+    *exit = 1;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        if (real_abs(direction[i]) <= real_epsilon)
+        {
+            if (real_abs(start[i]) > halfSize[i]) return false;
+            continue;
+        }
+
+        real inverse = ((real)1) / direction[i];
+        real t1 = (-halfSize[i] - start[i]) * inverse;
+        real t2 = (halfSize[i] - start[i]) * inverse;
+        if (t1 > t2) { real swap = t1; t1 = t2; t2 = swap; }
+        if (t1 > *enter) *enter = t1;
+        if (t2 < *exit) *exit = t2;
+        if (*enter > *exit) return false;
+    }
+    return true;
+}
+
+/*
+ * Generates a contact between a point of the capsule's segment and
+ * the closest point of the box, both in the box's coordinates.
+ */
+static inline unsigned capsuleContactOnBox(const CollisionCapsule &capsule,
+                                           const CollisionBox &box,
+                                           const Vector3 &segmentPoint,
+                                           const Vector3 &boxPoint,
+                                           CollisionData *data)
+{
+    if (!data->hasMoreContacts()) return 0;
+
+    Vector3 separation = segmentPoint - boxPoint;
+    real distance = separation.magnitude();
+    if (distance <= 0 || distance >= capsule.radius) return 0;
+
+    Contact* contact = data->contacts;
+    contact->contactNormal = box.getTransform().transformDirection(
+        separation * (((real)1.0)/distance));
+    contact->contactPoint = box.getTransform().transform(boxPoint);
+    contact->penetration = capsule.radius - distance;
+    contact->setBodyData(capsule.body, box.body,
+        data->friction, data->restitution);
+
+    data->addContacts(1);
+    return 1;
+}
+
+unsigned CollisionDetector::capsuleAndBox(
+    const CollisionCapsule &capsule,
+    const CollisionBox &box,
+    CollisionData *data
+    )
+{
+    if (!data->hasMoreContacts()) return 0;
+
+    // Early out if the capsule can't reach the box.
+    real reach = capsule.halfHeight + capsule.radius + box.halfSize.magnitude();
+    if ((capsule.getAxis(3) - box.getAxis(3)).squareMagnitude() > reach*reach)
+    {
+        return 0;
+    }
+
+    // Work in the box's coordinates.
+    Vector3 start, end;
+    capsule.getSegment(&start, &end);
+    start = box.getTransform().transformInverse(start);
+    end = box.getTransform().transformInverse(end);
+    const Vector3 &halfSize = box.halfSize;
+
+    real enter, exit;
+    if (clipSegmentToBox(halfSize, start, end, &enter, &exit))
+    {
+        // The segment is inside the box. Take the middle of the part
+        // that is inside, and push it out through the nearest face.
+        Vector3 point = start + (end - start) * ((enter + exit) * 0.5f);
+        unsigned axis = 0;
+        real depth = halfSize[0] - real_abs(point[0]);
+        for (unsigned i = 1; i < 3; i++)
+        {
+            real axisDepth = halfSize[i] - real_abs(point[i]);
+            if (axisDepth < depth)
+            {
+                depth = axisDepth;
+                axis = i;
+            }
+        }
+
+        Vector3 normal;
+        normal[axis] = point[axis] < 0 ? -1 : 1;
+        point[axis] = normal[axis] * halfSize[axis];
+
+        Contact* contact = data->contacts;
+        contact->contactNormal = box.getTransform().transformDirection(normal);
+        contact->contactPoint = box.getTransform().transform(point);
+        contact->penetration = capsule.radius + depth;
+        contact->setBodyData(capsule.body, box.body,
+            data->friction, data->restitution);
+
+        data->addContacts(1);
+        return 1;
+    }
+
+    // The segment is outside the box. The closest points are either
+    // at one end of the segment, or between the segment and one of
+    // the box's edges. We test the ends first, so a capsule lying on
+    // a face is supported at both ends.
+    unsigned contactsUsed = 0;
+    real closestEnd = REAL_MAX;
+    Vector3 ends[2] = {start, end};
+    for (unsigned i = 0; i < 2; i++)
+    {
+        Vector3 boxPoint = closestPointOnBox(halfSize, ends[i]);
+        real distance = (ends[i] - boxPoint).squareMagnitude();
+        if (distance < closestEnd) closestEnd = distance;
+        contactsUsed += capsuleContactOnBox(capsule, box,
+            ends[i], boxPoint, data);
+    }
+
+    // Then find the closest edge.
+    real closestEdge = REAL_MAX;
+    Vector3 edgeSegmentPoint, edgeBoxPoint;
+    for (unsigned axis = 0; axis < 3; axis++)
+    {
+        unsigned u = (axis+1)%3, v = (axis+2)%3;
+        for (unsigned corner = 0; corner < 4; corner++)
+        {
+            Vector3 edgeStart, edgeEnd;
+            edgeStart[u] = edgeEnd[u] = (corner & 1) ? halfSize[u] : -halfSize[u];
+            edgeStart[v] = edgeEnd[v] = (corner & 2) ? halfSize[v] : -halfSize[v];
+            edgeStart[axis] = -halfSize[axis];
+            edgeEnd[axis] = halfSize[axis];
+
+            real s, t;
+            closestBetweenSegments(start, end, edgeStart, edgeEnd, &s, &t);
+            Vector3 segmentPoint = start + (end - start) * s;
+            Vector3 boxPoint = edgeStart + (edgeEnd - edgeStart) * t;
+            real distance = (segmentPoint - boxPoint).squareMagnitude();
+            if (distance < closestEdge)
+            {
+                closestEdge = distance;
+                edgeSegmentPoint = segmentPoint;
+                edgeBoxPoint = boxPoint;
+            }
+        }
+    }
+
+    // The edge only matters if it is closer than either end.
+    if (closestEdge < closestEnd)
+    {
+        contactsUsed += capsuleContactOnBox(capsule, box,
+            edgeSegmentPoint, edgeBoxPoint, data);
+    }
+    return contactsUsed;
+}
+
+/*
+ * Returns the point on the triangle abc closest to the given point.
+ */
+static Vector3 closestPointOnTriangle(const Vector3 &point,
+                                      const Vector3 &a,
+                                      const Vector3 &b,
+                                      const Vector3 &c)
+{
+    Vector3 ab = b - a, ac = c - a, ap = point - a;
+
+    // Check the vertex and edge regions in turn.
+    real d1 = ab * ap, d2 = ac * ap;
+    if (d1 <= 0 && d2 <= 0) return a;
+
+    Vector3 bp = point - b;
+    real d3 = ab * bp, d4 = ac * bp;
+    if (d3 >= 0 && d4 <= d3) return b;
+
+    real vc = d1*d4 - d3*d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+    {
+        return a + ab * (d1 / (d1 - d3));
+    }
+
+    Vector3 cp = point - c;
+    real d5 = ab * cp, d6 = ac * cp;
+    if (d6 >= 0 && d5 <= d6) return c;
+
+    real vb = d5*d2 - d1*d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+    {
+        return a + ac * (d2 / (d2 - d6));
+    }
+
+    real va = d3*d6 - d5*d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+    {
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    // The point is over the face.
+    real denom = ((real)1) / (va + vb + vc);
+    return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+/*
+ * Returns true if the point, projected along the triangle's normal,
+ * lies inside the triangle.
+ */
+static inline bool projectsIntoTriangle(const Vector3 &point,
+                                        const Vector3 *triangle,
+                                        const Vector3 &normal)
+{
+    for (unsigned i = 0; i < 3; i++)
+    {
+        const Vector3 &a = triangle[i];
+        const Vector3 &b = triangle[(i+1)%3];
+        if (((b - a) % (point - a)) * normal < 0) return false;
+    }
+    return true;
+}
+
+/*
+ * Writes a contact between a body and static geometry.
+ */
+static inline unsigned staticContact(RigidBody *body,
+                                     const Vector3 &normal,
+                                     const Vector3 &point,
+                                     real penetration,
+                                     CollisionData *data)
+{
+    if (!data->hasMoreContacts()) return 0;
+
+    Contact* contact = data->contacts;
+    contact->contactNormal = normal;
+    contact->contactPoint = point;
+    contact->penetration = penetration;
+    contact->setBodyData(body, NULL,
+        data->friction, data->restitution);
+
+    data->addContacts(1);
+    return 1;
+}
+
+/*
+ * Generates the contact between a sphere, given by its centre and
+ * radius, and a triangle with the given unit normal.
+ */
+static unsigned sphereContactOnTriangle(RigidBody *body,
+                                        const Vector3 &centre,
+                                        real radius,
+                                        const Vector3 *triangle,
+                                        const Vector3 &normal,
+                                        CollisionData *data)
+{
+    real height = normal * (centre - triangle[0]);
+    if (height >= radius || height <= -radius) return 0;
+
+    // If the centre is behind the triangle, push it out of the front.
+    if (height < 0)
+    {
+        if (!projectsIntoTriangle(centre, triangle, normal)) return 0;
+        return staticContact(body, normal, centre - normal * height,
+            radius - height, data);
+    }
+
+    Vector3 closest = closestPointOnTriangle(centre,
+        triangle[0], triangle[1], triangle[2]);
+    Vector3 separation = centre - closest;
+    real distance = separation.magnitude();
+    if (distance >= radius) return 0;
+
+    Vector3 contactNormal = normal;
+    if (distance > 0) contactNormal = separation * (((real)1.0)/distance);
+    return staticContact(body, contactNormal, closest,
+        radius - distance, data);
+}
+
+/*
+ * Returns the unit normal of the front of the triangle, or the zero
+ * vector if the triangle is degenerate.
+ */
+static inline Vector3 triangleNormal(const Vector3 *triangle)
+{
+    Vector3 normal = (triangle[1] - triangle[0]) % (triangle[2] - triangle[0]);
+    real length = normal.magnitude();
+    if (length <= 0) return Vector3();
+    return normal * (((real)1.0)/length);
+}
+
+/*
+ * Finds the extent of a triangle along the given axis.
+ */
+static inline void projectTriangle(const Vector3 *triangle,
+                                   const Vector3 &axis,
+                                   real *least, real *most)
+{
+    *least = *most = axis * triangle[0];
+    for (unsigned i = 1; i < 3; i++)
+    {
+        real projection = axis * triangle[i];
+        if (projection < *least) *least = projection;
+        if (projection > *most) *most = projection;
+    }
+}
+
+unsigned CollisionDetector::sphereAndTriangle(
+    const CollisionSphere &sphere,
+    const Vector3 *triangle,
+    CollisionData *data
+    )
+{
+    if (!data->hasMoreContacts()) return 0;
+
+    Vector3 normal = triangleNormal(triangle);
+    if (normal.squareMagnitude() == 0) return 0;
+
+    return sphereContactOnTriangle(sphere.body, sphere.getAxis(3),
+        sphere.radius, triangle, normal, data);
+}
+
+unsigned CollisionDetector::capsuleAndTriangle(
+    const CollisionCapsule &capsule,
+    const Vector3 *triangle,
+    CollisionData *data
+    )
+{
+    if (!data->hasMoreContacts()) return 0;
+
+    Vector3 normal = triangleNormal(triangle);
+    if (normal.squareMagnitude() == 0) return 0;
+
+    Vector3 ends[2];
+    capsule.getSegment(ends, ends+1);
+    real radius = capsule.radius;
+    real heights[2] = {
+        normal * (ends[0] - triangle[0]),
+        normal * (ends[1] - triangle[0])
+    };
+
+    // Check if the capsule is entirely in front or behind.
+    if (heights[0] >= radius && heights[1] >= radius) return 0;
+    if (heights[0] <= -radius && heights[1] <= -radius) return 0;
+
+    // If the segment passes through the triangle, push the end that
+    // is behind it back out of the front.
+    if (heights[0] * heights[1] < 0)
+    {
+        real t = heights[0] / (heights[0] - heights[1]);
+        Vector3 crossing = ends[0] + (ends[1] - ends[0]) * t;
+        if (projectsIntoTriangle(crossing, triangle, normal))
+        {
+            unsigned behind = heights[0] < 0 ? 0 : 1;
+            return staticContact(capsule.body, normal,
+                ends[behind] - normal * heights[behind],
+                radius - heights[behind], data);
+        }
+    }
+
+    // Treat each end as a sphere.
+    unsigned contactsUsed = 0;
+    real closestEnd = REAL_MAX;
+    for (unsigned i = 0; i < 2; i++)
+    {
+        Vector3 closest = closestPointOnTriangle(ends[i],
+            triangle[0], triangle[1], triangle[2]);
+        real distance = (ends[i] - closest).squareMagnitude();
+        if (distance < closestEnd) closestEnd = distance;
+        contactsUsed += sphereContactOnTriangle(capsule.body, ends[i],
+            radius, triangle, normal, data);
+    }
+
+    // Then check if the middle of the capsule is closer to one of
+    // the triangle's edges than either end.
+    real closestEdge = REAL_MAX;
+    Vector3 segmentPoint, edgePoint;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        const Vector3 &a = triangle[i];
+        const Vector3 &b = triangle[(i+1)%3];
+        real s, t;
+        closestBetweenSegments(ends[0], ends[1], a, b, &s, &t);
+        if (s <= 0 || s >= 1) continue;
+
+        Vector3 onSegment = ends[0] + (ends[1] - ends[0]) * s;
+        Vector3 onEdge = a + (b - a) * t;
+        real distance = (onSegment - onEdge).squareMagnitude();
+        if (distance < closestEdge)
+        {
+            closestEdge = distance;
+            segmentPoint = onSegment;
+            edgePoint = onEdge;
+        }
+    }
+
+    if (closestEdge < closestEnd && closestEdge < radius*radius &&
+        normal * (segmentPoint - triangle[0]) > 0)
+    {
+        real distance = real_sqrt(closestEdge);
+        Vector3 contactNormal = normal;
+        if (distance > 0)
+        {
+            contactNormal = (segmentPoint - edgePoint) * (((real)1.0)/distance);
+        }
+        contactsUsed += staticContact(capsule.body, contactNormal,
+            edgePoint, radius - distance, data);
+    }
+    return contactsUsed;
+}
+
+unsigned CollisionDetector::boxAndTriangle(
+    const CollisionBox &box,
+    const Vector3 *triangle,
+    CollisionData *data
+    )
+{
+    if (!data->hasMoreContacts()) return 0;
+
+    Vector3 normal = triangleNormal(triangle);
+    if (normal.squareMagnitude() == 0) return 0;
+
+    // Check if the box is entirely in front or behind.
+    real projectedRadius = transformToAxis(box, normal);
+    real height = normal * (box.getAxis(3) - triangle[0]);
+    if (height >= projectedRadius || height <= -projectedRadius) return 0;
+
+    // Then check the axes of the box, and the axes across each edge
+    // of the box and each edge of the triangle, as boxAndBox does.
+    // If any of them separates the two there is no contact. Keep
+    // track of how far the box would have to move along each, so we
+    // know whether the closest way out is across a pair of edges.
+    Vector3 centre = box.getAxis(3);
+    real least, most;
+    real facePen = projectedRadius - height;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        Vector3 axis = box.getAxis(i);
+        projectTriangle(triangle, axis, &least, &most);
+        real middle = axis * centre;
+        real radius = box.halfSize[i];
+        if (least >= middle + radius || most <= middle - radius) return 0;
+
+        real pen = most - (middle - radius);
+        if (middle + radius - least < pen) pen = middle + radius - least;
+        if (pen < facePen) facePen = pen;
+    }
+
+    real edgePen = REAL_MAX;
+    unsigned edgeAxisIndex = 0, edgeIndex = 0;
+    Vector3 edgeAxis;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        for (unsigned j = 0; j < 3; j++)
+        {
+            Vector3 axis = box.getAxis(i) %
+                (triangle[(j+1)%3] - triangle[j]);
+
+            // Parallel edges don't give an axis.
+            if (axis.squareMagnitude() < 0.0001) continue;
+            axis.normalise();
+
+            // The box should be pushed out of the front of the
+            // triangle, or off the edge if the axis lies in it.
+            real facing = axis * normal;
+            if (facing < 0 || (facing == 0 &&
+                axis * (triangle[j] - triangle[(j+2)%3]) < 0))
+            {
+                axis.invert();
+            }
+
+            projectTriangle(triangle, axis, &least, &most);
+            real middle = axis * centre;
+            real radius = transformToAxis(box, axis);
+            if (least >= middle + radius || most <= middle - radius) return 0;
+
+            real pen = most - (middle - radius);
+            if (pen < edgePen)
+            {
+                edgePen = pen;
+                edgeAxisIndex = i;
+                edgeIndex = j;
+                edgeAxis = axis;
+            }
+        }
+    }
+
+    // Go through each vertex of the box, and generate a contact if it
+    // is behind the triangle, as for a half-space.
+    static real mults[8][3] = {{1,1,1},{-1,1,1},{1,-1,1},{-1,-1,1},
+                               {1,1,-1},{-1,1,-1},{1,-1,-1},{-1,-1,-1}};
+
+    unsigned contactsUsed = 0;
+    for (unsigned i = 0; i < 8; i++)
+    {
+        Vector3 vertexPos(mults[i][0], mults[i][1], mults[i][2]);
+        vertexPos.componentProductUpdate(box.halfSize);
+        vertexPos = box.transform.transform(vertexPos);
+
+        real vertexDistance = normal * (vertexPos - triangle[0]);
+        if (vertexDistance >= 0) continue;
+        if (!projectsIntoTriangle(vertexPos, triangle, normal)) continue;
+
+        contactsUsed += staticContact(box.body, normal,
+            vertexPos - normal * (vertexDistance * 0.5f),
+            -vertexDistance, data);
+    }
+
+    // Then generate a contact for each vertex of the triangle inside
+    // the box, pushing the box out along its shallowest axis.
+    for (unsigned i = 0; i < 3; i++)
+    {
+        Vector3 relPt = box.transform.transformInverse(triangle[i]);
+
+        real minDepth = REAL_MAX;
+        unsigned axis = 0;
+        for (unsigned j = 0; j < 3; j++)
+        {
+            real depth = box.halfSize[j] - real_abs(relPt[j]);
+            if (depth < minDepth)
+            {
+                minDepth = depth;
+                axis = j;
+            }
+        }
+        if (minDepth <= 0) continue;
+
+        Vector3 contactNormal =
+            box.getAxis(axis) * ((relPt[axis] < 0) ? 1 : -1);
+        contactsUsed += staticContact(box.body, contactNormal,
+            triangle[i], minDepth, data);
+    }
+
+    // Finally, if the box would move least across a pair of edges,
+    // or the two overlap and neither test above found anything, the
+    // box is resting on an edge of the triangle, such as the ridge
+    // between two triangles of a mesh.
+    if (edgePen < facePen || (contactsUsed == 0 && edgePen < REAL_MAX))
+    {
+        // Find which of the four box edges along the axis is the
+        // deepest, by finding the point in the middle of it.
+        Vector3 ptOnEdge = box.halfSize;
+        for (unsigned i = 0; i < 3; i++)
+        {
+            if (i == edgeAxisIndex) ptOnEdge[i] = 0;
+            else if (box.getAxis(i) * edgeAxis > 0) ptOnEdge[i] = -ptOnEdge[i];
+        }
+        ptOnEdge = box.transform * ptOnEdge;
+
+        // And contact at the closest points of the two edges.
+        Vector3 boxEdge = box.getAxis(edgeAxisIndex) *
+            box.halfSize[edgeAxisIndex];
+        const Vector3 &a = triangle[edgeIndex];
+        const Vector3 &b = triangle[(edgeIndex+1)%3];
+        real s, t;
+        closestBetweenSegments(ptOnEdge - boxEdge, ptOnEdge + boxEdge,
+            a, b, &s, &t);
+        Vector3 onBox = ptOnEdge - boxEdge + boxEdge * (s * 2);
+        Vector3 onTriangle = a + (b - a) * t;
+
+        contactsUsed += staticContact(box.body, edgeAxis,
+            onBox * 0.5f + onTriangle * 0.5f, edgePen, data);
+    }
+    return contactsUsed;
+}
@@ -0,0 +1,629 @@
+/*
+ * Implementation file for the static triangle mesh and heightfield
+ * colliders.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <cyclone/collide_mesh.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace cyclone;
+
+/** The most triangles held in a leaf of a mesh hierarchy. */
+static const unsigned maxLeafTriangles = 4;
+
+/** Marks a mesh hierarchy node as a leaf. */
+static const unsigned leafFlag = 0x80000000;
+
+/** The number of cells along each side of a heightfield block. */
+static const unsigned blockCells = 4;
+
+/** The largest quantized value. */
+static const real quantizedMax = (real)65535;
+
+/*
+ * Returns the number of quantization steps per unit to fit the given
+ * extent into 16 bits.
+ */
+static inline real quantizationFor(real extent)
+{
+    if (extent <= 0) return 0;
+    return quantizedMax / extent;
+}
+
+/*
+ * Quantizes a value, already relative to the lower bound and scaled,
+ * rounding in the given direction and clamping to 16 bits.
+ */
+static inline unsigned short quantizeValue(real value, bool roundUp)
+{
+    value = roundUp ? std::ceil(value) : std::floor(value);
+    if (value < 0) return 0;
+    if (value > quantizedMax) return 65535;
+    return (unsigned short)value;
+}
+
+// Triangle mesh implementation
+
+/*
+ * Orders triangles by the position of their centres along an axis.
+ */
+struct CentreLess
+{
+    const std::vector<Vector3> &centres;
+    unsigned axis;
+
+    CentreLess(const std::vector<Vector3> &centres, unsigned axis)
+        : centres(centres), axis(axis) {}
+
+    bool operator()(unsigned a, unsigned b) const
+    {
+        return centres[a][axis] < centres[b][axis];
+    }
+};
+
+void CollisionTriangleMesh::quantize(const Vector3 &point, bool roundUp,
+                                     unsigned short *result) const
+{
+    for (unsigned i = 0; i < 3; i++)
+    {
+        result[i] = quantizeValue(
+            (point[i] - boundsMin[i]) * quantization[i], roundUp);
+    }
+}
+
+void CollisionTriangleMesh::setMesh(const Vector3 *vertices,
+                                    unsigned vertexCount,
+                                    const unsigned *indices,
+                                    unsigned triangleCount)
+{
+    this->vertices.resize(vertexCount * 3);
+    for (unsigned i = 0; i < vertexCount; i++)
+    {
+        this->vertices[i*3] = vertices[i].x;
+        this->vertices[i*3+1] = vertices[i].y;
+        this->vertices[i*3+2] = vertices[i].z;
+    }
+    nodes.clear();
+    this->indices.clear();
+    if (triangleCount == 0 || vertexCount == 0) return;
+
+    // Find the bounds of the whole mesh to quantize against.
+    boundsMin = vertices[0];
+    Vector3 boundsMax = vertices[0];
+    for (unsigned i = 1; i < vertexCount; i++)
+    {
+        for (unsigned j = 0; j < 3; j++)
+        {
+            if (vertices[i][j] < boundsMin[j]) boundsMin[j] = vertices[i][j];
+            if (vertices[i][j] > boundsMax[j]) boundsMax[j] = vertices[i][j];
+        }
+    }
+    for (unsigned j = 0; j < 3; j++)
+    {
+        quantization[j] = quantizationFor(boundsMax[j] - boundsMin[j]);
+    }
+
+    // Build the hierarchy over the triangle centres. The triangles
+    // are sorted into leaf order as we go.
+    std::vector<Vector3> centres(triangleCount);
+    std::vector<unsigned> order(triangleCount);
+    for (unsigned i = 0; i < triangleCount; i++)
+    {
+        const unsigned *tri = indices + i*3;
+        centres[i] = (vertices[tri[0]] + vertices[tri[1]] + vertices[tri[2]])
+            * (((real)1.0)/3);
+        order[i] = i;
+    }
+    this->indices.resize(triangleCount * 3);
+    nodes.reserve(triangleCount / 2 + 1);
+    buildNode(order, centres, 0, triangleCount);
+
+    // Store the triangles in the order the leaves refer to them.
+    for (unsigned i = 0; i < triangleCount; i++)
+    {
+        const unsigned *tri = indices + order[i]*3;
+        this->indices[i*3] = tri[0];
+        this->indices[i*3+1] = tri[1];
+        this->indices[i*3+2] = tri[2];
+    }
+
+    // Then fill in the bounds of each leaf, and of each internal
+    // node from its children. Children follow their parents, so we
+    // work backwards.
+    for (unsigned n = (unsigned)nodes.size(); n-- > 0; )
+    {
+        QuantizedNode &node = nodes[n];
+        if (node.data & leafFlag)
+        {
+            unsigned first = node.data & 0x0fffffff;
+            unsigned count = (node.data >> 28) & 0x7;
+            Vector3 lower(REAL_MAX, REAL_MAX, REAL_MAX);
+            Vector3 upper(-REAL_MAX, -REAL_MAX, -REAL_MAX);
+            for (unsigned i = 0; i < count; i++)
+            {
+                Vector3 triangle[3];
+                getTriangle(first + i, triangle);
+                for (unsigned v = 0; v < 3; v++)
+                {
+                    for (unsigned j = 0; j < 3; j++)
+                    {
+                        if (triangle[v][j] < lower[j]) lower[j] = triangle[v][j];
+                        if (triangle[v][j] > upper[j]) upper[j] = triangle[v][j];
+                    }
+                }
+            }
+            quantize(lower, false, node.min);
+            quantize(upper, true, node.max);
+        }
+        else
+        {
+            // The second child follows the first child's subtree.
+            const QuantizedNode &left = nodes[n+1];
+            const QuantizedNode &right =
+                nodes[(left.data & leafFlag) ? n+2 : left.data];
+            for (unsigned j = 0; j < 3; j++)
+            {
+                node.min[j] = std::min(left.min[j], right.min[j]);
+                node.max[j] = std::max(left.max[j], right.max[j]);
+            }
+        }
+    }
+}
+
+unsigned CollisionTriangleMesh::buildNode(std::vector<unsigned> &order,
+                                          const std::vector<Vector3> &centres,
+                                          unsigned begin, unsigned end)
+{
+    unsigned index = (unsigned)nodes.size();
+    nodes.push_back(QuantizedNode());
+
+    unsigned count = end - begin;
+    if (count <= maxLeafTriangles)
+    {
+        nodes[index].data = leafFlag | (count << 28) | begin;
+        return index;
+    }
+
+    // Split at the median centre along the longest axis.
+    Vector3 lower = centres[order[begin]], upper = lower;
+    for (unsigned i = begin + 1; i < end; i++)
+    {
+        const Vector3 &centre = centres[order[i]];
+        for (unsigned j = 0; j < 3; j++)
+        {
+            if (centre[j] < lower[j]) lower[j] = centre[j];
+            if (centre[j] > upper[j]) upper[j] = centre[j];
+        }
+    }
+    unsigned axis = 0;
+    Vector3 extent = upper - lower;
+    if (extent.y > extent[axis]) axis = 1;
+    if (extent.z > extent[axis]) axis = 2;
+
+    unsigned middle = begin + count/2;
+    std::nth_element(order.begin() + begin, order.begin() + middle,
+        order.begin() + end, CentreLess(centres, axis));
+
+    buildNode(order, centres, begin, middle);
+    buildNode(order, centres, middle, end);
+    nodes[index].data = (unsigned)nodes.size();
+    return index;
+}
+
+void CollisionTriangleMesh::getTriangle(unsigned index, Vector3 *triangle) const
+{
+    const unsigned *tri = &indices[index*3];
+    for (unsigned i = 0; i < 3; i++)
+    {
+        const real *vertex = &vertices[tri[i]*3];
+        triangle[i] = Vector3(vertex[0], vertex[1], vertex[2]);
+    }
+}
+
+void CollisionTriangleMesh::findTriangles(const Vector3 &min,
+                                          const Vector3 &max,
+                                          std::vector<unsigned> *results) const
+{
+    if (nodes.empty()) return;
+
+    // Reject boxes outside the mesh, then quantize the rest, rounding
+    // outwards so we never miss a triangle.
+    for (unsigned j = 0; j < 3; j++)
+    {
+        if (max[j] < boundsMin[j]) return;
+        if (quantization[j] > 0 &&
+            (min[j] - boundsMin[j]) * quantization[j] > quantizedMax) return;
+    }
+    unsigned short queryMin[3], queryMax[3];
+    quantize(min, false, queryMin);
+    quantize(max, true, queryMax);
+
+    // Walk the nodes in order, skipping subtrees that don't overlap.
+    unsigned count = (unsigned)nodes.size();
+    unsigned n = 0;
+    while (n < count)
+    {
+        const QuantizedNode &node = nodes[n];
+        bool overlap =
+            node.min[0] <= queryMax[0] && node.max[0] >= queryMin[0] &&
+            node.min[1] <= queryMax[1] && node.max[1] >= queryMin[1] &&
+            node.min[2] <= queryMax[2] && node.max[2] >= queryMin[2];
+
+        if (node.data & leafFlag)
+        {
+            if (overlap)
+            {
+                unsigned first = node.data & 0x0fffffff;
+                unsigned leafCount = (node.data >> 28) & 0x7;
+                for (unsigned i = 0; i < leafCount; i++)
+                {
+                    results->push_back(first + i);
+                }
+            }
+            n++;
+        }
+        else if (overlap) n++;
+        else n = node.data;
+    }
+}
+
+unsigned CollisionTriangleMesh::getMemoryUsed() const
+{
+    return (unsigned)(vertices.size() * sizeof(real) +
+        indices.size() * sizeof(unsigned) +
+        nodes.size() * sizeof(QuantizedNode));
+}
+
+// Heightfield implementation
+
+CollisionHeightfield::CollisionHeightfield()
+:
+columns(0),
+rows(0),
+spacingX(1),
+spacingZ(1),
+minHeight(0),
+quantization(0)
+{
+}
+
+void CollisionHeightfield::setHeights(const real *heights,
+                                      unsigned columns, unsigned rows,
+                                      const Vector3 &origin,
+                                      real spacingX, real spacingZ)
+{
+    this->heights.assign(heights, heights + columns*rows);
+    this->columns = columns;
+    this->rows = rows;
+    this->origin = origin;
+    this->spacingX = spacingX;
+    this->spacingZ = spacingZ;
+    bounds.clear();
+    levelOffset.clear();
+    levelColumns.clear();
+    levelRows.clear();
+    if (columns < 2 || rows < 2) return;
+
+    real maxHeight = minHeight = heights[0];
+    for (unsigned i = 1; i < columns*rows; i++)
+    {
+        if (heights[i] < minHeight) minHeight = heights[i];
+        if (heights[i] > maxHeight) maxHeight = heights[i];
+    }
+    quantization = quantizationFor(maxHeight - minHeight);
+
+    // Build the bottom level from the samples in each block.
+    unsigned cellColumns = columns - 1, cellRows = rows - 1;
+    unsigned levelWidth = (cellColumns + blockCells - 1) / blockCells;
+    unsigned levelDepth = (cellRows + blockCells - 1) / blockCells;
+    levelOffset.push_back(0);
+    levelColumns.push_back(levelWidth);
+    levelRows.push_back(levelDepth);
+    bounds.resize(levelWidth * levelDepth * 2);
+    for (unsigned bz = 0; bz < levelDepth; bz++)
+    {
+        for (unsigned bx = 0; bx < levelWidth; bx++)
+        {
+            unsigned endX = std::min((bx+1)*blockCells, cellColumns);
+            unsigned endZ = std::min((bz+1)*blockCells, cellRows);
+            real lower = REAL_MAX, upper = -REAL_MAX;
+            for (unsigned z = bz*blockCells; z <= endZ; z++)
+            {
+                for (unsigned x = bx*blockCells; x <= endX; x++)
+                {
+                    real height = getHeight(x, z);
+                    if (height < lower) lower = height;
+                    if (height > upper) upper = height;
+                }
+            }
+            unsigned short *node = &bounds[(bz*levelWidth + bx)*2];
+            node[0] = quantizeValue((lower - minHeight) * quantization, false);
+            node[1] = quantizeValue((upper - minHeight) * quantization, true);
+        }
+    }
+
+    // Then each level above, from two by two groups below, until we
+    // have a single node.
+    while (levelWidth > 1 || levelDepth > 1)
+    {
+        unsigned below = levelOffset.back();
+        unsigned belowWidth = levelWidth, belowDepth = levelDepth;
+        levelWidth = (levelWidth + 1) / 2;
+        levelDepth = (levelDepth + 1) / 2;
+
+        unsigned offset = (unsigned)bounds.size() / 2;
+        levelOffset.push_back(offset);
+        levelColumns.push_back(levelWidth);
+        levelRows.push_back(levelDepth);
+        bounds.resize((offset + levelWidth*levelDepth) * 2);
+
+        for (unsigned z = 0; z < levelDepth; z++)
+        {
+            for (unsigned x = 0; x < levelWidth; x++)
+            {
+                unsigned short lower = 65535, upper = 0;
+                for (unsigned cz = z*2; cz < z*2+2 && cz < belowDepth; cz++)
+                {
+                    for (unsigned cx = x*2; cx < x*2+2 && cx < belowWidth; cx++)
+                    {
+                        const unsigned short *child =
+                            &bounds[(below + cz*belowWidth + cx)*2];
+                        lower = std::min(lower, child[0]);
+                        upper = std::max(upper, child[1]);
+                    }
+                }
+                unsigned short *node = &bounds[(offset + z*levelWidth + x)*2];
+                node[0] = lower;
+                node[1] = upper;
+            }
+        }
+    }
+}
+
+void CollisionHeightfield::getTriangle(unsigned index, Vector3 *triangle) const
+{
+    unsigned cell = index / 2;
+    unsigned x = cell % (columns - 1);
+    unsigned z = cell / (columns - 1);
+
+    // Each cell is split along the diagonal from (x+1, z) to
+    // (x, z+1), with both halves facing up.
+    static const unsigned corners[2][3][2] = {
+        {{0,0}, {0,1}, {1,0}},
+        {{1,0}, {0,1}, {1,1}}
+    };
+    const unsigned (*half)[2] = corners[index & 1];
+    for (unsigned i = 0; i < 3; i++)
+    {
+        unsigned cx = x + half[i][0], cz = z + half[i][1];
+        triangle[i] = Vector3(
+            origin.x + cx * spacingX,
+            origin.y + getHeight(cx, cz),
+            origin.z + cz * spacingZ
+            );
+    }
+}
+
+void CollisionHeightfield::findInNode(unsigned level,
+                                      unsigned column, unsigned row,
+                                      const unsigned *cellRange,
+                                      const unsigned short *heightRange,
+                                      real minY, real maxY,
+                                      std::vector<unsigned> *results) const
+{
+    // Check the node's cells overlap the query.
+    unsigned span = blockCells << level;
+    unsigned startX = column * span, startZ = row * span;
+    if (startX > cellRange[1] || startX + span <= cellRange[0]) return;
+    if (startZ > cellRange[3] || startZ + span <= cellRange[2]) return;
+
+    // Check its heights overlap.
+    const unsigned short *node =
+        &bounds[(levelOffset[level] + row*levelColumns[level] + column)*2];
+    if (node[0] > heightRange[1] || node[1] < heightRange[0]) return;
+
+    if (level > 0)
+    {
+        for (unsigned z = row*2; z < row*2+2 && z < levelRows[level-1]; z++)
+        {
+            for (unsigned x = column*2; x < column*2+2 &&
+                x < levelColumns[level-1]; x++)
+            {
+                findInNode(level-1, x, z, cellRange, heightRange,
+                    minY, maxY, results);
+            }
+        }
+        return;
+    }
+
+    // We're at a block, so check each of its cells in the query.
+    unsigned endX = std::min(startX + span - 1, cellRange[1]);
+    unsigned endZ = std::min(startZ + span - 1, cellRange[3]);
+    for (unsigned z = std::max(startZ, cellRange[2]); z <= endZ; z++)
+    {
+        for (unsigned x = std::max(startX, cellRange[0]); x <= endX; x++)
+        {
+            real h00 = getHeight(x, z), h10 = getHeight(x+1, z);
+            real h01 = getHeight(x, z+1), h11 = getHeight(x+1, z+1);
+            real lower = std::min(std::min(h00, h10), std::min(h01, h11));
+            real upper = std::max(std::max(h00, h10), std::max(h01, h11));
+            if (lower > maxY || upper < minY) continue;
+
+            unsigned cell = z * (columns - 1) + x;
+            results->push_back(cell*2);
+            results->push_back(cell*2 + 1);
+        }
+    }
+}
+
+void CollisionHeightfield::findTriangles(const Vector3 &min,
+                                         const Vector3 &max,
+                                         std::vector<unsigned> *results) const
+{
+    if (levelOffset.empty()) return;
+
+    // Find the range of cells under the box.
+    real lowX = (min.x - origin.x) / spacingX;
+    real highX = (max.x - origin.x) / spacingX;
+    real lowZ = (min.z - origin.z) / spacingZ;
+    real highZ = (max.z - origin.z) / spacingZ;
+    real cellColumns = (real)(columns - 1), cellRows = (real)(rows - 1);
+    if (highX < 0 || lowX > cellColumns) return;
+    if (highZ < 0 || lowZ > cellRows) return;
+
+    unsigned cellRange[4] = {
+        lowX < 0 ? 0 : (unsigned)lowX,
+        highX >= cellColumns ? columns - 2 : (unsigned)highX,
+        lowZ < 0 ? 0 : (unsigned)lowZ,
+        highZ >= cellRows ? rows - 2 : (unsigned)highZ
+    };
+
+    // Then the range of heights, relative to the origin.
+    real minY = min.y - origin.y, maxY = max.y - origin.y;
+    if ((minY - minHeight) * quantization > quantizedMax) return;
+    if (maxY < minHeight) return;
+    unsigned short heightRange[2] = {
+        quantizeValue((minY - minHeight) * quantization, false),
+        quantizeValue((maxY - minHeight) * quantization, true)
+    };
+
+    unsigned top = (unsigned)levelOffset.size() - 1;
+    findInNode(top, 0, 0, cellRange, heightRange, minY, maxY, results);
+}
+
+unsigned CollisionHeightfield::getMemoryUsed() const
+{
+    return (unsigned)(heights.size() * sizeof(real) +
+        bounds.size() * sizeof(unsigned short));
+}
+
+// Collision detector routines for static geometry
+
+/*
+ * Finds the world aligned bounds of a box.
+ */
+static void boundsOf(const CollisionBox &box, Vector3 *min, Vector3 *max)
+{
+    Vector3 centre = box.getAxis(3);
+    Vector3 extent;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        Vector3 axis = box.getAxis(i) * box.halfSize[i];
+        extent.x += real_abs(axis.x);
+        extent.y += real_abs(axis.y);
+        extent.z += real_abs(axis.z);
+    }
+    *min = centre - extent;
+    *max = centre + extent;
+}
+
+static void boundsOf(const CollisionSphere &sphere, Vector3 *min, Vector3 *max)
+{
+    Vector3 extent(sphere.radius, sphere.radius, sphere.radius);
+    *min = sphere.getAxis(3) - extent;
+    *max = sphere.getAxis(3) + extent;
+}
+
+static void boundsOf(const CollisionCapsule &capsule, Vector3 *min, Vector3 *max)
+{
+    Vector3 start, end;
+    capsule.getSegment(&start, &end);
+    for (unsigned i = 0; i < 3; i++)
+    {
+        (*min)[i] = std::min(start[i], end[i]) - capsule.radius;
+        (*max)[i] = std::max(start[i], end[i]) + capsule.radius;
+    }
+}
+
+/*
+ * Tests a primitive against every triangle of a static shape that
+ * lies near it.
+ */
+template<class Shape, class Primitive>
+static unsigned collideWithTriangles(
+    const Primitive &primitive,
+    const Shape &shape,
+    unsigned (*test)(const Primitive &, const Vector3 *, CollisionData *),
+    CollisionData *data)
+{
+    if (!data->hasMoreContacts()) return 0;
+
+    Vector3 min, max;
+    boundsOf(primitive, &min, &max);
+
+    std::vector<unsigned> triangles;
+    shape.findTriangles(min, max, &triangles);
+
+    unsigned contactsUsed = 0;
+    Vector3 triangle[3];
+    for (unsigned i = 0; i < triangles.size(); i++)
+    {
+        if (!data->hasMoreContacts()) break;
+        shape.getTriangle(triangles[i], triangle);
+        contactsUsed += test(primitive, triangle, data);
+    }
+    return contactsUsed;
+}
+
+unsigned CollisionDetector::sphereAndMesh(
+    const CollisionSphere &sphere,
+    const CollisionTriangleMesh &mesh,
+    CollisionData *data)
+{
+    return collideWithTriangles(sphere, mesh,
+        &CollisionDetector::sphereAndTriangle, data);
+}
+
+unsigned CollisionDetector::capsuleAndMesh(
+    const CollisionCapsule &capsule,
+    const CollisionTriangleMesh &mesh,
+    CollisionData *data)
+{
+    return collideWithTriangles(capsule, mesh,
+        &CollisionDetector::capsuleAndTriangle, data);
+}
+
+unsigned CollisionDetector::boxAndMesh(
+    const CollisionBox &box,
+    const CollisionTriangleMesh &mesh,
+    CollisionData *data)
+{
+    return collideWithTriangles(box, mesh,
+        &CollisionDetector::boxAndTriangle, data);
+}
+
+unsigned CollisionDetector::sphereAndHeightfield(
+    const CollisionSphere &sphere,
+    const CollisionHeightfield &heightfield,
+    CollisionData *data)
+{
+    return collideWithTriangles(sphere, heightfield,
+        &CollisionDetector::sphereAndTriangle, data);
+}
+
+unsigned CollisionDetector::capsuleAndHeightfield(
+    const CollisionCapsule &capsule,
+    const CollisionHeightfield &heightfield,
+    CollisionData *data)
+{
+    return collideWithTriangles(capsule, heightfield,
+        &CollisionDetector::capsuleAndTriangle, data);
+}
+
+unsigned CollisionDetector::boxAndHeightfield(
+    const CollisionBox &box,
+    const CollisionHeightfield &heightfield,
+    CollisionData *data)
+{
+    return collideWithTriangles(box, heightfield,
+        &CollisionDetector::boxAndTriangle, data);
+}
@@ -35,10 +35,11 @@ void Contact::matchAwakeState()
     bool body0awake = body[0]->getAwake();
     bool body1awake = body[1]->getAwake();
 
-    // Wake up only the sleeping one
+    // Wake up only the sleeping one. Bodies that aren't dynamic
+    // are never woken by contacts.
     if (body0awake ^ body1awake) {
-        if (body0awake) body[1]->setAwake();
-        else body[0]->setAwake();
+        RigidBody *sleeper = body0awake ? body[1] : body[0];
+        if (sleeper->isDynamic()) sleeper->setAwake();
     }
 }
 
@@ -238,9 +239,13 @@ void Contact::applyVelocityChange(Vector3 velocityChange[2],
     velocityChange[0].clear();
     velocityChange[0].addScaledVector(impulse, body[0]->getInverseMass());
 
-    // Apply the changes
-    body[0]->addVelocity(velocityChange[0]);
-    body[0]->addRotation(rotationChange[0]);
+    // Apply the changes. Bodies that aren't dynamic have no inverse
+    // mass, so their changes are zero, and we leave them untouched.
+    if (body[0]->isDynamic())
+    {
+        body[0]->addVelocity(velocityChange[0]);
+        body[0]->addRotation(rotationChange[0]);
+    }
 
     if (body[1])
     {
@@ -251,8 +256,11 @@ void Contact::applyVelocityChange(Vector3 velocityChange[2],
         velocityChange[1].addScaledVector(impulse, -body[1]->getInverseMass());
 
         // And apply them.
-        body[1]->addVelocity(velocityChange[1]);
-        body[1]->addRotation(rotationChange[1]);
+        if (body[1]->isDynamic())
+        {
+            body[1]->addVelocity(velocityChange[1]);
+            body[1]->addRotation(rotationChange[1]);
+        }
     }
 }
 
@@ -481,6 +489,10 @@ void Contact::applyPositionChange(Vector3 linearChange[2],
         // along the contact normal.
         linearChange[i] = contactNormal * linearMove[i];
 
+        // Bodies that aren't dynamic don't move, so leave them
+        // untouched.
+        if (!body[i]->isDynamic()) continue;
+
         // Now we can start to apply the values we've calculated.
         // Apply the linear movement
         Vector3 pos;
@@ -704,3 +716,103 @@ void ContactResolver::adjustPositions(Contact *c,
         positionIterationsUsed++;
     }
 }
+
+
+
+// Contact buffer implementation
+
+ContactBuffer::ContactBuffer(unsigned chunkSize)
+:
+arena(sizeof(Contact) * chunkSize * 4),
+firstChunk(NULL),
+lastChunk(NULL),
+chunkSize(chunkSize),
+contactCount(0),
+chunkCount(0)
+{
+    assert(chunkSize > 0);
+}
+
+void ContactBuffer::reset()
+{
+    arena.reset();
+    firstChunk = lastChunk = NULL;
+    contactCount = 0;
+    chunkCount = 0;
+}
+
+void ContactBuffer::addChunk(unsigned minimum)
+{
+    unsigned capacity = chunkSize;
+    if (capacity < minimum) capacity = minimum;
+
+    Chunk *chunk = arena.allocateArray<Chunk>(1);
+    chunk->contacts = arena.allocateArray<Contact>(capacity);
+    chunk->used = 0;
+    chunk->capacity = capacity;
+    chunk->next = NULL;
+
+    if (lastChunk) lastChunk->next = chunk;
+    else firstChunk = chunk;
+    lastChunk = chunk;
+    chunkCount++;
+}
+
+Contact* ContactBuffer::getSpace(unsigned minimum, unsigned *available)
+{
+    if (minimum == 0) minimum = 1;
+
+    // Any unused space at the end of a chunk is simply left empty,
+    // chunks keep their own used count.
+    if (!lastChunk || lastChunk->capacity - lastChunk->used < minimum)
+    {
+        addChunk(minimum);
+    }
+
+    *available = lastChunk->capacity - lastChunk->used;
+    return lastChunk->contacts + lastChunk->used;
+}
+
+void ContactBuffer::commit(unsigned count)
+{
+    assert(lastChunk && lastChunk->used + count <= lastChunk->capacity);
+    lastChunk->used += count;
+    contactCount += count;
+}
+
+void ContactBuffer::copyTo(Contact *destination) const
+{
+    for (Chunk *chunk = firstChunk; chunk; chunk = chunk->next)
+    {
+        for (unsigned i = 0; i < chunk->used; i++)
+        {
+            *destination++ = chunk->contacts[i];
+        }
+    }
+}
+
+Contact* ContactBuffer::gather()
+{
+    if (contactCount == 0) return NULL;
+
+    // Find the first chunk with anything in it. If it holds every
+    // contact we can use it in place.
+    Chunk *chunk = firstChunk;
+    while (chunk->used == 0) chunk = chunk->next;
+    if (chunk->used == contactCount) return chunk->contacts;
+
+    // Otherwise merge the chain into a single chunk. This becomes
+    // the only chunk, so gathering again is free.
+    Contact *merged = static_cast<Contact*>(
+        arena.allocate(sizeof(Contact) * contactCount));
+    copyTo(merged);
+
+    Chunk *single = arena.allocateArray<Chunk>(1);
+    single->contacts = merged;
+    single->used = single->capacity = contactCount;
+    single->next = NULL;
+    firstChunk = lastChunk = single;
+    chunkCount = 1;
+
+    return merged;
+}
@@ -0,0 +1,60 @@
+/*
+ * Implementation file for the damping table.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <cyclone/damping.h>
+
+using namespace cyclone;
+
+DampingTable::DampingTable()
+:
+duration(0),
+sleepBias(1)
+{
+}
+
+void DampingTable::setDuration(real duration)
+{
+    // Drop the entries if they have built up. Every hint is checked
+    // against its damping value, so they'll find new entries.
+    if (dampings.size() > MAX_ENTRIES)
+    {
+        dampings.clear();
+        factors.clear();
+    }
+
+    if (duration == DampingTable::duration) return;
+    DampingTable::duration = duration;
+
+    sleepBias = real_pow(0.5, duration);
+    for (unsigned i = 0; i < dampings.size(); i++)
+    {
+        factors[i] = real_pow(dampings[i], duration);
+    }
+}
+
+void DampingTable::updateHint(real damping, unsigned *hint)
+{
+    if (*hint < dampings.size() && dampings[*hint] == damping) return;
+
+    for (unsigned i = 0; i < dampings.size(); i++)
+    {
+        if (dampings[i] == damping)
+        {
+            *hint = i;
+            return;
+        }
+    }
+
+    *hint = (unsigned)dampings.size();
+    dampings.push_back(damping);
+    factors.push_back(real_pow(damping, duration));
+}
@@ -193,13 +193,14 @@ RigidBodyApplication::RigidBodyApplication()
 :
     theta(0.0f),
     phi(15.0f),
+    contacts(maxContacts),
     resolver(maxContacts*8),
 
     renderDebugInfo(false),
     pauseSimulation(true),
     autoPauseSimulation(false)
 {
-    cData.contactArray = contacts;
+    cData.buffer = &contacts;
 }
 
 void RigidBodyApplication::update()
@@ -226,6 +227,7 @@ void RigidBodyApplication::update()
 
     // Perform the contact generation
     generateContacts();
+    cData.gather();
 
     // Resolve detected contacts
     resolver.resolveContacts(
@@ -254,8 +256,10 @@ void RigidBodyApplication::drawDebug()
     // Recalculate the contacts, so they are current (in case we're
     // paused, for example).
     generateContacts();
+    cData.gather();
 
     // Render the contacts, if required
+    cyclone::Contact *contacts = cData.contactArray;
     glBegin(GL_LINES);
     for (unsigned i = 0; i < cData.contactCount; i++)
     {
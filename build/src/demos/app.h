@@ -12,6 +12,7 @@
 #include <cstdlib>
 
 #include <cyclone/cyclone.h>
+#include <cyclone/pground.h>
 
 /**
  * An application is the base class for all demonstration progams.
@@ -155,7 +156,7 @@ class MassAggregateApplication : public Application
 protected:
     cyclone::ParticleWorld world;
     cyclone::Particle *particleArray;
-    cyclone::GroundContacts groundContactGenerator;
+    cyclone::ParticleGroundContacts groundContactGenerator;
 
 public:
     MassAggregateApplication(unsigned int particleCount);
@@ -179,11 +180,14 @@ public:
  class RigidBodyApplication : public Application
  {
  protected:
-    /** Holds the maximum number of contacts. */
+    /**
+     * Holds the number of contacts in each chunk of the contact
+     * buffer.
+     */
     const static unsigned maxContacts = 256;
 
-    /** Holds the array of contacts. */
-    cyclone::Contact contacts[maxContacts];
+    /** Holds the growable buffer of contacts. */
+    cyclone::ContactBuffer contacts;
 
     /** Holds the collision data structure for collision detection. */
     cyclone::CollisionData cData;
@@ -301,9 +301,46 @@ void BigBallisticDemo::updateObjects(cyclone::real duration)
         if (shot->type != UNUSED)
         {
             // Run the physics
+            cyclone::Vector3 start = shot->body->getPosition();
             shot->body->integrate(duration);
             shot->calculateInternals();
 
+            // Fast shots can pass straight through a box in a single
+            // frame, so sweep them and stop them at the first box
+            // they hit. The collision detector then sees the impact.
+            cyclone::Vector3 end = shot->body->getPosition();
+            cyclone::real first = 1, toi;
+            cyclone::Vector3 normal, firstNormal;
+            for (Box *box = boxData; box < boxData+boxes; box++)
+            {
+                if (cyclone::SweepTests::sphereAndBox(start, end,
+                    shot->radius, *box, &toi, &normal) && toi < first)
+                {
+                    first = toi;
+                    firstNormal = normal;
+                }
+            }
+            if (first <= 0)
+            {
+                // The shot started the frame touching a box, so only
+                // take away the movement into it.
+                shot->body->setPosition(end -
+                    firstNormal * ((end - start) * firstNormal));
+                shot->body->calculateDerivedData();
+                shot->calculateInternals();
+                first = 1;
+            }
+
+            // Leave the shot slightly inside the box, so the contact
+            // is reliably generated.
+            if (first < 1) first += shot->radius * 0.05f / (end - start).magnitude();
+            if (first < 1)
+            {
+                shot->body->setPosition(start + (end - start) * first);
+                shot->body->calculateDerivedData();
+                shot->calculateInternals();
+            }
+
             // Check if the particle is now invalid
             if (shot->body->getPosition().y < 0.0f ||
                 shot->startTime+5000 < TimingData::get().lastFrameTimestamp ||
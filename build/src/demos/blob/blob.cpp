@@ -163,6 +163,16 @@ public:
      */
     cyclone::real maxDistance;
 
+    /**
+     * Holds the grid used to find the particles near each other.
+     */
+    const cyclone::ParticleGrid *grid;
+
+    /**
+     * Holds the neighbours found for the particle being updated.
+     */
+    std::vector<unsigned> neighbours;
+
     virtual void updateForce(
         cyclone::Particle *particle, 
         cyclone::real duration
@@ -172,15 +182,22 @@ public:
 void BlobForceGenerator::updateForce(cyclone::Particle *particle, 
                                       cyclone::real duration)
 {
+    // Only the particles within reach can pull on this one, so look
+    // them up in the world's grid rather than checking every blob.
+    neighbours.clear();
+    grid->findNeighbours(particle->getPosition(), maxDistance, &neighbours);
+
     unsigned joinCount = 0;
-    for (unsigned i = 0; i < BLOB_COUNT; i++)
+    for (unsigned n = 0; n < neighbours.size(); n++)
     {
+        cyclone::Particle *other = grid->getParticle(neighbours[n]);
+
         // Don't attract yourself
-        if (particles + i == particle) continue;
+        if (other == particle) continue;
 
         // Work out the separation distance
         cyclone::Vector3 separation = 
-            particles[i].getPosition() - particle->getPosition();
+            other->getPosition() - particle->getPosition();
         separation.z = 0.0f;
         cyclone::real distance = separation.magnitude();
 
@@ -275,6 +292,8 @@ world(PLATFORM_COUNT+BLOB_COUNT, PLATFORM_COUNT)
     blobForceGenerator.maxDistance = BLOB_RADIUS * 2.5f;
     blobForceGenerator.maxFloat = 2;
     blobForceGenerator.floatHead = 8.0f;
+    blobForceGenerator.grid = &world.getNeighbourGrid();
+    world.enableNeighbourGrid(blobForceGenerator.maxDistance);
     
     // Create the platforms
     platforms = new Platform[PLATFORM_COUNT];
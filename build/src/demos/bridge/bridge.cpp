@@ -31,8 +31,8 @@
 class BridgeDemo : public MassAggregateApplication
 {
     cyclone::ParticleCableConstraint *supports;
-    cyclone::ParticleCable *cables;
-    cyclone::ParticleRod *rods;
+    cyclone::ParticleCableSet cables;
+    cyclone::ParticleRodSet rods;
 
     cyclone::Vector3 massPos;
     cyclone::Vector3 massDisplayPos;
@@ -64,7 +64,7 @@ public:
 // Method definitions
 BridgeDemo::BridgeDemo()
 :
-MassAggregateApplication(12), cables(0), supports(0), rods(0),
+MassAggregateApplication(12), supports(0),
 massPos(0,0,0.5f)
 {
     // Create the masses and connections.
@@ -83,15 +83,12 @@ massPos(0,0,0.5f)
     }
 
     // Add the links
-    cables = new cyclone::ParticleCable[CABLE_COUNT];
-    for (unsigned i = 0; i < 10; i++)
+    cables.init(&world.getParticles());
+    for (unsigned i = 0; i < CABLE_COUNT; i++)
     {
-        cables[i].particle[0] = &particleArray[i];
-        cables[i].particle[1] = &particleArray[i+2];
-        cables[i].maxLength = 1.9f;
-        cables[i].restitution = 0.3f;
-        world.getContactGenerators().push_back(&cables[i]);
+        cables.add(i, i+2, 1.9f, 0.3f);
     }
+    world.getContactGenerators().push_back(&cables);
 
     supports = new cyclone::ParticleCableConstraint[SUPPORT_COUNT];
     for (unsigned i = 0; i < SUPPORT_COUNT; i++)
@@ -108,22 +105,18 @@ massPos(0,0,0.5f)
         world.getContactGenerators().push_back(&supports[i]);
     }
 
-    rods = new cyclone::ParticleRod[ROD_COUNT];
-    for (unsigned i = 0; i < 6; i++)
+    rods.init(&world.getParticles());
+    for (unsigned i = 0; i < ROD_COUNT; i++)
     {
-        rods[i].particle[0] = &particleArray[i*2];
-        rods[i].particle[1] = &particleArray[i*2+1];
-        rods[i].length = 2;
-        world.getContactGenerators().push_back(&rods[i]);
+        rods.add(i*2, i*2+1, 2);
     }
+    world.getContactGenerators().push_back(&rods);
 
     updateAdditionalMass();
 }
 
 BridgeDemo::~BridgeDemo()
 {
-    if (cables) delete[] cables;
-    if (rods) delete[] rods;
     if (supports) delete[] supports;
 }
 
@@ -200,21 +193,19 @@ void BridgeDemo::display()
 
     glBegin(GL_LINES);
     glColor3f(0,0,1);
-    for (unsigned i = 0; i < ROD_COUNT; i++)
+    for (unsigned i = 0; i < rods.getCount(); i++)
     {
-        cyclone::Particle **particles = rods[i].particle;
-        const cyclone::Vector3 &p0 = particles[0]->getPosition();
-        const cyclone::Vector3 &p1 = particles[1]->getPosition();
+        const cyclone::Vector3 &p0 = rods.getFirst(i)->getPosition();
+        const cyclone::Vector3 &p1 = rods.getSecond(i)->getPosition();
         glVertex3f(p0.x, p0.y, p0.z);
         glVertex3f(p1.x, p1.y, p1.z);
     }
 
     glColor3f(0,1,0);
-    for (unsigned i = 0; i < CABLE_COUNT; i++)
+    for (unsigned i = 0; i < cables.getCount(); i++)
     {
-        cyclone::Particle **particles = cables[i].particle;
-        const cyclone::Vector3 &p0 = particles[0]->getPosition();
-        const cyclone::Vector3 &p1 = particles[1]->getPosition();
+        const cyclone::Vector3 &p0 = cables.getFirst(i)->getPosition();
+        const cyclone::Vector3 &p1 = cables.getSecond(i)->getPosition();
         glVertex3f(p0.x, p0.y, p0.z);
         glVertex3f(p1.x, p1.y, p1.z);
     }
@@ -235,6 +235,12 @@ class ExplosionDemo : public RigidBodyApplication
     /** Holds the ball data. */
     Ball ballData[balls];
 
+    /** Holds the explosion, which is set off by fire. */
+    cyclone::Explosion explosion;
+
+    /** True once the explosion has been set off. */
+    bool exploding;
+
 
     /** Detonates the explosion. */
     void fire();
@@ -273,7 +279,8 @@ ExplosionDemo::ExplosionDemo()
     :
     RigidBodyApplication(),
     editMode(false),
-    upMode(false)
+    upMode(false),
+    exploding(false)
 {
     // Reset the position of the boxes
     reset();
@@ -286,10 +293,8 @@ const char* ExplosionDemo::getTitle()
 
 void ExplosionDemo::fire()
 {
-    cyclone::Vector3 pos = ballData[0].body->getPosition();
-    pos.normalise();
-
-    ballData[0].body->addForce(pos * -1000.0f);
+    explosion.detonate(cyclone::Vector3(0,0,0));
+    exploding = true;
 }
 
 void ExplosionDemo::reset()
@@ -321,8 +326,9 @@ void ExplosionDemo::reset()
         ball->random(&random);
     }
 
-    // Reset the contacts
+    // Reset the contacts and the explosion
     cData.contactCount = 0;
+    exploding = false;
 }
 
 void ExplosionDemo::generateContacts()
@@ -388,6 +394,21 @@ void ExplosionDemo::generateContacts()
 
 void ExplosionDemo::updateObjects(cyclone::real duration)
 {
+    // Apply the explosion, if one is going off
+    if (exploding)
+    {
+        for (Box *box = boxData; box < boxData+boxes; box++)
+        {
+            explosion.updateForce(box->body, duration);
+        }
+        for (Ball *ball = ballData; ball < ballData+balls; ball++)
+        {
+            explosion.updateForce(ball->body, duration);
+        }
+        explosion.advance(duration);
+        exploding = explosion.isActive();
+    }
+
     // Update the physics of each box in turn
     for (Box *box = boxData; box < boxData+boxes; box++)
     {
@@ -567,6 +588,10 @@ void ExplosionDemo::key(unsigned char key)
         editMode = false;
         return;
 
+    case 'f': case 'F':
+        fire();
+        return;
+
     case 'w': case 'W':
         for (Box *box = boxData; box < boxData+boxes; box++)
             box->body->setAwake();
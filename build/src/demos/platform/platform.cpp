@@ -18,8 +18,6 @@
 #include <stdio.h>
 #include <cassert>
 
-#define ROD_COUNT 15
-
 #define BASE_MASS 1
 #define EXTRA_MASS 10
 
@@ -28,7 +26,7 @@
  */
 class PlatformDemo : public MassAggregateApplication
 {
-    cyclone::ParticleRod *rods;
+    cyclone::ParticleRodSet rods;
 
     cyclone::Vector3 massPos;
     cyclone::Vector3 massDisplayPos;
@@ -60,7 +58,7 @@ public:
 // Method definitions
 PlatformDemo::PlatformDemo()
 :
-MassAggregateApplication(6), rods(0),
+MassAggregateApplication(6),
 massPos(0,0,0.5f)
 {
     // Create the masses and connections.
@@ -79,69 +77,35 @@ massPos(0,0,0.5f)
         particleArray[i].clearAccumulator();
     }
 
-    rods = new cyclone::ParticleRod[ROD_COUNT];
-
-    rods[0].particle[0] = &particleArray[0];
-    rods[0].particle[1] = &particleArray[1];
-    rods[0].length = 2;
-    rods[1].particle[0] = &particleArray[2];
-    rods[1].particle[1] = &particleArray[3];
-    rods[1].length = 2;
-    rods[2].particle[0] = &particleArray[4];
-    rods[2].particle[1] = &particleArray[5];
-    rods[2].length = 2;
-
-    rods[3].particle[0] = &particleArray[2];
-    rods[3].particle[1] = &particleArray[4];
-    rods[3].length = 7;
-    rods[4].particle[0] = &particleArray[3];
-    rods[4].particle[1] = &particleArray[5];
-    rods[4].length = 7;
-
-    rods[5].particle[0] = &particleArray[0];
-    rods[5].particle[1] = &particleArray[2];
-    rods[5].length = 3.606;
-    rods[6].particle[0] = &particleArray[1];
-    rods[6].particle[1] = &particleArray[3];
-    rods[6].length = 3.606;
-
-    rods[7].particle[0] = &particleArray[0];
-    rods[7].particle[1] = &particleArray[4];
-    rods[7].length = 4.472;
-    rods[8].particle[0] = &particleArray[1];
-    rods[8].particle[1] = &particleArray[5];
-    rods[8].length = 4.472;
-
-    rods[9].particle[0] = &particleArray[0];
-    rods[9].particle[1] = &particleArray[3];
-    rods[9].length = 4.123;
-    rods[10].particle[0] = &particleArray[2];
-    rods[10].particle[1] = &particleArray[5];
-    rods[10].length = 7.28;
-    rods[11].particle[0] = &particleArray[4];
-    rods[11].particle[1] = &particleArray[1];
-    rods[11].length = 4.899;
-    rods[12].particle[0] = &particleArray[1];
-    rods[12].particle[1] = &particleArray[2];
-    rods[12].length = 4.123;
-    rods[13].particle[0] = &particleArray[3];
-    rods[13].particle[1] = &particleArray[4];
-    rods[13].length = 7.28;
-    rods[14].particle[0] = &particleArray[5];
-    rods[14].particle[1] = &particleArray[0];
-    rods[14].length = 4.899;
-
-    for (unsigned i = 0; i < ROD_COUNT; i++)
-    {
-        world.getContactGenerators().push_back(&rods[i]);
-    }
+    rods.init(&world.getParticles());
+
+    rods.add(0, 1, 2);
+    rods.add(2, 3, 2);
+    rods.add(4, 5, 2);
+
+    rods.add(2, 4, 7);
+    rods.add(3, 5, 7);
+
+    rods.add(0, 2, 3.606);
+    rods.add(1, 3, 3.606);
+
+    rods.add(0, 4, 4.472);
+    rods.add(1, 5, 4.472);
+
+    rods.add(0, 3, 4.123);
+    rods.add(2, 5, 7.28);
+    rods.add(4, 1, 4.899);
+    rods.add(1, 2, 4.123);
+    rods.add(3, 4, 7.28);
+    rods.add(5, 0, 4.899);
+
+    world.getContactGenerators().push_back(&rods);
 
     updateAdditionalMass();
 }
 
 PlatformDemo::~PlatformDemo()
 {
-    if (rods) delete[] rods;
 }
 
 void PlatformDemo::updateAdditionalMass()
@@ -199,11 +163,10 @@ void PlatformDemo::display()
 
     glBegin(GL_LINES);
     glColor3f(0,0,1);
-    for (unsigned i = 0; i < ROD_COUNT; i++)
+    for (unsigned i = 0; i < rods.getCount(); i++)
     {
-        cyclone::Particle **particles = rods[i].particle;
-        const cyclone::Vector3 &p0 = particles[0]->getPosition();
-        const cyclone::Vector3 &p1 = particles[1]->getPosition();
+        const cyclone::Vector3 &p0 = rods.getFirst(i)->getPosition();
+        const cyclone::Vector3 &p1 = rods.getSecond(i)->getPosition();
         glVertex3f(p0.x, p0.y, p0.z);
         glVertex3f(p1.x, p1.y, p1.z);
     }
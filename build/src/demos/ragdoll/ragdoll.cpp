@@ -34,24 +34,55 @@ public:
     }
 
     /**
-     * We use a sphere to collide bone on bone to allow some limited
-     * interpenetration.
+     * Returns the index of the bone's longest axis, which its
+     * collision capsule runs along.
      */
-    cyclone::CollisionSphere getCollisionSphere() const
+    unsigned getLongAxis() const
     {
-        cyclone::CollisionSphere sphere;
-        sphere.body = body;
-        sphere.radius = halfSize.x;
-        sphere.offset = cyclone::Matrix4();
-        if (halfSize.y < sphere.radius) sphere.radius = halfSize.y;
-        if (halfSize.z < sphere.radius) sphere.radius = halfSize.z;
-        sphere.calculateInternals();
-        return sphere;
+        unsigned axis = 0;
+        if (halfSize.y > halfSize[axis]) axis = 1;
+        if (halfSize.z > halfSize[axis]) axis = 2;
+        return axis;
+    }
+
+    /**
+     * We use a capsule along the bone's long axis for collision. It
+     * is much cheaper and more stable than a box, and its rounded
+     * ends allow some limited interpenetration.
+     */
+    cyclone::CollisionCapsule getCollisionCapsule() const
+    {
+        unsigned axis = getLongAxis();
+
+        cyclone::CollisionCapsule capsule;
+        capsule.body = body;
+        capsule.radius = halfSize[(axis+1)%3];
+        if (halfSize[(axis+2)%3] < capsule.radius)
+        {
+            capsule.radius = halfSize[(axis+2)%3];
+        }
+        capsule.halfHeight = halfSize[axis] - capsule.radius;
+
+        // The capsule runs along its Y axis, so turn that onto the
+        // long axis of the bone.
+        capsule.offset = cyclone::Matrix4();
+        if (axis != 1)
+        {
+            capsule.offset.data[axis*4+axis] = 0;
+            capsule.offset.data[5] = 0;
+            capsule.offset.data[axis*4+1] = 1;
+            capsule.offset.data[4+axis] = -1;
+        }
+        capsule.calculateInternals();
+        return capsule;
     }
 
     /** Draws the bone. */
     void render()
     {
+        static GLUquadricObj *quadric = gluNewQuadric();
+        cyclone::CollisionCapsule capsule = getCollisionCapsule();
+
         // Get the OpenGL transformation
         GLfloat mat[16];
         body->getGLTransform(mat);
@@ -61,8 +92,20 @@ public:
 
         glPushMatrix();
         glMultMatrixf(mat);
-        glScalef(halfSize.x*2, halfSize.y*2, halfSize.z*2);
-        glutSolidCube(1.0f);
+
+        // GLU draws cylinders along Z, so turn Z onto the long axis.
+        switch (getLongAxis())
+        {
+        case 0: glRotatef(90.0f, 0, 1, 0); break;
+        case 1: glRotatef(-90.0f, 1, 0, 0); break;
+        }
+
+        glTranslatef(0, 0, -capsule.halfHeight);
+        gluCylinder(quadric, capsule.radius, capsule.radius,
+            capsule.halfHeight*2, 20, 1);
+        glutSolidSphere(capsule.radius, 20, 20);
+        glTranslatef(0, 0, capsule.halfHeight*2);
+        glutSolidSphere(capsule.radius, 20, 20);
         glPopMatrix();
     }
 
@@ -110,6 +153,9 @@ class RagdollDemo : public RigidBodyApplication
     /** Holds the joints. */
     cyclone::Joint joints[NUM_JOINTS];
 
+    /** Returns true if the two bones are connected by a joint. */
+    bool isJointed(const Bone *one, const Bone *two) const;
+
     /** Processes the contact generation code. */
     virtual void generateContacts();
 
@@ -224,6 +270,19 @@ const char* RagdollDemo::getTitle()
     return "Cyclone > Ragdoll Demo";
 }
 
+bool RagdollDemo::isJointed(const Bone *one, const Bone *two) const
+{
+    for (const cyclone::Joint *joint = joints; joint < joints+NUM_JOINTS; joint++)
+    {
+        if ((joint->body[0] == one->body && joint->body[1] == two->body) ||
+            (joint->body[0] == two->body && joint->body[1] == one->body))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 void RagdollDemo::generateContacts()
 {
     // Create the ground plane data
@@ -238,26 +297,29 @@ void RagdollDemo::generateContacts()
     cData.tolerance = (cyclone::real)0.1;
 
     // Perform exhaustive collision detection on the ground plane
-    cyclone::Matrix4 transform, otherTransform;
-    cyclone::Vector3 position, otherPosition;
     for (Bone *bone = bones; bone < bones+NUM_BONES; bone++)
     {
+        cyclone::CollisionCapsule boneCapsule = bone->getCollisionCapsule();
+
         // Check for collisions with the ground plane
         if (!cData.hasMoreContacts()) return;
-        cyclone::CollisionDetector::boxAndHalfSpace(*bone, plane, &cData);
-
-        cyclone::CollisionSphere boneSphere = bone->getCollisionSphere();
+        cyclone::CollisionDetector::capsuleAndHalfSpace(
+            boneCapsule, plane, &cData);
 
-        // Check for collisions with each other box
+        // Check for collisions with each other bone
         for (Bone *other = bone+1; other < bones+NUM_BONES; other++)
         {
             if (!cData.hasMoreContacts()) return;
 
-            cyclone::CollisionSphere otherSphere = other->getCollisionSphere();
+            // Bones sharing a joint always overlap at the joint, so
+            // we leave them to the joint.
+            if (isJointed(bone, other)) continue;
+
+            cyclone::CollisionCapsule otherCapsule = other->getCollisionCapsule();
 
-            cyclone::CollisionDetector::sphereAndSphere(
-                boneSphere,
-                otherSphere,
+            cyclone::CollisionDetector::capsuleAndCapsule(
+                boneCapsule,
+                otherCapsule,
                 &cData
                 );
         }
@@ -12,6 +12,7 @@
 
 #include <gl/glut.h>
 #include <cyclone/cyclone.h>
+#include <cyclone/water.h>
 #include "../app.h"
 #include "../timing.h"
 
@@ -24,7 +25,8 @@
  */
 class SailboatDemo : public Application
 {
-    cyclone::Buoyancy buoyancy;
+    cyclone::WaterSurface water;
+    cyclone::WaterBuoyancy buoyancy;
 
     cyclone::Aero sail;
     cyclone::RigidBody sailboat;
@@ -61,7 +63,9 @@ Application(),
 sail(cyclone::Matrix3(0,0,0, 0,0,0, 0,0,-1.0f),
      cyclone::Vector3(2.0f, 0, 0), &windspeed),
 
-buoyancy(cyclone::Vector3(0.0f, 0.5f, 0.0f), 1.0f, 3.0f, 1.6f),
+water(1.6f),
+
+buoyancy(&water, 1.0f, 3.0f),
 
 sail_control(0),
 
@@ -87,6 +91,17 @@ windspeed(0,0,0)
     sailboat.setAwake();
     sailboat.setCanSleep(false);
 
+    // Set up a gentle swell, and float the boat on it at the ends
+    // of both hulls.
+    water.addWave(1.0f, 0.0f, 0.3f, 15.0f, 0.3f);
+    water.addWave(0.3f, 1.0f, 0.15f, 6.0f, 0.2f);
+    water.setTile(64.0f, 64);
+
+    buoyancy.addSample(cyclone::Vector3(1.0f, 0.5f, 1.0f));
+    buoyancy.addSample(cyclone::Vector3(-1.0f, 0.5f, 1.0f));
+    buoyancy.addSample(cyclone::Vector3(1.0f, 0.5f, -1.0f));
+    buoyancy.addSample(cyclone::Vector3(-1.0f, 0.5f, -1.0f));
+
     registry.add(&sailboat, &sail);
     registry.add(&sailboat, &buoyancy);
 }
@@ -146,10 +161,12 @@ void SailboatDemo::display()
     glBegin(GL_QUADS);
     for (int x = -20; x <= 20; x++) for (int z = -20; z <= 20; z++)
     {
-        glVertex3f(bx+x-0.1f, 0, bz+z-0.1f);
-        glVertex3f(bx+x-0.1f, 0, bz+z+0.1f);
-        glVertex3f(bx+x+0.1f, 0, bz+z+0.1f);
-        glVertex3f(bx+x+0.1f, 0, bz+z-0.1f);
+        float y = (float)water.getHeight((cyclone::real)(bx+x),
+                                         (cyclone::real)(bz+z));
+        glVertex3f(bx+x-0.1f, y, bz+z-0.1f);
+        glVertex3f(bx+x-0.1f, y, bz+z+0.1f);
+        glVertex3f(bx+x+0.1f, y, bz+z+0.1f);
+        glVertex3f(bx+x+0.1f, y, bz+z-0.1f);
     }
     glEnd();
 
@@ -197,6 +214,9 @@ void SailboatDemo::update()
     // Update the boat's physics.
     sailboat.integrate(duration);
 
+    // Move the waves on.
+    water.update(duration);
+
     // Change the wind speed.
     windspeed = windspeed * 0.9f + r.randomXZVector(1.0f);
 
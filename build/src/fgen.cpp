@@ -65,6 +65,15 @@ void Buoyancy::updateForce(RigidBody *body, real duration)
     body->addForceAtBodyPoint(force, centreOfBuoyancy);
 }
 
+void ForceGenerator::updateForces(RigidBody * const *bodies,
+                                  unsigned count, real duration)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        updateForce(bodies[i], duration);
+    }
+}
+
 Gravity::Gravity(const Vector3& gravity)
 : gravity(gravity)
 {
@@ -72,13 +81,28 @@ Gravity::Gravity(const Vector3& gravity)
 
 void Gravity::updateForce(RigidBody* body, real duration)
 {
-    // Check that we do not have infinite mass
+    // Check that we do not have infinite mass. Like acceleration,
+    // gravity leaves bodies that aren't simulated alone, rather than
+    // waking them.
     if (!body->hasFiniteMass()) return;
+    if (!body->isDynamic() || !body->getAwake()) return;
 
     // Apply the mass-scaled force to the body
     body->addForce(gravity * body->getMass());
 }
 
+void Gravity::updateForces(RigidBody * const *bodies, unsigned count,
+                           real duration)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        RigidBody *body = bodies[i];
+        if (!body->hasFiniteMass()) continue;
+        if (!body->isDynamic() || !body->getAwake()) continue;
+        body->addForce(gravity * body->getMass());
+    }
+}
+
 Spring::Spring(const Vector3 &localConnectionPt,
                RigidBody *other,
                const Vector3 &otherConnectionPt,
@@ -178,7 +202,144 @@ void AeroControl::updateForce(RigidBody *body, real duration)
     Aero::updateForceFromTensor(body, duration, tensor);
 }
 
+Explosion::Explosion()
+:
+timePassed(0),
+implosionMaxRadius(5),
+implosionMinRadius(1),
+implosionDuration((real)0.1),
+implosionForce(50),
+shockwaveSpeed(30),
+shockwaveThickness(3),
+peakConcussionForce(2000),
+concussionDuration((real)0.5),
+peakConvectionForce(300),
+chimneyRadius(2),
+chimneyHeight(10),
+convectionDuration(3)
+{
+}
+
+void Explosion::detonate(const Vector3 &location)
+{
+    detonation = location;
+    timePassed = 0;
+}
+
+void Explosion::advance(real duration)
+{
+    timePassed += duration;
+}
+
+bool Explosion::isActive() const
+{
+    return timePassed < implosionDuration + concussionDuration ||
+        timePassed < convectionDuration;
+}
+
+real Explosion::getRadius() const
+{
+    real radius = 0;
+    if (timePassed < implosionDuration)
+    {
+        radius = implosionMaxRadius;
+    }
+
+    real waveTime = timePassed - implosionDuration;
+    if (waveTime >= 0 && waveTime < concussionDuration)
+    {
+        real front = shockwaveSpeed * waveTime + shockwaveThickness;
+        if (front > radius) radius = front;
+    }
+
+    if (timePassed < convectionDuration)
+    {
+        real chimney = real_sqrt(chimneyRadius*chimneyRadius +
+                                 chimneyHeight*chimneyHeight);
+        if (chimney > radius) radius = chimney;
+    }
+    return radius;
+}
+
+/**
+ * Scales a force carried by moving air for an object moving in the
+ * same direction as the air at the given speed. Stationary objects
+ * get the full force, objects moving with the air get none, and
+ * objects moving against it get up to double.
+ */
+static real airSpeedScale(real speed, real airSpeed)
+{
+    if (airSpeed <= 0) return 1;
+    real scale = 1 - speed / airSpeed;
+    if (scale < 0) return 0;
+    if (scale > 2) return 2;
+    return scale;
+}
+
+Vector3 Explosion::calculateForce(const Vector3 &position,
+                                  const Vector3 &velocity) const
+{
+    Vector3 force;
+    Vector3 offset = position - detonation;
+    real distance = offset.magnitude();
+
+    // Objects right at the detonation are blown straight up.
+    Vector3 outwards(0, 1, 0);
+    if (distance > 0) outwards = offset * (((real)1.0) / distance);
+
+    // First the air rushes in towards the detonation.
+    if (timePassed < implosionDuration &&
+        distance > implosionMinRadius && distance <= implosionMaxRadius)
+    {
+        force -= outwards * implosionForce;
+    }
+
+    // Then the shock wave passes outwards. Its force peaks at the
+    // wave front, and fades as the wave dies away.
+    real waveTime = timePassed - implosionDuration;
+    if (waveTime >= 0 && waveTime < concussionDuration)
+    {
+        real gap = real_abs(distance - shockwaveSpeed * waveTime);
+        if (gap < shockwaveThickness)
+        {
+            real strength = peakConcussionForce *
+                (1 - gap / shockwaveThickness) *
+                (1 - waveTime / concussionDuration) *
+                airSpeedScale(velocity * outwards, shockwaveSpeed);
+            force += outwards * strength;
+        }
+    }
+
+    // And finally hot air rises up the chimney above the detonation,
+    // most strongly at its centre.
+    if (timePassed < convectionDuration && offset.y >= 0 &&
+        offset.y < chimneyHeight)
+    {
+        real across = real_sqrt(offset.x*offset.x + offset.z*offset.z);
+        if (across < chimneyRadius)
+        {
+            real riseSpeed = chimneyHeight / convectionDuration;
+            force.y += peakConvectionForce *
+                (1 - across / chimneyRadius) *
+                (1 - timePassed / convectionDuration) *
+                airSpeedScale(velocity.y, riseSpeed);
+        }
+    }
+    return force;
+}
+
 void Explosion::updateForce(RigidBody* body, real duration)
 {
+    if (!body->isDynamic()) return;
 
+    Vector3 force = calculateForce(body->getPosition(),
+                                   body->getVelocity());
+    if (force.squareMagnitude() > 0) body->addForce(force);
+}
+
+void Explosion::updateForce(Particle* particle, real duration)
+{
+    Vector3 force = calculateForce(particle->getPosition(),
+                                   particle->getVelocity());
+    if (force.squareMagnitude() > 0) particle->addForce(force);
 }
\ No newline at end of file
@@ -0,0 +1,189 @@
+/*
+ * Implementation file for the hashed uniform grid.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <cyclone/grid.h>
+
+using namespace cyclone;
+
+HashGrid::HashGrid(real cellSize)
+:
+cellSize(cellSize),
+bucketMask(0)
+{
+    bucketStarts.assign(2, 0);
+}
+
+void HashGrid::setCellSize(real size)
+{
+    cellSize = size;
+}
+
+void HashGrid::getCell(const Vector3 &position, int cell[3]) const
+{
+    // Clamp so that far away points can't overflow the cell index.
+    const real limit = (real)(1 << 30);
+    real inverseSize = ((real)1.0) / cellSize;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        real index = real_floor(position[i] * inverseSize);
+        if (index > limit) index = limit;
+        else if (index < -limit) index = -limit;
+        cell[i] = (int)index;
+    }
+}
+
+void HashGrid::setCount(unsigned count)
+{
+    unsorted.resize(count);
+}
+
+void HashGrid::sort()
+{
+    unsigned count = (unsigned)unsorted.size();
+
+    // Use at least twice as many buckets as points, to keep
+    // collisions between cells rare.
+    unsigned buckets = 1;
+    while (buckets < count * 2) buckets <<= 1;
+    bucketMask = buckets - 1;
+
+    // Count the points in each bucket.
+    pointBuckets.resize(count);
+    bucketStarts.assign(buckets + 1, 0);
+    for (unsigned i = 0; i < count; i++)
+    {
+        Entry &entry = unsorted[i];
+        getCell(entry.position, entry.cell);
+        pointBuckets[i] = getBucket(entry.cell);
+        bucketStarts[pointBuckets[i] + 1]++;
+    }
+    for (unsigned b = 0; b < buckets; b++)
+    {
+        bucketStarts[b + 1] += bucketStarts[b];
+    }
+
+    // Then place them, filling each bucket in index order.
+    entries.resize(count);
+    bucketFill.assign(bucketStarts.begin(), bucketStarts.end() - 1);
+    for (unsigned i = 0; i < count; i++)
+    {
+        entries[bucketFill[pointBuckets[i]]++] = unsorted[i];
+    }
+}
+
+unsigned HashGrid::findNear(const Vector3 &centre, real radius,
+                            std::vector<unsigned> *results) const
+{
+    unsigned found = 0;
+    if (entries.empty() || radius < 0) return 0;
+
+    int low[3], high[3];
+    getCell(centre - Vector3(radius, radius, radius), low);
+    getCell(centre + Vector3(radius, radius, radius), high);
+    real radiusSquared = radius * radius;
+
+    // If the query covers more cells than there are buckets, it is
+    // quicker to check every point. The cell indices can be far
+    // apart, so count them as reals, where the difference can't
+    // overflow.
+    real cells = ((real)high[0] - (real)low[0] + 1) *
+        ((real)high[1] - (real)low[1] + 1) *
+        ((real)high[2] - (real)low[2] + 1);
+    if (cells > (real)(bucketMask + 1))
+    {
+        for (unsigned i = 0; i < entries.size(); i++)
+        {
+            const Entry &entry = entries[i];
+            if ((entry.position - centre).squareMagnitude() <=
+                radiusSquared)
+            {
+                results->push_back(entry.index);
+                found++;
+            }
+        }
+        return found;
+    }
+
+    int cell[3];
+    for (cell[0] = low[0]; cell[0] <= high[0]; cell[0]++)
+    for (cell[1] = low[1]; cell[1] <= high[1]; cell[1]++)
+    for (cell[2] = low[2]; cell[2] <= high[2]; cell[2]++)
+    {
+        // Other cells can share the bucket, so check each entry is
+        // really in this cell, or it could be found twice.
+        unsigned bucket = getBucket(cell);
+        for (unsigned i = bucketStarts[bucket];
+             i < bucketStarts[bucket + 1]; i++)
+        {
+            const Entry &entry = entries[i];
+            if (entry.cell[0] != cell[0] || entry.cell[1] != cell[1] ||
+                entry.cell[2] != cell[2]) continue;
+
+            if ((entry.position - centre).squareMagnitude() <=
+                radiusSquared)
+            {
+                results->push_back(entry.index);
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+unsigned HashGrid::findPairs(real radius, std::vector<GridPair> *pairs) const
+{
+    unsigned found = 0;
+    if (entries.empty() || radius < 0) return 0;
+
+    // Work out how many cells either side each point can reach.
+    int reach = (int)real_ceil(radius / cellSize);
+    if (reach < 1) reach = 1;
+    real radiusSquared = radius * radius;
+
+    for (unsigned e = 0; e < entries.size(); e++)
+    {
+        const Entry &first = entries[e];
+
+        int cell[3];
+        for (cell[0] = first.cell[0] - reach;
+             cell[0] <= first.cell[0] + reach; cell[0]++)
+        for (cell[1] = first.cell[1] - reach;
+             cell[1] <= first.cell[1] + reach; cell[1]++)
+        for (cell[2] = first.cell[2] - reach;
+             cell[2] <= first.cell[2] + reach; cell[2]++)
+        {
+            unsigned bucket = getBucket(cell);
+            for (unsigned i = bucketStarts[bucket];
+                 i < bucketStarts[bucket + 1]; i++)
+            {
+                // Each pair is seen from both ends, so only keep it
+                // from the point with the lower index.
+                const Entry &second = entries[i];
+                if (second.index <= first.index) continue;
+                if (second.cell[0] != cell[0] ||
+                    second.cell[1] != cell[1] ||
+                    second.cell[2] != cell[2]) continue;
+
+                if ((second.position - first.position).squareMagnitude()
+                    <= radiusSquared)
+                {
+                    GridPair pair;
+                    pair.first = first.index;
+                    pair.second = second.index;
+                    pairs->push_back(pair);
+                    found++;
+                }
+            }
+        }
+    }
+    return found;
+}
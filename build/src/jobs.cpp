@@ -0,0 +1,233 @@
+/*
+ * Implementation file for the job system.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <cyclone/jobs.h>
+
+using namespace cyclone;
+
+#if CYCLONE_THREADS
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+JobSystem::JobSystem(unsigned workerCount)
+:
+pending(0),
+epoch(0),
+shuttingDown(false)
+{
+    if (workerCount == ~0u)
+    {
+        unsigned hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 0;
+    }
+
+    // Create all the queues before any worker can look at them.
+    for (unsigned i = 0; i <= workerCount; i++)
+    {
+        queues.push_back(new Queue);
+    }
+    for (unsigned i = 0; i < workerCount; i++)
+    {
+        workers.push_back(std::thread(&JobSystem::workerLoop, this, i+1));
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> guard(wakeLock);
+        shuttingDown = true;
+    }
+    wakeWorkers.notify_all();
+
+    for (unsigned i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+    for (unsigned i = 0; i < queues.size(); i++)
+    {
+        delete queues[i];
+    }
+}
+
+unsigned JobSystem::getThreadCount() const
+{
+    return (unsigned)queues.size();
+}
+
+bool JobSystem::setWorkerAffinity(unsigned worker, unsigned core)
+{
+    if (worker >= workers.size()) return false;
+
+#if defined(_WIN32)
+    if (core >= sizeof(DWORD_PTR) * 8) return false;
+    HANDLE handle = (HANDLE)workers[worker].native_handle();
+    return SetThreadAffinityMask(handle, (DWORD_PTR)1 << core) != 0;
+#elif defined(__linux__)
+    if (core >= CPU_SETSIZE) return false;
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    CPU_SET(core, &cores);
+    return pthread_setaffinity_np(workers[worker].native_handle(),
+                                  sizeof(cores), &cores) == 0;
+#else
+    (void)core;
+    return false;
+#endif
+}
+
+bool JobSystem::findJob(unsigned thread, Job *job)
+{
+    // Work from the back of our own queue first, the most recently
+    // added batches are the ones most likely to still be in cache.
+    {
+        Queue &own = *queues[thread];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.jobs.empty())
+        {
+            *job = own.jobs.back();
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+
+    // Then steal from the front of the other queues.
+    unsigned count = (unsigned)queues.size();
+    for (unsigned i = 1; i < count; i++)
+    {
+        Queue &victim = *queues[(thread + i) % count];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.jobs.empty())
+        {
+            *job = victim.jobs.front();
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::runJob(const Job &job, unsigned thread)
+{
+    job.task->run(job.begin, job.end, thread);
+
+    // The last batch to finish wakes the caller. We take the lock so
+    // the notification can't slip in between the caller checking
+    // the count and going to sleep.
+    if (pending.fetch_sub(1) == 1)
+    {
+        std::lock_guard<std::mutex> guard(wakeLock);
+        wakeCaller.notify_one();
+    }
+}
+
+void JobSystem::workerLoop(unsigned thread)
+{
+    unsigned seenEpoch = 0;
+    for (;;)
+    {
+        Job job;
+        while (findJob(thread, &job)) runJob(job, thread);
+
+        // Sleep until a new parallel-for starts.
+        std::unique_lock<std::mutex> guard(wakeLock);
+        while (!shuttingDown && epoch == seenEpoch)
+        {
+            wakeWorkers.wait(guard);
+        }
+        if (shuttingDown) return;
+        seenEpoch = epoch;
+    }
+}
+
+void JobSystem::parallelFor(ParallelTask &task, unsigned count,
+                            unsigned batchSize)
+{
+    if (count == 0) return;
+    if (batchSize == 0) batchSize = 1;
+
+    // Small jobs aren't worth handing out.
+    if (workers.empty() || count <= batchSize)
+    {
+        task.run(0, count, 0);
+        return;
+    }
+
+    // Deal the batches out to the queues in turn.
+    unsigned batches = (count + batchSize - 1) / batchSize;
+    unsigned threads = (unsigned)queues.size();
+    pending.store(batches);
+    for (unsigned t = 0; t < threads; t++)
+    {
+        Queue &queue = *queues[t];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        for (unsigned b = t; b < batches; b += threads)
+        {
+            Job job;
+            job.task = &task;
+            job.begin = b * batchSize;
+            job.end = job.begin + batchSize;
+            if (job.end > count) job.end = count;
+            queue.jobs.push_back(job);
+        }
+    }
+
+    // Wake the workers.
+    {
+        std::lock_guard<std::mutex> guard(wakeLock);
+        epoch++;
+    }
+    wakeWorkers.notify_all();
+
+    // Help out until there's nothing left to take, then wait for
+    // the batches still running on other threads.
+    Job job;
+    while (findJob(0, &job)) runJob(job, 0);
+
+    std::unique_lock<std::mutex> guard(wakeLock);
+    while (pending.load() != 0)
+    {
+        wakeCaller.wait(guard);
+    }
+}
+
+#else // CYCLONE_THREADS
+
+JobSystem::JobSystem(unsigned)
+{
+}
+
+JobSystem::~JobSystem()
+{
+}
+
+unsigned JobSystem::getThreadCount() const
+{
+    return 1;
+}
+
+bool JobSystem::setWorkerAffinity(unsigned, unsigned)
+{
+    return false;
+}
+
+void JobSystem::parallelFor(ParallelTask &task, unsigned count, unsigned)
+{
+    if (count > 0) task.run(0, count, 0);
+}
+
+#endif // CYCLONE_THREADS
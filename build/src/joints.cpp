@@ -53,4 +53,14 @@ void Joint::set(RigidBody *a, const Vector3& a_pos,
     position[1] = b_pos;
 
     Joint::error = error;
-}
\ No newline at end of file
+}
+
+unsigned Joint::getBodyCount() const
+{
+    return 2;
+}
+
+RigidBody* Joint::getBody(unsigned index) const
+{
+    return body[index];
+}
@@ -23,6 +23,11 @@ using namespace cyclone;
  */
 
 void Particle::integrate(real duration)
+{
+    integrate(duration, real_pow(damping, duration));
+}
+
+void Particle::integrate(real duration, real dampingFactor)
 {
     // We don't integrate things with zero mass.
     if (inverseMass <= 0.0f) return;
@@ -40,7 +45,27 @@ void Particle::integrate(real duration)
     velocity.addScaledVector(resultingAcc, duration);
 
     // Impose drag.
-    velocity *= real_pow(damping, duration);
+    velocity *= dampingFactor;
+
+    // Clear the forces.
+    clearAccumulator();
+}
+
+void Particle::predict(real duration, real dampingFactor)
+{
+    // We don't integrate things with zero mass.
+    if (inverseMass <= 0.0f) return;
+
+    assert(duration > 0.0);
+
+    // Update linear velocity from the acceleration first.
+    Vector3 resultingAcc = acceleration;
+    resultingAcc.addScaledVector(forceAccum, inverseMass);
+    velocity.addScaledVector(resultingAcc, duration);
+    velocity *= dampingFactor;
+
+    // Then move with the new velocity.
+    position.addScaledVector(velocity, duration);
 
     // Clear the forces.
     clearAccumulator();
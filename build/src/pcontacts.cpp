@@ -10,7 +10,9 @@
  * software licence.
  */
 
+#include <algorithm>
 #include <cyclone/pcontacts.h>
+#include <cyclone/jobs.h>
 
 using namespace cyclone;
 
@@ -29,19 +31,9 @@ real ParticleContact::calculateSeparatingVelocity() const
     return relativeVelocity * contactNormal;
 }
 
-void ParticleContact::resolveVelocity(real duration)
+real ParticleContact::calculateVelocityChange(real separatingVelocity,
+                                              real duration) const
 {
-    // Find the velocity in the direction of the contact
-    real separatingVelocity = calculateSeparatingVelocity();
-
-    // Check if it needs to be resolved
-    if (separatingVelocity > 0)
-    {
-        // The contact is either separating, or stationary - there's
-        // no impulse required.
-        return;
-    }
-
     // Calculate the new separating velocity
     real newSepVelocity = -separatingVelocity * restitution;
 
@@ -61,7 +53,24 @@ void ParticleContact::resolveVelocity(real duration)
         if (newSepVelocity < 0) newSepVelocity = 0;
     }
 
-    real deltaVelocity = newSepVelocity - separatingVelocity;
+    return newSepVelocity - separatingVelocity;
+}
+
+void ParticleContact::resolveVelocity(real duration)
+{
+    // Find the velocity in the direction of the contact
+    real separatingVelocity = calculateSeparatingVelocity();
+
+    // Check if it needs to be resolved
+    if (separatingVelocity > 0)
+    {
+        // The contact is either separating, or stationary - there's
+        // no impulse required.
+        return;
+    }
+
+    real deltaVelocity =
+        calculateVelocityChange(separatingVelocity, duration);
 
     // We apply the change in velocity to each object in proportion to
     // their inverse mass (i.e. those with lower inverse mass [higher
@@ -94,6 +103,11 @@ void ParticleContact::resolveVelocity(real duration)
 
 void ParticleContact::resolveInterpenetration(real duration)
 {
+    // Nothing has moved yet. The resolver reads these afterwards, so
+    // they mustn't be left over from an earlier resolution.
+    particleMovement[0].clear();
+    particleMovement[1].clear();
+
     // If we don't have any penetration, skip this step.
     if (penetration <= 0) return;
 
@@ -112,8 +126,6 @@ void ParticleContact::resolveInterpenetration(real duration)
     particleMovement[0] = movePerIMass * particle[0]->getInverseMass();
     if (particle[1]) {
         particleMovement[1] = movePerIMass * -particle[1]->getInverseMass();
-    } else {
-        particleMovement[1].clear();
     }
 
     // Apply the penetration resolution
@@ -123,9 +135,41 @@ void ParticleContact::resolveInterpenetration(real duration)
     }
 }
 
+/**
+ * Adjusts the penetration of a contact for the movement made when
+ * resolving another contact.
+ */
+static void adjustPenetration(ParticleContact &contact,
+                              const ParticleContact &resolved)
+{
+    const Vector3 *move = resolved.particleMovement;
+    if (contact.particle[0] == resolved.particle[0])
+    {
+        contact.penetration -= move[0] * contact.contactNormal;
+    }
+    else if (contact.particle[0] == resolved.particle[1])
+    {
+        contact.penetration -= move[1] * contact.contactNormal;
+    }
+    if (contact.particle[1])
+    {
+        if (contact.particle[1] == resolved.particle[0])
+        {
+            contact.penetration += move[0] * contact.contactNormal;
+        }
+        else if (contact.particle[1] == resolved.particle[1])
+        {
+            contact.penetration += move[1] * contact.contactNormal;
+        }
+    }
+}
+
 ParticleContactResolver::ParticleContactResolver(unsigned iterations)
 :
-iterations(iterations)
+iterations(iterations),
+mode(SCAN),
+passes(8),
+jobs(NULL)
 {
 }
 
@@ -134,9 +178,47 @@ void ParticleContactResolver::setIterations(unsigned iterations)
     ParticleContactResolver::iterations = iterations;
 }
 
+void ParticleContactResolver::setMode(Mode mode)
+{
+    ParticleContactResolver::mode = mode;
+}
+
+ParticleContactResolver::Mode ParticleContactResolver::getMode() const
+{
+    return mode;
+}
+
+void ParticleContactResolver::setPasses(unsigned passes)
+{
+    ParticleContactResolver::passes = passes;
+}
+
+void ParticleContactResolver::setJobSystem(JobSystem *jobs)
+{
+    ParticleContactResolver::jobs = jobs;
+}
+
 void ParticleContactResolver::resolveContacts(ParticleContact *contactArray,
                                               unsigned numContacts,
                                               real duration)
+{
+    if (mode == INDEXED)
+    {
+        resolveIndexed(contactArray, numContacts, duration);
+    }
+    else if (mode == JACOBI)
+    {
+        resolveJacobi(contactArray, numContacts, duration);
+    }
+    else
+    {
+        resolveScan(contactArray, numContacts, duration);
+    }
+}
+
+void ParticleContactResolver::resolveScan(ParticleContact *contactArray,
+                                          unsigned numContacts,
+                                          real duration)
 {
     unsigned i;
 
@@ -164,29 +246,388 @@ void ParticleContactResolver::resolveContacts(ParticleContact *contactArray,
         contactArray[maxIndex].resolve(duration);
 
         // Update the interpenetrations for all particles
-        Vector3 *move = contactArray[maxIndex].particleMovement;
         for (i = 0; i < numContacts; i++)
         {
-            if (contactArray[i].particle[0] == contactArray[maxIndex].particle[0])
+            adjustPenetration(contactArray[i], contactArray[maxIndex]);
+        }
+
+        iterationsUsed++;
+    }
+}
+
+void ParticleContactResolver::buildGroups(ParticleContact *contactArray,
+                                          unsigned numContacts)
+{
+    // Sort the ends so the ends on the same particle are together.
+    ends.clear();
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        for (unsigned b = 0; b < 2; b++)
+        {
+            if (!contactArray[i].particle[b]) continue;
+            ContactEnd end;
+            end.particle = contactArray[i].particle[b];
+            end.contact = i;
+            ends.push_back(end);
+        }
+    }
+    std::sort(ends.begin(), ends.end());
+
+    // Then number the groups, and tell each contact which groups its
+    // ends are in.
+    groupStarts.clear();
+    contactGroups.assign(numContacts * 2, ~0u);
+    for (unsigned e = 0; e < ends.size(); e++)
+    {
+        if (e == 0 || ends[e].particle != ends[e-1].particle)
+        {
+            groupStarts.push_back(e);
+        }
+        unsigned group = (unsigned)groupStarts.size() - 1;
+        const ParticleContact &contact = contactArray[ends[e].contact];
+        unsigned b = (contact.particle[0] == ends[e].particle) ? 0 : 1;
+        contactGroups[ends[e].contact * 2 + b] = group;
+    }
+    groupStarts.push_back((unsigned)ends.size());
+}
+
+bool ParticleContactResolver::isWorse(ParticleContact *contactArray,
+                                      unsigned one, unsigned two) const
+{
+    // Contacts that need resolving come before those that don't,
+    // then the fastest closing, then the lowest index, so contacts
+    // are picked in the same order as a scan would pick them.
+    real oneVelocity = separatingVelocities[one];
+    real twoVelocity = separatingVelocities[two];
+    bool oneNeeded = oneVelocity < 0 || contactArray[one].penetration > 0;
+    bool twoNeeded = twoVelocity < 0 || contactArray[two].penetration > 0;
+    if (oneNeeded != twoNeeded) return oneNeeded;
+    if (oneVelocity != twoVelocity) return oneVelocity < twoVelocity;
+    return one < two;
+}
+
+void ParticleContactResolver::updateHeap(ParticleContact *contactArray,
+                                         unsigned position)
+{
+    unsigned contact = heap[position];
+
+    // Move up past any parents it is worse than.
+    unsigned start = position;
+    while (position > 0)
+    {
+        unsigned parent = (position - 1) / 2;
+        if (!isWorse(contactArray, contact, heap[parent])) break;
+        heap[position] = heap[parent];
+        heapPositions[heap[position]] = position;
+        position = parent;
+    }
+    heap[position] = contact;
+    heapPositions[contact] = position;
+
+    // If it didn't move up, it may need to move down.
+    if (position == start) siftDown(contactArray, position);
+}
+
+void ParticleContactResolver::siftDown(ParticleContact *contactArray,
+                                       unsigned position)
+{
+    unsigned contact = heap[position];
+    unsigned count = (unsigned)heap.size();
+    for (;;)
+    {
+        unsigned child = position * 2 + 1;
+        if (child >= count) break;
+        if (child + 1 < count &&
+            isWorse(contactArray, heap[child + 1], heap[child]))
+        {
+            child++;
+        }
+        if (!isWorse(contactArray, heap[child], contact)) break;
+        heap[position] = heap[child];
+        heapPositions[heap[position]] = position;
+        position = child;
+    }
+    heap[position] = contact;
+    heapPositions[contact] = position;
+}
+
+void ParticleContactResolver::resolveIndexed(ParticleContact *contactArray,
+                                             unsigned numContacts,
+                                             real duration)
+{
+    iterationsUsed = 0;
+    if (numContacts == 0) return;
+
+    buildGroups(contactArray, numContacts);
+
+    // Work out every separating velocity once, and heap the contacts.
+    separatingVelocities.resize(numContacts);
+    heap.resize(numContacts);
+    heapPositions.resize(numContacts);
+    updateStamps.assign(numContacts, ~0u);
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        separatingVelocities[i] = contactArray[i].calculateSeparatingVelocity();
+        heap[i] = i;
+        heapPositions[i] = i;
+    }
+    for (unsigned i = numContacts / 2; i-- > 0; )
+    {
+        siftDown(contactArray, i);
+    }
+
+    while(iterationsUsed < iterations)
+    {
+        // Do we have anything worth resolving?
+        unsigned worst = heap[0];
+        ParticleContact &resolved = contactArray[worst];
+        if (!(separatingVelocities[worst] < 0 || resolved.penetration > 0))
+        {
+            break;
+        }
+
+        // Resolve this contact
+        resolved.resolve(duration);
+
+        // Only contacts sharing a particle with this one have been
+        // changed, so update just those.
+        for (unsigned b = 0; b < 2; b++)
+        {
+            unsigned group = contactGroups[worst * 2 + b];
+            if (group == ~0u) continue;
+
+            for (unsigned e = groupStarts[group];
+                 e < groupStarts[group + 1]; e++)
             {
-                contactArray[i].penetration -= move[0] * contactArray[i].contactNormal;
+                unsigned i = ends[e].contact;
+                if (updateStamps[i] == iterationsUsed) continue;
+                updateStamps[i] = iterationsUsed;
+
+                adjustPenetration(contactArray[i], resolved);
+                separatingVelocities[i] =
+                    contactArray[i].calculateSeparatingVelocity();
+                updateHeap(contactArray, heapPositions[i]);
             }
-            else if (contactArray[i].particle[0] == contactArray[maxIndex].particle[1])
+        }
+
+        iterationsUsed++;
+    }
+}
+
+void ParticleContactResolver::projectPositions(ParticleContact *contactArray,
+                                               unsigned numContacts)
+{
+    iterationsUsed = 0;
+    if (numContacts == 0) return;
+
+    // The groups let us track how far each particle has moved.
+    buildGroups(contactArray, numContacts);
+    groupMoves.assign(groupStarts.size() - 1, Vector3());
+
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        const ParticleContact &contact = contactArray[i];
+        unsigned one = contactGroups[i * 2];
+        unsigned two = contactGroups[i * 2 + 1];
+
+        // Work out how much penetration is left after the movement
+        // made by earlier contacts.
+        Vector3 relativeMove = groupMoves[one];
+        if (two != ~0u) relativeMove -= groupMoves[two];
+        real penetration = contact.penetration -
+            relativeMove * contact.contactNormal;
+        if (penetration <= 0) continue;
+
+        real totalInverseMass = contact.particle[0]->getInverseMass();
+        if (two != ~0u)
+        {
+            totalInverseMass += contact.particle[1]->getInverseMass();
+        }
+        if (totalInverseMass <= 0) continue;
+
+        // Move each particle in proportion to its inverse mass.
+        Vector3 movePerIMass = contact.contactNormal *
+            (penetration / totalInverseMass);
+        Vector3 move = movePerIMass * contact.particle[0]->getInverseMass();
+        contact.particle[0]->setPosition(
+            contact.particle[0]->getPosition() + move);
+        groupMoves[one] += move;
+        if (two != ~0u)
+        {
+            move = movePerIMass * -contact.particle[1]->getInverseMass();
+            contact.particle[1]->setPosition(
+                contact.particle[1]->getPosition() + move);
+            groupMoves[two] += move;
+        }
+
+        iterationsUsed++;
+    }
+}
+
+class ParticleContactResolver::JacobiTask : public ParallelTask
+{
+public:
+    ParticleContactResolver *resolver;
+    unsigned stage;
+
+    virtual void run(unsigned begin, unsigned end, unsigned thread)
+    {
+        switch (stage)
+        {
+        case 0: resolver->findCorrections(begin, end, thread); break;
+        case 1: resolver->applyCorrections(begin, end); break;
+        default: resolver->updatePenetrations(begin, end); break;
+        }
+    }
+};
+
+void ParticleContactResolver::findCorrections(unsigned begin, unsigned end,
+                                              unsigned thread)
+{
+    unsigned active = 0;
+    for (unsigned i = begin; i < end; i++)
+    {
+        const ParticleContact &contact = jacobiContacts[i];
+        contactImpulses[i].clear();
+        contactMoves[i].clear();
+        contactActive[i] = 0;
+
+        real totalInverseMass = contact.particle[0]->getInverseMass();
+        if (contact.particle[1])
+        {
+            totalInverseMass += contact.particle[1]->getInverseMass();
+        }
+        if (totalInverseMass <= 0) continue;
+
+        real separatingVelocity = contact.calculateSeparatingVelocity();
+        if (!(separatingVelocity < 0 || contact.penetration > 0)) continue;
+        contactActive[i] = 1;
+        active++;
+
+        if (separatingVelocity <= 0)
+        {
+            real deltaVelocity = contact.calculateVelocityChange(
+                separatingVelocity, jacobiDuration);
+            contactImpulses[i] = contact.contactNormal *
+                (deltaVelocity / totalInverseMass);
+        }
+        if (contact.penetration > 0)
+        {
+            contactMoves[i] = contact.contactNormal *
+                (contact.penetration / totalInverseMass);
+        }
+    }
+    threadActive[thread] += active;
+}
+
+void ParticleContactResolver::applyCorrections(unsigned begin, unsigned end)
+{
+    for (unsigned g = begin; g < end; g++)
+    {
+        Particle *particle = ends[groupStarts[g]].particle;
+
+        // Total the corrections in a fixed order, so the result
+        // doesn't depend on how the work was split up.
+        Vector3 impulse, move;
+        unsigned count = 0;
+        for (unsigned e = groupStarts[g]; e < groupStarts[g + 1]; e++)
+        {
+            unsigned i = ends[e].contact;
+            if (!contactActive[i]) continue;
+            count++;
+
+            if (jacobiContacts[i].particle[0] == particle)
+            {
+                impulse += contactImpulses[i];
+                move += contactMoves[i];
+            }
+            else
             {
-                contactArray[i].penetration -= move[1] * contactArray[i].contactNormal;
+                impulse -= contactImpulses[i];
+                move -= contactMoves[i];
             }
-            if (contactArray[i].particle[1])
+        }
+
+        if (count == 0)
+        {
+            groupMoves[g].clear();
+            continue;
+        }
+
+        // Each particle takes the average of its contacts' corrections.
+        real scale = particle->getInverseMass() / (real)count;
+        particle->setVelocity(particle->getVelocity() + impulse * scale);
+        groupMoves[g] = move * scale;
+        particle->setPosition(particle->getPosition() + groupMoves[g]);
+    }
+}
+
+void ParticleContactResolver::updatePenetrations(unsigned begin,
+                                                 unsigned end)
+{
+    for (unsigned i = begin; i < end; i++)
+    {
+        ParticleContact &contact = jacobiContacts[i];
+        for (unsigned b = 0; b < 2; b++)
+        {
+            unsigned group = contactGroups[i * 2 + b];
+            if (group == ~0u)
             {
-                if (contactArray[i].particle[1] == contactArray[maxIndex].particle[0])
-                {
-                    contactArray[i].penetration += move[0] * contactArray[i].contactNormal;
-                }
-                else if (contactArray[i].particle[1] == contactArray[maxIndex].particle[1])
-                {
-                    contactArray[i].penetration += move[1] * contactArray[i].contactNormal;
-                }
+                contact.particleMovement[b].clear();
+                continue;
             }
+            contact.particleMovement[b] = groupMoves[group];
+        }
+        contact.penetration -=
+            (contact.particleMovement[0] - contact.particleMovement[1]) *
+            contact.contactNormal;
+    }
+}
+
+void ParticleContactResolver::resolveJacobi(ParticleContact *contactArray,
+                                            unsigned numContacts,
+                                            real duration)
+{
+    iterationsUsed = 0;
+    if (numContacts == 0) return;
+
+    buildGroups(contactArray, numContacts);
+    unsigned groups = (unsigned)groupStarts.size() - 1;
+
+    jacobiContacts = contactArray;
+    jacobiDuration = duration;
+    contactImpulses.resize(numContacts);
+    contactMoves.resize(numContacts);
+    contactActive.resize(numContacts);
+    groupMoves.resize(groups);
+    threadActive.resize(jobs ? jobs->getThreadCount() : 1);
+
+    JacobiTask task;
+    task.resolver = this;
+    while (iterationsUsed < passes)
+    {
+        threadActive.assign(threadActive.size(), 0);
+
+        // Each stage only writes to its own items, and reads what the
+        // stage before it wrote, so the items can be split up freely.
+        task.stage = 0;
+        if (jobs) jobs->parallelFor(task, numContacts, 256);
+        else task.run(0, numContacts, 0);
+
+        unsigned active = 0;
+        for (unsigned t = 0; t < threadActive.size(); t++)
+        {
+            active += threadActive[t];
         }
+        if (active == 0) break;
+
+        task.stage = 1;
+        if (jobs) jobs->parallelFor(task, groups, 256);
+        else task.run(0, groups, 0);
+
+        task.stage = 2;
+        if (jobs) jobs->parallelFor(task, numContacts, 256);
+        else task.run(0, numContacts, 0);
 
         iterationsUsed++;
     }
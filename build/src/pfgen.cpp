@@ -49,6 +49,15 @@ void ParticleForceRegistry::remove(Particle* particle, ParticleForceGenerator *f
 	}
 }
 
+void ParticleForceGenerator::updateForces(Particle * const *particles,
+                                          unsigned count, real duration)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        updateForce(particles[i], duration);
+    }
+}
+
 ParticleGravity::ParticleGravity()
 {
 	m_gravity = cyclone::Vector3(0.0f, -0.0f, 0.0f);
@@ -67,6 +76,17 @@ void ParticleGravity::updateForce(Particle* particle, real duration)
     particle->addForce(m_gravity * particle->getMass());
 }
 
+void ParticleGravity::updateForces(Particle * const *particles,
+                                   unsigned count, real duration)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        Particle *particle = particles[i];
+        if (!particle->hasFiniteMass()) continue;
+        particle->addForce(m_gravity * particle->getMass());
+    }
+}
+
 ParticleDrag::ParticleDrag(real k1, real k2)
 : k1(k1), k2(k2)
 {
@@ -0,0 +1,84 @@
+/*
+ * Implementation file for the particle neighbour grid.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <cyclone/pgrid.h>
+
+using namespace cyclone;
+
+ParticleGrid::ParticleGrid(real cellSize)
+:
+grid(cellSize),
+particles(NULL)
+{
+}
+
+void ParticleGrid::setCellSize(real size)
+{
+    grid.setCellSize(size);
+}
+
+real ParticleGrid::getCellSize() const
+{
+    return grid.getCellSize();
+}
+
+void ParticleGrid::build(Particle * const *particles, unsigned count)
+{
+    ParticleGrid::particles = particles;
+
+    grid.setCount(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        grid.setPoint(i, particles[i]->getPosition());
+    }
+    grid.sort();
+}
+
+void ParticleGrid::build(const ParticleSet &set)
+{
+    particles = NULL;
+
+    unsigned count = set.size();
+    const real *x = set.getArray(ParticleSet::POSITION_X);
+    const real *y = set.getArray(ParticleSet::POSITION_Y);
+    const real *z = set.getArray(ParticleSet::POSITION_Z);
+
+    grid.setCount(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        grid.setPoint(i, Vector3(x[i], y[i], z[i]));
+    }
+    grid.sort();
+}
+
+unsigned ParticleGrid::getCount() const
+{
+    return grid.getCount();
+}
+
+Particle* ParticleGrid::getParticle(unsigned index) const
+{
+    if (particles == NULL || index >= grid.getCount()) return NULL;
+    return particles[index];
+}
+
+unsigned ParticleGrid::findNeighbours(const Vector3 &centre, real radius,
+                                      std::vector<unsigned> *results) const
+{
+    return grid.findNear(centre, radius, results);
+}
+
+unsigned ParticleGrid::findPairs(real radius,
+                                 std::vector<ParticlePair> *pairs) const
+{
+    return grid.findPairs(radius, pairs);
+}
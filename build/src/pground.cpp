@@ -0,0 +1,246 @@
+/*
+ * Implementation file for the ground that particles rest on.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <assert.h>
+#include <cyclone/pground.h>
+
+using namespace cyclone;
+
+Heightfield::Heightfield(real height)
+:
+columns(0), rows(0),
+spacing(1),
+originX(0), originZ(0),
+flatHeight(height)
+{
+}
+
+void Heightfield::setFlat(real height)
+{
+    samples.clear();
+    columns = rows = 0;
+    flatHeight = height;
+}
+
+void Heightfield::setSamples(unsigned columns, unsigned rows, real spacing,
+                             real originX, real originZ,
+                             const real *heights)
+{
+    assert(columns >= 2 && rows >= 2);
+
+    Heightfield::columns = columns;
+    Heightfield::rows = rows;
+    Heightfield::spacing = spacing;
+    Heightfield::originX = originX;
+    Heightfield::originZ = originZ;
+    samples.assign(heights, heights + columns * rows);
+}
+
+bool Heightfield::isFlat() const
+{
+    return samples.empty();
+}
+
+void Heightfield::findCell(real x, real z, unsigned *column, unsigned *row,
+                           real *fracX, real *fracZ) const
+{
+    real inverseSpacing = ((real)1.0) / spacing;
+    real u = (x - originX) * inverseSpacing;
+    real v = (z - originZ) * inverseSpacing;
+
+    // Clamp to the grid, so the edge heights carry on outside it.
+    real maxU = (real)(columns - 1), maxV = (real)(rows - 1);
+    if (u < 0) u = 0; else if (u > maxU) u = maxU;
+    if (v < 0) v = 0; else if (v > maxV) v = maxV;
+
+    *column = (unsigned)u;
+    *row = (unsigned)v;
+    if (*column > columns - 2) *column = columns - 2;
+    if (*row > rows - 2) *row = rows - 2;
+    *fracX = u - (real)*column;
+    *fracZ = v - (real)*row;
+}
+
+real Heightfield::getHeight(real x, real z) const
+{
+    real height;
+    getHeights(&x, &z, 1, &height);
+    return height;
+}
+
+void Heightfield::getHeights(const real *x, const real *z, unsigned count,
+                             real *heights) const
+{
+    if (samples.empty())
+    {
+        for (unsigned i = 0; i < count; i++) heights[i] = flatHeight;
+        return;
+    }
+
+    // Interpolate between the four samples around each point.
+    const real *grid = &samples[0];
+    for (unsigned i = 0; i < count; i++)
+    {
+        unsigned column, row;
+        real fracX, fracZ;
+        findCell(x[i], z[i], &column, &row, &fracX, &fracZ);
+
+        const real *front = grid + row * columns + column;
+        const real *back = front + columns;
+        real frontHeight = front[0] * (1 - fracX) + front[1] * fracX;
+        real backHeight = back[0] * (1 - fracX) + back[1] * fracX;
+        heights[i] = frontHeight * (1 - fracZ) + backHeight * fracZ;
+    }
+}
+
+Vector3 Heightfield::getNormal(real x, real z) const
+{
+    if (samples.empty()) return Vector3::UP;
+
+    unsigned column, row;
+    real fracX, fracZ;
+    findCell(x, z, &column, &row, &fracX, &fracZ);
+
+    // Find the slope of the interpolated surface. Outside the grid
+    // the ground is level in the direction it was clamped.
+    const real *front = &samples[0] + row * columns + column;
+    const real *back = front + columns;
+    real inverseSpacing = ((real)1.0) / spacing;
+    real slopeX = ((front[1] - front[0]) * (1 - fracZ) +
+                   (back[1] - back[0]) * fracZ) * inverseSpacing;
+    real slopeZ = ((back[0] - front[0]) * (1 - fracX) +
+                   (back[1] - front[1]) * fracX) * inverseSpacing;
+
+    real u = (x - originX) * inverseSpacing;
+    real v = (z - originZ) * inverseSpacing;
+    if (u < 0 || u > (real)(columns - 1)) slopeX = 0;
+    if (v < 0 || v > (real)(rows - 1)) slopeZ = 0;
+
+    Vector3 normal(-slopeX, 1, -slopeZ);
+    normal.normalise();
+    return normal;
+}
+
+/**
+ * Turns the ground heights under a number of particles into how far
+ * each particle is below the ground, given the particles' heights.
+ */
+static void calculateDepths(const real * CYCLONE_RESTRICT positions,
+                            real * CYCLONE_RESTRICT depths,
+                            unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        depths[i] -= positions[i];
+    }
+}
+
+ParticleGroundContacts::ParticleGroundContacts()
+:
+particles(NULL),
+ground(NULL),
+defaultRestitution(0.2f)
+{
+}
+
+void ParticleGroundContacts::init(std::vector<Particle*> *particles)
+{
+    ParticleGroundContacts::particles = particles;
+}
+
+void ParticleGroundContacts::setGround(const Heightfield *ground)
+{
+    ParticleGroundContacts::ground = ground;
+}
+
+void ParticleGroundContacts::setDefaultRestitution(real restitution)
+{
+    defaultRestitution = restitution;
+}
+
+void ParticleGroundContacts::setRestitution(unsigned index,
+                                            real restitution)
+{
+    if (index >= restitutions.size())
+    {
+        restitutions.resize(index + 1, defaultRestitution);
+    }
+    restitutions[index] = restitution;
+}
+
+real ParticleGroundContacts::getRestitution(unsigned index) const
+{
+    if (index < restitutions.size()) return restitutions[index];
+    return defaultRestitution;
+}
+
+unsigned ParticleGroundContacts::addContact(ParticleContact *contact,
+                                            unsigned limit) const
+{
+    unsigned count = (unsigned)particles->size();
+    if (count == 0) return 0;
+    Particle * const *list = &(*particles)[0];
+
+    // Gather the positions.
+    positionX.resize(count);
+    positionY.resize(count);
+    positionZ.resize(count);
+    depths.resize(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        const Vector3 &position = list[i]->getPosition();
+        positionX[i] = position.x;
+        positionY[i] = position.y;
+        positionZ[i] = position.z;
+    }
+
+    // Find the ground under all of them, then how deep each is.
+    if (ground)
+    {
+        ground->getHeights(positionX.data(), positionZ.data(), count,
+                           depths.data());
+    }
+    else
+    {
+        for (unsigned i = 0; i < count; i++) depths[i] = 0;
+    }
+    calculateDepths(positionY.data(), depths.data(), count);
+
+    // Then write out a contact for each particle below the ground.
+    bool flat = !ground || ground->isFlat();
+    unsigned used = 0;
+    for (unsigned i = 0; i < count && used < limit; i++)
+    {
+        real depth = depths[i];
+        if (depth <= 0) continue;
+
+        contact->particle[0] = list[i];
+        contact->particle[1] = NULL;
+        if (flat)
+        {
+            contact->contactNormal = Vector3::UP;
+            contact->penetration = depth;
+        }
+        else
+        {
+            // On a slope the depth straight down is more than the
+            // depth along the normal.
+            contact->contactNormal =
+                ground->getNormal(positionX[i], positionZ[i]);
+            contact->penetration = depth * contact->contactNormal.y;
+        }
+        contact->restitution = getRestitution(i);
+        contact++;
+        used++;
+    }
+    return used;
+}
@@ -149,4 +149,204 @@ unsigned ParticleRodConstraint::addContact(ParticleContact *contact,
     contact->restitution = 0;
 
     return 1;
-}
\ No newline at end of file
+}
+
+/**
+ * Works out the length of each of a number of separations.
+ */
+static void calculateLengths(const real * CYCLONE_RESTRICT x,
+                             const real * CYCLONE_RESTRICT y,
+                             const real * CYCLONE_RESTRICT z,
+                             real * CYCLONE_RESTRICT lengths,
+                             unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        lengths[i] = real_sqrt(x[i]*x[i] + y[i]*y[i] + z[i]*z[i]);
+    }
+}
+
+ParticleLinkSet::ParticleLinkSet()
+:
+particles(NULL)
+{
+}
+
+void ParticleLinkSet::init(std::vector<Particle*> *particles)
+{
+    ParticleLinkSet::particles = particles;
+}
+
+unsigned ParticleLinkSet::addLink(unsigned first, unsigned second,
+                                  real length)
+{
+    firsts.push_back(first);
+    seconds.push_back(second);
+    lengths.push_back(length);
+    return lengths.size() - 1;
+}
+
+unsigned ParticleLinkSet::getCount() const
+{
+    return lengths.size();
+}
+
+Particle* ParticleLinkSet::getFirst(unsigned index) const
+{
+    return (*particles)[firsts[index]];
+}
+
+Particle* ParticleLinkSet::getSecond(unsigned index) const
+{
+    return (*particles)[seconds[index]];
+}
+
+real ParticleLinkSet::getLength(unsigned index) const
+{
+    return lengths[index];
+}
+
+void ParticleLinkSet::setLength(unsigned index, real length)
+{
+    lengths[index] = length;
+}
+
+void ParticleLinkSet::remove(unsigned index)
+{
+    unsigned last = lengths.size() - 1;
+    firsts[index] = firsts[last];
+    seconds[index] = seconds[last];
+    lengths[index] = lengths[last];
+    firsts.pop_back();
+    seconds.pop_back();
+    lengths.pop_back();
+}
+
+void ParticleLinkSet::clear()
+{
+    firsts.clear();
+    seconds.clear();
+    lengths.clear();
+}
+
+void ParticleLinkSet::measure() const
+{
+    unsigned count = lengths.size();
+    separationX.resize(count);
+    separationY.resize(count);
+    separationZ.resize(count);
+    currentLengths.resize(count);
+
+    // Gather the separations, then find all the lengths at once.
+    Particle * const *list = particles->empty() ? NULL : &(*particles)[0];
+    for (unsigned i = 0; i < count; i++)
+    {
+        Vector3 separation = list[seconds[i]]->getPosition() -
+                             list[firsts[i]]->getPosition();
+        separationX[i] = separation.x;
+        separationY[i] = separation.y;
+        separationZ[i] = separation.z;
+    }
+    calculateLengths(separationX.data(), separationY.data(),
+                     separationZ.data(), currentLengths.data(), count);
+}
+
+void ParticleLinkSet::fillContact(ParticleContact *contact,
+                                  unsigned index) const
+{
+    contact->particle[0] = (*particles)[firsts[index]];
+    contact->particle[1] = (*particles)[seconds[index]];
+
+    Vector3 normal(separationX[index], separationY[index],
+                   separationZ[index]);
+    real length = currentLengths[index];
+    if (length > 0) normal *= ((real)1)/length;
+    contact->contactNormal = normal;
+}
+
+unsigned ParticleCableSet::add(unsigned first, unsigned second,
+                               real maxLength, real restitution)
+{
+    restitutions.push_back(restitution);
+    return addLink(first, second, maxLength);
+}
+
+real ParticleCableSet::getRestitution(unsigned index) const
+{
+    return restitutions[index];
+}
+
+void ParticleCableSet::setRestitution(unsigned index, real restitution)
+{
+    restitutions[index] = restitution;
+}
+
+void ParticleCableSet::remove(unsigned index)
+{
+    restitutions[index] = restitutions[restitutions.size() - 1];
+    restitutions.pop_back();
+    ParticleLinkSet::remove(index);
+}
+
+void ParticleCableSet::clear()
+{
+    restitutions.clear();
+    ParticleLinkSet::clear();
+}
+
+unsigned ParticleCableSet::addContact(ParticleContact *contact,
+                                      unsigned limit) const
+{
+    measure();
+
+    unsigned used = 0;
+    unsigned count = lengths.size();
+    for (unsigned i = 0; i < count && used < limit; i++)
+    {
+        // Check if we're over-extended
+        if (currentLengths[i] < lengths[i]) continue;
+
+        fillContact(contact, i);
+        contact->penetration = currentLengths[i] - lengths[i];
+        contact->restitution = restitutions[i];
+        contact++;
+        used++;
+    }
+    return used;
+}
+
+unsigned ParticleRodSet::add(unsigned first, unsigned second, real length)
+{
+    return addLink(first, second, length);
+}
+
+unsigned ParticleRodSet::addContact(ParticleContact *contact,
+                                    unsigned limit) const
+{
+    measure();
+
+    unsigned used = 0;
+    unsigned count = lengths.size();
+    for (unsigned i = 0; i < count && used < limit; i++)
+    {
+        real currentLen = currentLengths[i];
+        if (currentLen == lengths[i]) continue;
+
+        fillContact(contact, i);
+
+        // The contact normal depends on whether we're extending or
+        // compressing
+        if (currentLen > lengths[i]) {
+            contact->penetration = currentLen - lengths[i];
+        } else {
+            contact->contactNormal = contact->contactNormal * -1;
+            contact->penetration = lengths[i] - currentLen;
+        }
+
+        // Always use zero restitution (no bounciness)
+        contact->restitution = 0;
+        contact++;
+        used++;
+    }
+    return used;
+}
@@ -0,0 +1,305 @@
+/*
+ * Implementation file for implicitly integrated networks of springs.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <cyclone/pnetwork.h>
+
+using namespace cyclone;
+
+ParticleSpringNetwork::ParticleSpringNetwork()
+:
+particles(NULL),
+iterations(20),
+iterationsUsed(0),
+tolerance((real)0.001)
+{
+}
+
+void ParticleSpringNetwork::init(std::vector<Particle*> *particles)
+{
+    ParticleSpringNetwork::particles = particles;
+}
+
+unsigned ParticleSpringNetwork::addSpring(unsigned first, unsigned second,
+                                          real springConstant,
+                                          real restLength, real damping)
+{
+    Spring spring;
+    spring.first = first;
+    spring.second = second;
+    spring.springConstant = springConstant;
+    spring.restLength = restLength;
+    spring.damping = damping;
+    spring.pullOnly = false;
+    springs.push_back(spring);
+    return (unsigned)springs.size() - 1;
+}
+
+unsigned ParticleSpringNetwork::addBungee(unsigned first, unsigned second,
+                                          real springConstant,
+                                          real restLength, real damping)
+{
+    unsigned index = addSpring(first, second, springConstant,
+                               restLength, damping);
+    springs[index].pullOnly = true;
+    return index;
+}
+
+unsigned ParticleSpringNetwork::getSpringCount() const
+{
+    return (unsigned)springs.size();
+}
+
+void ParticleSpringNetwork::clear()
+{
+    springs.clear();
+    solution.clear();
+}
+
+void ParticleSpringNetwork::setIterations(unsigned iterations)
+{
+    ParticleSpringNetwork::iterations = iterations;
+}
+
+unsigned ParticleSpringNetwork::getIterations() const
+{
+    return iterations;
+}
+
+unsigned ParticleSpringNetwork::getIterationsUsed() const
+{
+    return iterationsUsed;
+}
+
+void ParticleSpringNetwork::setTolerance(real tolerance)
+{
+    ParticleSpringNetwork::tolerance = tolerance;
+}
+
+void ParticleSpringNetwork::buildSystem(real duration)
+{
+    unsigned count = (unsigned)particles->size();
+    masses.resize(count);
+    preconditioner.resize(count);
+    rhs.assign(count, Vector3());
+    solution.resize(count);
+
+    // Each particle's diagonal block starts as its mass.
+    for (unsigned i = 0; i < count; i++)
+    {
+        real inverseMass = (*particles)[i]->getInverseMass();
+        masses[i] = inverseMass > 0 ? ((real)1.0) / inverseMass : 0;
+        preconditioner[i].setDiagonal(masses[i], masses[i], masses[i]);
+    }
+
+    // The system is (M - h.D - h^2.K) dv = h.(f + h.K.v), where K and
+    // D are the derivatives of the spring forces with respect to
+    // position and velocity. Each spring adds the same block, B, to
+    // the diagonal blocks of both its particles, and takes it from
+    // the blocks between them.
+    springBlocks.resize(springs.size());
+    for (unsigned s = 0; s < springs.size(); s++)
+    {
+        const Spring &spring = springs[s];
+        Matrix3 &block = springBlocks[s];
+
+        const Particle *one = (*particles)[spring.first];
+        const Particle *two = (*particles)[spring.second];
+        Vector3 separation = one->getPosition() - two->getPosition();
+        real length = separation.magnitude();
+        if (length <= 0 || (spring.pullOnly && length <= spring.restLength))
+        {
+            block = Matrix3();
+            continue;
+        }
+        Vector3 normal = separation * (((real)1.0) / length);
+        Vector3 relativeVelocity = one->getVelocity() - two->getVelocity();
+
+        // The force on the first particle, along the spring.
+        real force = -spring.springConstant * (length - spring.restLength) -
+            spring.damping * (relativeVelocity * normal);
+
+        // The stiffness is k along the spring, and k(1 - L/l) across
+        // it. Across a squashed spring that would be negative, and
+        // the system would no longer be positive definite, so it is
+        // left out there.
+        real across = 1 - spring.restLength / length;
+        if (across < 0) across = 0;
+        across *= spring.springConstant;
+        real along = spring.springConstant - across;
+
+        real h2 = duration * duration;
+        real iso = h2 * across;
+        real axial = h2 * along + duration * spring.damping;
+        block = Matrix3(
+            iso + axial * normal.x * normal.x,
+            axial * normal.x * normal.y,
+            axial * normal.x * normal.z,
+            axial * normal.y * normal.x,
+            iso + axial * normal.y * normal.y,
+            axial * normal.y * normal.z,
+            axial * normal.z * normal.x,
+            axial * normal.z * normal.y,
+            iso + axial * normal.z * normal.z
+            );
+        preconditioner[spring.first] += block;
+        preconditioner[spring.second] += block;
+
+        // The stiffness applied to the relative velocity.
+        Vector3 stiffVelocity = relativeVelocity * across +
+            normal * (along * (normal * relativeVelocity));
+        Vector3 change = normal * (force * duration) - stiffVelocity * h2;
+        rhs[spring.first] += change;
+        rhs[spring.second] -= change;
+    }
+
+    // Invert the diagonal blocks, and clear the rows of particles
+    // that are held still.
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (masses[i] > 0)
+        {
+            Matrix3 diagonal = preconditioner[i];
+            preconditioner[i].setInverse(diagonal);
+        }
+        else
+        {
+            preconditioner[i] = Matrix3();
+            rhs[i].clear();
+            solution[i].clear();
+        }
+    }
+}
+
+void ParticleSpringNetwork::multiply(const Vector3 *vector,
+                                     Vector3 *result) const
+{
+    unsigned count = (unsigned)masses.size();
+    for (unsigned i = 0; i < count; i++)
+    {
+        result[i] = vector[i] * masses[i];
+    }
+    for (unsigned s = 0; s < springs.size(); s++)
+    {
+        const Spring &spring = springs[s];
+        Vector3 change = springBlocks[s] *
+            (vector[spring.first] - vector[spring.second]);
+        result[spring.first] += change;
+        result[spring.second] -= change;
+    }
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (masses[i] <= 0) result[i].clear();
+    }
+}
+
+void ParticleSpringNetwork::solve()
+{
+    iterationsUsed = 0;
+    unsigned count = (unsigned)masses.size();
+    if (count == 0) return;
+
+    residual.resize(count);
+    preconditioned.resize(count);
+    direction.resize(count);
+    product.resize(count);
+
+    real rhsSize = 0;
+    for (unsigned i = 0; i < count; i++) rhsSize += rhs[i] * rhs[i];
+    if (rhsSize <= 0)
+    {
+        solution.assign(count, Vector3());
+        return;
+    }
+    real limit = tolerance * tolerance * rhsSize;
+
+    // Start from last frame's solution, scaled to whatever multiple
+    // of it best fits this frame. A stale solution can be further
+    // from the answer than no solution at all, and truncating the
+    // solve then feeds the error back into the next frame; the best
+    // multiple is never worse than starting from zero.
+    multiply(&solution[0], &product[0]);
+    real fit = 0;
+    real curvature = 0;
+    for (unsigned i = 0; i < count; i++)
+    {
+        fit += rhs[i] * solution[i];
+        curvature += solution[i] * product[i];
+    }
+    real warmth = (fit > 0 && curvature > 0) ? fit / curvature : 0;
+    for (unsigned i = 0; i < count; i++)
+    {
+        solution[i] *= warmth;
+        product[i] *= warmth;
+    }
+
+    real residualSize = 0;
+    real alignment = 0;
+    for (unsigned i = 0; i < count; i++)
+    {
+        residual[i] = rhs[i] - product[i];
+        preconditioned[i] = preconditioner[i] * residual[i];
+        direction[i] = preconditioned[i];
+        residualSize += residual[i] * residual[i];
+        alignment += residual[i] * preconditioned[i];
+    }
+
+    while (iterationsUsed < iterations && residualSize > limit)
+    {
+        multiply(&direction[0], &product[0]);
+        real curvature = 0;
+        for (unsigned i = 0; i < count; i++)
+        {
+            curvature += direction[i] * product[i];
+        }
+        if (curvature <= 0) break;
+
+        // Step along the search direction.
+        real step = alignment / curvature;
+        residualSize = 0;
+        real newAlignment = 0;
+        for (unsigned i = 0; i < count; i++)
+        {
+            solution[i].addScaledVector(direction[i], step);
+            residual[i].addScaledVector(product[i], -step);
+            preconditioned[i] = preconditioner[i] * residual[i];
+            residualSize += residual[i] * residual[i];
+            newAlignment += residual[i] * preconditioned[i];
+        }
+
+        // And pick the next direction.
+        real scale = newAlignment / alignment;
+        alignment = newAlignment;
+        for (unsigned i = 0; i < count; i++)
+        {
+            direction[i] = preconditioned[i] + direction[i] * scale;
+        }
+
+        iterationsUsed++;
+    }
+}
+
+void ParticleSpringNetwork::updateForces(real duration)
+{
+    if (!particles || duration <= 0) return;
+
+    buildSystem(duration);
+    solve();
+
+    // Apply the force that gives each particle its velocity change
+    // over the step.
+    real inverseDuration = ((real)1.0) / duration;
+    for (unsigned i = 0; i < masses.size(); i++)
+    {
+        if (masses[i] <= 0) continue;
+        (*particles)[i]->addForce(solution[i] * (masses[i] * inverseDuration));
+    }
+}
@@ -0,0 +1,355 @@
+/*
+ * Implementation file for the structure-of-arrays particle set.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <assert.h>
+#include <cyclone/pset.h>
+
+using namespace cyclone;
+
+/*
+ * --------------------------------------------------------------------------
+ * PARTICLE REFERENCES
+ * --------------------------------------------------------------------------
+ */
+
+void ParticleRef::setMass(const real mass)
+{
+    assert(mass != 0);
+    set->getArray(ParticleSet::INVERSE_MASS)[index] = ((real)1.0)/mass;
+}
+
+real ParticleRef::getMass() const
+{
+    real inverseMass = getInverseMass();
+    if (inverseMass == 0) {
+        return REAL_MAX;
+    } else {
+        return ((real)1.0)/inverseMass;
+    }
+}
+
+void ParticleRef::setInverseMass(const real inverseMass)
+{
+    set->getArray(ParticleSet::INVERSE_MASS)[index] = inverseMass;
+}
+
+real ParticleRef::getInverseMass() const
+{
+    return set->getArray(ParticleSet::INVERSE_MASS)[index];
+}
+
+bool ParticleRef::hasFiniteMass() const
+{
+    return getInverseMass() >= 0.0f;
+}
+
+void ParticleRef::setDamping(const real damping)
+{
+    set->setDamping(index, damping);
+}
+
+real ParticleRef::getDamping() const
+{
+    return set->getArray(ParticleSet::DAMPING)[index];
+}
+
+void ParticleRef::setPosition(const Vector3 &position)
+{
+    setPosition(position.x, position.y, position.z);
+}
+
+void ParticleRef::setPosition(const real x, const real y, const real z)
+{
+    set->getArray(ParticleSet::POSITION_X)[index] = x;
+    set->getArray(ParticleSet::POSITION_Y)[index] = y;
+    set->getArray(ParticleSet::POSITION_Z)[index] = z;
+}
+
+Vector3 ParticleRef::getPosition() const
+{
+    return Vector3(set->getArray(ParticleSet::POSITION_X)[index],
+                   set->getArray(ParticleSet::POSITION_Y)[index],
+                   set->getArray(ParticleSet::POSITION_Z)[index]);
+}
+
+void ParticleRef::setVelocity(const Vector3 &velocity)
+{
+    setVelocity(velocity.x, velocity.y, velocity.z);
+}
+
+void ParticleRef::setVelocity(const real x, const real y, const real z)
+{
+    set->getArray(ParticleSet::VELOCITY_X)[index] = x;
+    set->getArray(ParticleSet::VELOCITY_Y)[index] = y;
+    set->getArray(ParticleSet::VELOCITY_Z)[index] = z;
+}
+
+Vector3 ParticleRef::getVelocity() const
+{
+    return Vector3(set->getArray(ParticleSet::VELOCITY_X)[index],
+                   set->getArray(ParticleSet::VELOCITY_Y)[index],
+                   set->getArray(ParticleSet::VELOCITY_Z)[index]);
+}
+
+void ParticleRef::setAcceleration(const Vector3 &acceleration)
+{
+    setAcceleration(acceleration.x, acceleration.y, acceleration.z);
+}
+
+void ParticleRef::setAcceleration(const real x, const real y, const real z)
+{
+    set->getArray(ParticleSet::ACCELERATION_X)[index] = x;
+    set->getArray(ParticleSet::ACCELERATION_Y)[index] = y;
+    set->getArray(ParticleSet::ACCELERATION_Z)[index] = z;
+}
+
+Vector3 ParticleRef::getAcceleration() const
+{
+    return Vector3(set->getArray(ParticleSet::ACCELERATION_X)[index],
+                   set->getArray(ParticleSet::ACCELERATION_Y)[index],
+                   set->getArray(ParticleSet::ACCELERATION_Z)[index]);
+}
+
+void ParticleRef::clearAccumulator()
+{
+    set->getArray(ParticleSet::FORCE_X)[index] = 0;
+    set->getArray(ParticleSet::FORCE_Y)[index] = 0;
+    set->getArray(ParticleSet::FORCE_Z)[index] = 0;
+}
+
+void ParticleRef::addForce(const Vector3 &force)
+{
+    set->getArray(ParticleSet::FORCE_X)[index] += force.x;
+    set->getArray(ParticleSet::FORCE_Y)[index] += force.y;
+    set->getArray(ParticleSet::FORCE_Z)[index] += force.z;
+}
+
+/*
+ * --------------------------------------------------------------------------
+ * PARTICLE SETS
+ * --------------------------------------------------------------------------
+ */
+
+ParticleSet::ParticleSet()
+:
+factorDuration(0)
+{
+}
+
+void ParticleSet::reserve(unsigned count)
+{
+    for (unsigned a = 0; a < ARRAY_COUNT; a++) arrays[a].reserve(count);
+    dampingFactors.reserve(count);
+    movingMasks.reserve(count);
+}
+
+unsigned ParticleSet::add(real mass, real damping)
+{
+    assert(mass != 0);
+    unsigned index = size();
+    for (unsigned a = 0; a < ARRAY_COUNT; a++) arrays[a].push_back(0);
+    arrays[INVERSE_MASS][index] = ((real)1.0)/mass;
+    dampingFactors.push_back(1);
+    setDamping(index, damping);
+    return index;
+}
+
+unsigned ParticleSet::addBlock(unsigned count, real mass, real damping)
+{
+    assert(mass != 0);
+    unsigned first = size();
+    unsigned end = first + count;
+    for (unsigned a = 0; a < ARRAY_COUNT; a++)
+    {
+        real value = 0;
+        if (a == INVERSE_MASS) value = ((real)1.0)/mass;
+        else if (a == DAMPING) value = damping;
+        arrays[a].resize(end, value);
+    }
+
+    // They all share one damping factor.
+    real factor = 1;
+    if (factorDuration > 0) factor = real_pow(damping, factorDuration);
+    dampingFactors.resize(end, factor);
+    return first;
+}
+
+unsigned ParticleSet::add(const Particle &particle)
+{
+    unsigned index = add();
+    set(index, particle);
+    return index;
+}
+
+void ParticleSet::remove(unsigned index)
+{
+    unsigned last = size() - 1;
+    for (unsigned a = 0; a < ARRAY_COUNT; a++)
+    {
+        arrays[a][index] = arrays[a][last];
+        arrays[a].pop_back();
+    }
+    dampingFactors[index] = dampingFactors[last];
+    dampingFactors.pop_back();
+}
+
+void ParticleSet::removeSorted(const unsigned *indices, unsigned count)
+{
+    for (unsigned a = 0; a < ARRAY_COUNT; a++)
+    {
+        arrays[a].removeSorted(indices, count);
+    }
+    dampingFactors.removeSorted(indices, count);
+}
+
+void ParticleSet::clear()
+{
+    for (unsigned a = 0; a < ARRAY_COUNT; a++) arrays[a].clear();
+    dampingFactors.clear();
+}
+
+unsigned ParticleSet::size() const
+{
+    return arrays[0].size();
+}
+
+ParticleRef ParticleSet::operator[](unsigned index)
+{
+    return ParticleRef(this, index);
+}
+
+void ParticleSet::get(unsigned index, Particle *particle) const
+{
+    particle->setPosition(arrays[POSITION_X][index],
+                          arrays[POSITION_Y][index],
+                          arrays[POSITION_Z][index]);
+    particle->setVelocity(arrays[VELOCITY_X][index],
+                          arrays[VELOCITY_Y][index],
+                          arrays[VELOCITY_Z][index]);
+    particle->setAcceleration(arrays[ACCELERATION_X][index],
+                              arrays[ACCELERATION_Y][index],
+                              arrays[ACCELERATION_Z][index]);
+    particle->setInverseMass(arrays[INVERSE_MASS][index]);
+    particle->setDamping(arrays[DAMPING][index]);
+    particle->clearAccumulator();
+}
+
+void ParticleSet::set(unsigned index, const Particle &particle)
+{
+    ParticleRef target(this, index);
+    target.setPosition(particle.getPosition());
+    target.setVelocity(particle.getVelocity());
+    target.setAcceleration(particle.getAcceleration());
+    target.setInverseMass(particle.getInverseMass());
+    target.setDamping(particle.getDamping());
+    target.clearAccumulator();
+}
+
+real* ParticleSet::getArray(Array array)
+{
+    return arrays[array].data();
+}
+
+const real* ParticleSet::getArray(Array array) const
+{
+    return arrays[array].data();
+}
+
+void ParticleSet::setDamping(unsigned index, real damping)
+{
+    arrays[DAMPING][index] = damping;
+    if (factorDuration > 0)
+    {
+        dampingFactors[index] = real_pow(damping, factorDuration);
+    }
+}
+
+void ParticleSet::clearAccumulators()
+{
+    unsigned count = size();
+    for (unsigned a = FORCE_X; a <= FORCE_Z; a++)
+    {
+        real *force = arrays[a].data();
+        for (unsigned i = 0; i < count; i++) force[i] = 0;
+    }
+}
+
+/**
+ * Integrates one axis of a set of particles.
+ */
+static void integrateAxis(real *CYCLONE_RESTRICT position,
+                          real *CYCLONE_RESTRICT velocity,
+                          const real *CYCLONE_RESTRICT acceleration,
+                          real *CYCLONE_RESTRICT force,
+                          const real *CYCLONE_RESTRICT inverseMass,
+                          const real *CYCLONE_RESTRICT moving,
+                          const real *CYCLONE_RESTRICT damping,
+                          unsigned count, real duration)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        // A step of zero and a damping factor of one leave a fixed
+        // particle exactly where it was, and it keeps its force, as
+        // Particle::integrate leaves it.
+        real step = duration * moving[i];
+        real drag = damping[i] * moving[i] + (1 - moving[i]);
+        real v = velocity[i];
+
+        // Update the position, then the velocity from the
+        // acceleration and force, then impose drag.
+        position[i] += v * step;
+        velocity[i] = (v + (acceleration[i] +
+            force[i] * inverseMass[i]) * step) * drag;
+        force[i] *= 1 - moving[i];
+    }
+}
+
+void ParticleSet::integrateAll(real duration)
+{
+    assert(duration > 0.0);
+    unsigned count = size();
+    if (count == 0) return;
+
+    // The powers are only worked out again when the duration changes.
+    real *factor = dampingFactors.data();
+    if (duration != factorDuration)
+    {
+        const real *damping = arrays[DAMPING].data();
+        for (unsigned i = 0; i < count; i++)
+        {
+            factor[i] = real_pow(damping[i], duration);
+        }
+        factorDuration = duration;
+    }
+
+    // Particles of infinite mass don't move. They are masked out
+    // with arithmetic rather than branched around, to keep the loops
+    // below free of comparisons, which stop them being vectorised.
+    const real *inverseMass = arrays[INVERSE_MASS].data();
+    movingMasks.resize(count);
+    real *moving = movingMasks.data();
+    for (unsigned i = 0; i < count; i++)
+    {
+        moving[i] = inverseMass[i] > 0 ? (real)1 : (real)0;
+    }
+
+    // Each axis is integrated in its own loop, so each loop only
+    // touches a handful of arrays.
+    for (unsigned axis = 0; axis < 3; axis++)
+    {
+        integrateAxis(arrays[POSITION_X + axis].data(),
+                      arrays[VELOCITY_X + axis].data(),
+                      arrays[ACCELERATION_X + axis].data(),
+                      arrays[FORCE_X + axis].data(),
+                      inverseMass, moving, factor, count, duration);
+    }
+}
@@ -0,0 +1,275 @@
+/*
+ * Implementation file for particle systems.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <cyclone/psystem.h>
+
+using namespace cyclone;
+
+ParticleRule::ParticleRule()
+:
+minAge(1), maxAge(1),
+damping((real)0.99),
+mass(1),
+acceleration(Vector3::GRAVITY)
+{
+}
+
+void ParticleRule::setParameters(real minAge, real maxAge,
+                                 const Vector3 &minVelocity,
+                                 const Vector3 &maxVelocity,
+                                 real damping)
+{
+    ParticleRule::minAge = minAge;
+    ParticleRule::maxAge = maxAge;
+    ParticleRule::minVelocity = minVelocity;
+    ParticleRule::maxVelocity = maxVelocity;
+    ParticleRule::damping = damping;
+}
+
+void ParticleRule::addPayload(unsigned type, unsigned count)
+{
+    Payload payload;
+    payload.type = type;
+    payload.count = count;
+    payloads.push_back(payload);
+}
+
+ParticleEmitter::ParticleEmitter()
+:
+type(0),
+rate(0),
+pending(0)
+{
+}
+
+/**
+ * Takes the given duration off the age of each particle.
+ */
+static void ageParticles(real * CYCLONE_RESTRICT ages, unsigned count,
+                         real duration)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        ages[i] -= duration;
+    }
+}
+
+ParticleSystem::ParticleSystem(unsigned capacity)
+:
+capacity(capacity),
+killHeight(-REAL_MAX)
+{
+    // Make room for the whole pool now, so particles can come and go
+    // without allocating.
+    particles.reserve(capacity);
+    ages.reserve(capacity);
+    types.reserve(capacity);
+    dead.reserve(capacity);
+    bursts.reserve(capacity);
+}
+
+unsigned ParticleSystem::getCapacity() const
+{
+    return capacity;
+}
+
+void ParticleSystem::setRule(unsigned type, const ParticleRule &rule)
+{
+    if (type >= rules.size()) rules.resize(type + 1);
+    rules[type] = rule;
+}
+
+ParticleRule& ParticleSystem::getRule(unsigned type)
+{
+    if (type >= rules.size()) rules.resize(type + 1);
+    return rules[type];
+}
+
+const ParticleRule& ParticleSystem::findRule(unsigned type) const
+{
+    if (type < rules.size()) return rules[type];
+    return defaultRule;
+}
+
+unsigned ParticleSystem::addEmitter(const ParticleEmitter &emitter)
+{
+    emitters.push_back(emitter);
+    return (unsigned)emitters.size() - 1;
+}
+
+ParticleEmitter& ParticleSystem::getEmitter(unsigned index)
+{
+    return emitters[index];
+}
+
+unsigned ParticleSystem::getEmitterCount() const
+{
+    return (unsigned)emitters.size();
+}
+
+void ParticleSystem::clearEmitters()
+{
+    emitters.clear();
+}
+
+void ParticleSystem::setKillHeight(real height)
+{
+    killHeight = height;
+}
+
+void ParticleSystem::setSeed(unsigned seed)
+{
+    random.seed(seed);
+}
+
+unsigned ParticleSystem::spawn(unsigned type, unsigned count,
+                               const Vector3 &position,
+                               const Vector3 &velocity)
+{
+    const ParticleRule &rule = findRule(type);
+
+    unsigned room = capacity - particles.size();
+    if (count > room) count = room;
+
+    if (count == 0) return 0;
+
+    // Add them all at once, then fill in how they start.
+    unsigned first = particles.addBlock(count, rule.mass, rule.damping);
+    unsigned end = first + count;
+    ages.resize(end);
+    types.resize(end, type);
+
+    real *x = particles.getArray(ParticleSet::POSITION_X);
+    real *y = particles.getArray(ParticleSet::POSITION_Y);
+    real *z = particles.getArray(ParticleSet::POSITION_Z);
+    real *vx = particles.getArray(ParticleSet::VELOCITY_X);
+    real *vy = particles.getArray(ParticleSet::VELOCITY_Y);
+    real *vz = particles.getArray(ParticleSet::VELOCITY_Z);
+    real *ax = particles.getArray(ParticleSet::ACCELERATION_X);
+    real *ay = particles.getArray(ParticleSet::ACCELERATION_Y);
+    real *az = particles.getArray(ParticleSet::ACCELERATION_Z);
+    for (unsigned i = first; i < end; i++)
+    {
+        Vector3 start = velocity +
+            random.randomVector(rule.minVelocity, rule.maxVelocity);
+        x[i] = position.x; y[i] = position.y; z[i] = position.z;
+        vx[i] = start.x; vy[i] = start.y; vz[i] = start.z;
+        ax[i] = rule.acceleration.x;
+        ay[i] = rule.acceleration.y;
+        az[i] = rule.acceleration.z;
+        ages[i] = random.randomReal(rule.minAge, rule.maxAge);
+    }
+    return count;
+}
+
+void ParticleSystem::update(real duration)
+{
+    // Let the emitters create their particles.
+    for (unsigned e = 0; e < emitters.size(); e++)
+    {
+        ParticleEmitter &emitter = emitters[e];
+        emitter.pending += emitter.rate * duration;
+        unsigned count = (unsigned)emitter.pending;
+        emitter.pending -= (real)count;
+        spawn(emitter.type, count, emitter.position, emitter.velocity);
+    }
+
+    // Move everything on.
+    particles.integrateAll(duration);
+
+    unsigned count = particles.size();
+    ageParticles(ages.data(), count, duration);
+
+    // Find the particles that have died.
+    const real *heights = particles.getArray(ParticleSet::POSITION_Y);
+    dead.clear();
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (ages[i] < 0 || heights[i] < killHeight) dead.push_back(i);
+    }
+
+    // Note where the ones with payloads were, as removing them will
+    // move other particles into their places.
+    bursts.clear();
+    const real *x = particles.getArray(ParticleSet::POSITION_X);
+    const real *y = particles.getArray(ParticleSet::POSITION_Y);
+    const real *z = particles.getArray(ParticleSet::POSITION_Z);
+    const real *vx = particles.getArray(ParticleSet::VELOCITY_X);
+    const real *vy = particles.getArray(ParticleSet::VELOCITY_Y);
+    const real *vz = particles.getArray(ParticleSet::VELOCITY_Z);
+    for (unsigned d = 0; d < dead.size(); d++)
+    {
+        unsigned index = dead[d];
+        if (findRule(types[index]).payloads.empty()) continue;
+
+        Burst burst;
+        burst.type = types[index];
+        burst.position = Vector3(x[index], y[index], z[index]);
+        burst.velocity = Vector3(vx[index], vy[index], vz[index]);
+        bursts.push_back(burst);
+    }
+
+    // Remove the dead, filling the gaps from the end.
+    if (!dead.empty())
+    {
+        unsigned deadCount = (unsigned)dead.size();
+        particles.removeSorted(&dead[0], deadCount);
+        ages.removeSorted(&dead[0], deadCount);
+        types.removeSorted(&dead[0], deadCount);
+    }
+
+    // Then create their payloads, so they can use the room the dead
+    // have made.
+    for (unsigned b = 0; b < bursts.size(); b++)
+    {
+        const Burst &burst = bursts[b];
+        const ParticleRule &rule = findRule(burst.type);
+        for (unsigned p = 0; p < rule.payloads.size(); p++)
+        {
+            const ParticleRule::Payload &payload = rule.payloads[p];
+            spawn(payload.type, payload.count,
+                  burst.position, burst.velocity);
+        }
+    }
+}
+
+void ParticleSystem::clear()
+{
+    particles.clear();
+    ages.clear();
+    types.clear();
+}
+
+unsigned ParticleSystem::size() const
+{
+    return particles.size();
+}
+
+ParticleSet& ParticleSystem::getParticles()
+{
+    return particles;
+}
+
+const ParticleSet& ParticleSystem::getParticles() const
+{
+    return particles;
+}
+
+unsigned ParticleSystem::getType(unsigned index) const
+{
+    return types[index];
+}
+
+real ParticleSystem::getAge(unsigned index) const
+{
+    return ages[index];
+}
@@ -11,6 +11,7 @@
  */
 
 #include <cstdlib>
+#include <algorithm>
 #include <cyclone/pworld.h>
 
 using namespace cyclone;
@@ -18,20 +19,172 @@ using namespace cyclone;
 ParticleWorld::ParticleWorld(unsigned maxContacts, unsigned iterations)
 :
 resolver(iterations),
-maxContacts(maxContacts)
+maxContacts(maxContacts),
+gridEnabled(false),
+integrationMode(EULER),
+positionIterations(4),
+jobs(NULL)
 {
     contacts = new ParticleContact[maxContacts];
     calculateIterations = (iterations == 0);
 
+    // Worlds are usually made of chains of particles, where each
+    // contact shares particles with only a few others.
+    resolver.setMode(ParticleContactResolver::INDEXED);
 }
 
 ParticleWorld::~ParticleWorld()
 {
+    setJobSystem(NULL);
     delete[] contacts;
 }
 
+void ParticleWorld::setJobSystem(JobSystem *jobs)
+{
+    for (unsigned i = 0; i < threadContacts.size(); i++)
+    {
+        delete threadContacts[i];
+    }
+    threadContacts.clear();
+
+    ParticleWorld::jobs = jobs;
+    resolver.setJobSystem(jobs);
+    if (jobs)
+    {
+        for (unsigned i = 0; i < jobs->getThreadCount(); i++)
+        {
+            threadContacts.push_back(new ThreadContacts());
+        }
+    }
+}
+
+/**
+ * The number of particles in each batch handed to a thread. Clearing
+ * and integrating a particle is quick, so batches need to be large
+ * to be worth handing out.
+ */
+static const unsigned particleBatchSize = 256;
+
+/**
+ * Clears the accumulators of a range of particles, for starting the
+ * frame in parallel.
+ */
+class ParticleStartFrameTask : public ParallelTask
+{
+public:
+    Particle * const *particles;
+
+    virtual void run(unsigned begin, unsigned end, unsigned thread)
+    {
+        for (unsigned i = begin; i < end; i++)
+        {
+            particles[i]->clearAccumulator();
+        }
+    }
+};
+
+/**
+ * Integrates a range of particles, for integrating in parallel. If
+ * there is somewhere to keep their previous positions, the particles
+ * are predicted for position-based integration instead.
+ */
+class ParticleIntegrateTask : public ParallelTask
+{
+public:
+    Particle * const *particles;
+    const DampingTable *table;
+    const unsigned *hints;
+    real duration;
+    Vector3 *previousPositions;
+
+    virtual void run(unsigned begin, unsigned end, unsigned thread)
+    {
+        for (unsigned i = begin; i < end; i++)
+        {
+            real factor = table->getFactor(hints[i]);
+            if (previousPositions)
+            {
+                previousPositions[i] = particles[i]->getPosition();
+                particles[i]->predict(duration, factor);
+            }
+            else
+            {
+                particles[i]->integrate(duration, factor);
+            }
+        }
+    }
+};
+
+/**
+ * Works out the velocity of a range of particles from how far they
+ * moved, to finish a position-based step.
+ */
+class ParticleVelocityTask : public ParallelTask
+{
+public:
+    Particle * const *particles;
+    const Vector3 *previousPositions;
+    real inverseDuration;
+
+    virtual void run(unsigned begin, unsigned end, unsigned thread)
+    {
+        for (unsigned i = begin; i < end; i++)
+        {
+            Particle *particle = particles[i];
+            if (particle->getInverseMass() <= 0) continue;
+            particle->setVelocity(
+                (particle->getPosition() - previousPositions[i]) *
+                inverseDuration);
+        }
+    }
+};
+
+/**
+ * Runs a range of contact generators, each into the contacts of the
+ * thread it runs on. Every generator is given room for the world's
+ * whole limit, so its contacts are the same as if it had run alone.
+ */
+class ParticleWorld::GenerateTask : public ParallelTask
+{
+public:
+    ParticleContactGenerator * const *generators;
+    ThreadContacts * const *buffers;
+    unsigned maxContacts;
+    unsigned *threads;
+    unsigned *starts;
+    unsigned *counts;
+
+    virtual void run(unsigned begin, unsigned end, unsigned thread)
+    {
+        ThreadContacts &buffer = *buffers[thread];
+        for (unsigned i = begin; i < end; i++)
+        {
+            if (buffer.contacts.size() < buffer.used + maxContacts)
+            {
+                buffer.contacts.resize(buffer.used + maxContacts);
+            }
+
+            unsigned used = generators[i]->addContact(
+                &buffer.contacts[buffer.used], maxContacts);
+            threads[i] = thread;
+            starts[i] = buffer.used;
+            counts[i] = used;
+            buffer.used += used;
+        }
+    }
+};
+
 void ParticleWorld::startFrame()
 {
+    if (jobs)
+    {
+        ParticleStartFrameTask task;
+        task.particles = particles.empty() ? NULL : &particles[0];
+        jobs->parallelFor(task, (unsigned)particles.size(),
+                          particleBatchSize);
+        return;
+    }
+
     for (Particles::iterator p = particles.begin();
         p != particles.end();
         p++)
@@ -43,6 +196,8 @@ void ParticleWorld::startFrame()
 
 unsigned ParticleWorld::generateContacts()
 {
+    if (jobs) return generateContactsParallel();
+
     unsigned limit = maxContacts;
     ParticleContact *nextContact = contacts;
 
@@ -63,21 +218,161 @@ unsigned ParticleWorld::generateContacts()
     return maxContacts - limit;
 }
 
+unsigned ParticleWorld::generateContactsParallel()
+{
+    unsigned count = (unsigned)contactGenerators.size();
+    if (count == 0 || maxContacts == 0) return 0;
+
+    for (unsigned i = 0; i < threadContacts.size(); i++)
+    {
+        threadContacts[i]->used = 0;
+    }
+    generatorThreads.resize(count);
+    generatorStarts.resize(count);
+    generatorCounts.resize(count);
+
+    // Generators can take very different amounts of time, so hand
+    // them out one at a time.
+    GenerateTask task;
+    task.generators = &contactGenerators[0];
+    task.buffers = &threadContacts[0];
+    task.maxContacts = maxContacts;
+    task.threads = &generatorThreads[0];
+    task.starts = &generatorStarts[0];
+    task.counts = &generatorCounts[0];
+    jobs->parallelFor(task, count, 1);
+
+    // Gather the contacts in generator order, so the result doesn't
+    // depend on which thread ran which generator. Cutting off at the
+    // limit leaves the same contacts as running them one by one.
+    unsigned used = 0;
+    for (unsigned i = 0; i < count && used < maxContacts; i++)
+    {
+        unsigned taken = generatorCounts[i];
+        if (taken > maxContacts - used) taken = maxContacts - used;
+
+        const ParticleContact *first =
+            &threadContacts[generatorThreads[i]]->contacts[generatorStarts[i]];
+        std::copy(first, first + taken, contacts + used);
+        used += taken;
+    }
+    return used;
+}
+
+void ParticleWorld::prepareDamping(real duration)
+{
+    // Work out the drag factors once for all the particles. The
+    // table can grow as hints are updated, so this is always done
+    // before the particles are shared out between threads.
+    dampingTable.setDuration(duration);
+    dampingHints.resize(particles.size(), ~0u);
+    for (unsigned i = 0; i < particles.size(); i++)
+    {
+        dampingTable.updateHint(particles[i]->getDamping(),
+                                &dampingHints[i]);
+    }
+}
+
 void ParticleWorld::integrate(real duration)
 {
-    for (Particles::iterator p = particles.begin();
-        p != particles.end();
-        p++)
+    prepareDamping(duration);
+
+    ParticleIntegrateTask task;
+    task.particles = particles.empty() ? NULL : &particles[0];
+    task.table = &dampingTable;
+    task.hints = dampingHints.empty() ? NULL : &dampingHints[0];
+    task.duration = duration;
+    task.previousPositions = NULL;
+    if (jobs)
     {
-        // Remove all forces from the accumulator
-        (*p)->integrate(duration);
+        jobs->parallelFor(task, (unsigned)particles.size(),
+                          particleBatchSize);
+    }
+    else
+    {
+        task.run(0, (unsigned)particles.size(), 0);
+    }
+}
+
+void ParticleWorld::predict(real duration)
+{
+    prepareDamping(duration);
+    previousPositions.resize(particles.size());
+
+    ParticleIntegrateTask task;
+    task.particles = particles.empty() ? NULL : &particles[0];
+    task.table = &dampingTable;
+    task.hints = dampingHints.empty() ? NULL : &dampingHints[0];
+    task.duration = duration;
+    task.previousPositions =
+        previousPositions.empty() ? NULL : &previousPositions[0];
+    if (jobs)
+    {
+        jobs->parallelFor(task, (unsigned)particles.size(),
+                          particleBatchSize);
+    }
+    else
+    {
+        task.run(0, (unsigned)particles.size(), 0);
     }
 }
 
+void ParticleWorld::updateVelocities(real duration)
+{
+    ParticleVelocityTask task;
+    task.particles = particles.empty() ? NULL : &particles[0];
+    task.previousPositions =
+        previousPositions.empty() ? NULL : &previousPositions[0];
+    task.inverseDuration = ((real)1.0) / duration;
+    if (jobs)
+    {
+        jobs->parallelFor(task, (unsigned)particles.size(),
+                          particleBatchSize);
+    }
+    else
+    {
+        task.run(0, (unsigned)particles.size(), 0);
+    }
+}
+
+void ParticleWorld::runPositionBased(real duration)
+{
+    // Move the particles as if they were free.
+    predict(duration);
+
+    // Then pull them back into line. Each pass finds the contacts
+    // again from where the particles are now, so links that are
+    // out of line in a new direction are seen.
+    for (unsigned i = 0; i < positionIterations; i++)
+    {
+        unsigned usedContacts = generateContacts();
+        if (usedContacts == 0) break;
+        resolver.projectPositions(contacts, usedContacts);
+    }
+
+    // The particles' velocities are whatever got them there.
+    updateVelocities(duration);
+}
+
 void ParticleWorld::runPhysics(real duration)
 {
+    // Sort the particles into the grid, so the force generators
+    // can find their neighbours.
+    if (gridEnabled)
+    {
+        grid.build(particles.empty() ? NULL : &particles[0],
+                   (unsigned)particles.size());
+    }
+
     // First apply the force generators
     registry.updateForces(duration);
+    batchedRegistry.updateForces(duration, jobs);
+
+    if (integrationMode == POSITION_BASED)
+    {
+        runPositionBased(duration);
+        return;
+    }
 
     // Then integrate the objects
     integrate(duration);
@@ -108,6 +403,52 @@ ParticleForceRegistry& ParticleWorld::getForceRegistry()
     return registry;
 }
 
+BatchedParticleForceRegistry& ParticleWorld::getBatchedForceRegistry()
+{
+    return batchedRegistry;
+}
+
+ParticleContactResolver& ParticleWorld::getContactResolver()
+{
+    return resolver;
+}
+
+void ParticleWorld::setIntegrationMode(IntegrationMode mode)
+{
+    integrationMode = mode;
+}
+
+ParticleWorld::IntegrationMode ParticleWorld::getIntegrationMode() const
+{
+    return integrationMode;
+}
+
+void ParticleWorld::setPositionIterations(unsigned iterations)
+{
+    positionIterations = iterations;
+}
+
+unsigned ParticleWorld::getPositionIterations() const
+{
+    return positionIterations;
+}
+
+void ParticleWorld::enableNeighbourGrid(real cellSize)
+{
+    grid.setCellSize(cellSize);
+    gridEnabled = true;
+}
+
+void ParticleWorld::disableNeighbourGrid()
+{
+    gridEnabled = false;
+}
+
+const ParticleGrid& ParticleWorld::getNeighbourGrid() const
+{
+    return grid;
+}
+
 void GroundContacts::init(cyclone::ParticleWorld::Particles *particles)
 {
     GroundContacts::particles = particles;
@@ -0,0 +1,340 @@
+/*
+ * Implementation file for the water surface and the generators that
+ * float objects on it.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <cyclone/water.h>
+
+using namespace cyclone;
+
+/**
+ * The acceleration due to gravity that sets the speed of the waves,
+ * using the dispersion relation for deep water.
+ */
+static const real waveGravity = (real)9.81;
+
+/**
+ * The number of times the sideways movement of the water is
+ * refined when finding the height above a point.
+ */
+static const unsigned heightIterations = 4;
+
+WaterSurface::WaterSurface(real baseHeight)
+:
+baseHeight(baseHeight),
+time(0),
+tileSize(0),
+tileResolution(0)
+{
+}
+
+void WaterSurface::addWave(real directionX, real directionZ, real amplitude,
+                           real wavelength, real steepness)
+{
+    real length = real_sqrt(directionX*directionX + directionZ*directionZ);
+    if (length <= 0 || wavelength <= 0) return;
+
+    Wave wave;
+    wave.directionX = directionX / length;
+    wave.directionZ = directionZ / length;
+    wave.amplitude = amplitude;
+    wave.waveNumber = ((real)2.0) * R_PI / wavelength;
+    wave.frequency = real_sqrt(waveGravity * wave.waveNumber);
+    wave.steepness = steepness;
+    wave.sideways = steepness / wave.waveNumber;
+    waves.push_back(wave);
+
+    fitWavesToTile();
+    fillTile();
+}
+
+void WaterSurface::clearWaves()
+{
+    waves.clear();
+    fitWavesToTile();
+    fillTile();
+}
+
+void WaterSurface::setTile(real size, unsigned resolution)
+{
+    if (size <= 0) resolution = 0;
+    tileSize = size;
+    tileResolution = resolution;
+    tile.resize(resolution * resolution);
+
+    fitWavesToTile();
+    fillTile();
+}
+
+void WaterSurface::fitWavesToTile()
+{
+    tiledWaves = waves;
+    if (tileResolution == 0) return;
+
+    // Round each wave to the nearest one that fits a whole number
+    // of times across the tile in both directions.
+    real cycles = tileSize / (((real)2.0) * R_PI);
+    for (unsigned i = 0; i < tiledWaves.size(); i++)
+    {
+        Wave &wave = tiledWaves[i];
+        real x = real_floor(wave.waveNumber * wave.directionX * cycles +
+                            (real)0.5);
+        real z = real_floor(wave.waveNumber * wave.directionZ * cycles +
+                            (real)0.5);
+
+        // Waves longer than the tile are stretched to fit it once.
+        if (x == 0 && z == 0)
+        {
+            if (real_abs(wave.directionX) >= real_abs(wave.directionZ))
+            {
+                x = wave.directionX < 0 ? (real)-1 : (real)1;
+            }
+            else
+            {
+                z = wave.directionZ < 0 ? (real)-1 : (real)1;
+            }
+        }
+
+        real length = real_sqrt(x*x + z*z);
+        wave.directionX = x / length;
+        wave.directionZ = z / length;
+        wave.waveNumber = length / cycles;
+        wave.frequency = real_sqrt(waveGravity * wave.waveNumber);
+        wave.sideways = wave.steepness / wave.waveNumber;
+    }
+}
+
+void WaterSurface::fillTile()
+{
+    if (tileResolution == 0) return;
+
+    real spacing = tileSize / tileResolution;
+    for (unsigned j = 0; j < tileResolution; j++)
+    {
+        for (unsigned i = 0; i < tileResolution; i++)
+        {
+            tile[j*tileResolution + i] =
+                calculateHeight(i * spacing, j * spacing);
+        }
+    }
+}
+
+void WaterSurface::update(real duration)
+{
+    time += duration;
+    fillTile();
+}
+
+real WaterSurface::getTime() const
+{
+    return time;
+}
+
+real WaterSurface::calculateHeight(real x, real z) const
+{
+    unsigned count = (unsigned)tiledWaves.size();
+    const Wave *wave = count ? &tiledWaves[0] : 0;
+
+    // The waves move the water sideways, so first find where the
+    // water now above the point started out.
+    real startX = x, startZ = z;
+    for (unsigned n = 0; n < heightIterations; n++)
+    {
+        real offsetX = 0, offsetZ = 0;
+        for (unsigned i = 0; i < count; i++)
+        {
+            real phase = wave[i].waveNumber *
+                (wave[i].directionX*startX + wave[i].directionZ*startZ) -
+                wave[i].frequency * time;
+            real sideways = wave[i].sideways * real_cos(phase);
+            offsetX += wave[i].directionX * sideways;
+            offsetZ += wave[i].directionZ * sideways;
+        }
+        startX = x - offsetX;
+        startZ = z - offsetZ;
+    }
+
+    // Then find its height.
+    real height = baseHeight;
+    for (unsigned i = 0; i < count; i++)
+    {
+        real phase = wave[i].waveNumber *
+            (wave[i].directionX*startX + wave[i].directionZ*startZ) -
+            wave[i].frequency * time;
+        height += wave[i].amplitude * real_sin(phase);
+    }
+    return height;
+}
+
+real WaterSurface::getHeight(real x, real z) const
+{
+    real height;
+    Vector3 point(x, 0, z);
+    getHeights(&point, 1, &height);
+    return height;
+}
+
+void WaterSurface::getHeights(const Vector3 *points, unsigned count,
+                              real *heights) const
+{
+    if (tileResolution == 0)
+    {
+        for (unsigned i = 0; i < count; i++)
+        {
+            heights[i] = calculateHeight(points[i].x, points[i].z);
+        }
+        return;
+    }
+
+    // Interpolate between the four nearest cached heights, wrapping
+    // around the tile.
+    real size = (real)tileResolution;
+    real scale = size / tileSize;
+    const real *cache = &tile[0];
+    for (unsigned i = 0; i < count; i++)
+    {
+        real u = points[i].x * scale;
+        real v = points[i].z * scale;
+        u -= real_floor(u / size) * size;
+        v -= real_floor(v / size) * size;
+
+        real cellU = real_floor(u), cellV = real_floor(v);
+        real fracU = u - cellU, fracV = v - cellV;
+        unsigned u0 = (unsigned)cellU, v0 = (unsigned)cellV;
+        if (u0 >= tileResolution) u0 = 0;
+        if (v0 >= tileResolution) v0 = 0;
+        unsigned u1 = u0 + 1 < tileResolution ? u0 + 1 : 0;
+        unsigned v1 = v0 + 1 < tileResolution ? v0 + 1 : 0;
+
+        real front = cache[v0*tileResolution + u0] * (1 - fracU) +
+            cache[v0*tileResolution + u1] * fracU;
+        real back = cache[v1*tileResolution + u0] * (1 - fracU) +
+            cache[v1*tileResolution + u1] * fracU;
+        heights[i] = front * (1 - fracV) + back * fracV;
+    }
+}
+
+/**
+ * Returns the proportion of an object's buoyancy it gets when it is
+ * the given depth below the surface. Objects are fully out of the
+ * water at maxDepth above the surface, and fully submerged at
+ * maxDepth below it.
+ */
+static real submersion(real depth, real maxDepth)
+{
+    if (depth <= -maxDepth) return 0;
+    if (depth >= maxDepth) return 1;
+    return (depth + maxDepth) / (2 * maxDepth);
+}
+
+WaterBuoyancy::WaterBuoyancy(const WaterSurface *water, real maxDepth,
+                             real volume, real liquidDensity)
+:
+water(water),
+maxDepth(maxDepth),
+volume(volume),
+liquidDensity(liquidDensity)
+{
+}
+
+void WaterBuoyancy::addSample(const Vector3 &point)
+{
+    samples.push_back(point);
+}
+
+void WaterBuoyancy::applyForces(RigidBody *body, const Vector3 *bodyPoints,
+                                const real *bodyHeights) const
+{
+    real sampleForce = liquidDensity * volume / samples.size();
+    for (unsigned s = 0; s < samples.size(); s++)
+    {
+        real amount = submersion(bodyHeights[s] - bodyPoints[s].y, maxDepth);
+        if (amount <= 0) continue;
+        body->addForceAtPoint(Vector3(0, sampleForce * amount, 0),
+                              bodyPoints[s]);
+    }
+}
+
+void WaterBuoyancy::updateForce(RigidBody *body, real duration)
+{
+    updateForces(&body, 1, duration);
+}
+
+void WaterBuoyancy::updateForces(RigidBody * const *bodies, unsigned count,
+                                 real duration)
+{
+    unsigned sampleCount = (unsigned)samples.size();
+    if (sampleCount == 0 || count == 0) return;
+
+    // Find all the sample points, then look them up in one go.
+    points.resize(count * sampleCount);
+    heights.resize(count * sampleCount);
+    for (unsigned b = 0; b < count; b++)
+    {
+        for (unsigned s = 0; s < sampleCount; s++)
+        {
+            points[b*sampleCount + s] =
+                bodies[b]->getPointInWorldSpace(samples[s]);
+        }
+    }
+    water->getHeights(&points[0], count * sampleCount, &heights[0]);
+
+    for (unsigned b = 0; b < count; b++)
+    {
+        if (!bodies[b]->isDynamic()) continue;
+        applyForces(bodies[b], &points[b*sampleCount],
+                    &heights[b*sampleCount]);
+    }
+}
+
+ParticleWaterBuoyancy::ParticleWaterBuoyancy(const WaterSurface *water,
+                                             real maxDepth, real volume,
+                                             real liquidDensity)
+:
+water(water),
+maxDepth(maxDepth),
+volume(volume),
+liquidDensity(liquidDensity)
+{
+}
+
+void ParticleWaterBuoyancy::applyForce(Particle *particle, real depth) const
+{
+    real amount = submersion(depth, maxDepth);
+    if (amount <= 0) return;
+    particle->addForce(Vector3(0, liquidDensity * volume * amount, 0));
+}
+
+void ParticleWaterBuoyancy::updateForce(Particle *particle, real duration)
+{
+    Vector3 position = particle->getPosition();
+    applyForce(particle, water->getHeight(position.x, position.z) -
+               position.y);
+}
+
+void ParticleWaterBuoyancy::updateForces(Particle * const *particles,
+                                         unsigned count, real duration)
+{
+    if (count == 0) return;
+
+    points.resize(count);
+    heights.resize(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        points[i] = particles[i]->getPosition();
+    }
+    water->getHeights(&points[0], count, &heights[0]);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        applyForce(particles[i], heights[i] - points[i].y);
+    }
+}
@@ -11,83 +11,986 @@
  */
 
 #include <cstdlib>
+#include <algorithm>
 #include <cyclone/world.h>
 
 using namespace cyclone;
 
 World::World(unsigned maxContacts, unsigned iterations)
 :
-firstBody(NULL),
 resolver(iterations),
-firstContactGen(NULL),
-maxContacts(maxContacts)
+contacts(maxContacts),
+continuousThreshold((real)0.5),
+jobs(NULL),
+fixedStep(0),
+maxSubsteps(4),
+accumulator(0),
+islandSleeping(false),
+nextSleepingIsland(0)
 {
-    contacts = new Contact[maxContacts];
     calculateIterations = (iterations == 0);
 }
 
 World::~World()
 {
-    delete[] contacts;
+    setJobSystem(NULL);
 }
 
+void World::setJobSystem(JobSystem *jobs)
+{
+    for (unsigned i = 0; i < threadContacts.size(); i++)
+    {
+        delete threadContacts[i];
+    }
+    threadContacts.clear();
+
+    World::jobs = jobs;
+    if (jobs)
+    {
+        for (unsigned i = 0; i < jobs->getThreadCount(); i++)
+        {
+            threadContacts.push_back(new ContactBuffer());
+        }
+    }
+}
+
+BodyHandle World::addBody(RigidBody *body)
+{
+    body->storePreviousTransform();
+    if (body->getType() != RigidBody::STATIC) return bodies.add(body);
+
+    // Static bodies never change, so their derived data only needs
+    // calculating once.
+    body->calculateDerivedData();
+    BodyHandle handle = staticBodies.add(body);
+    handle.slot |= STATIC_HANDLE;
+    return handle;
+}
+
+bool World::removeBody(BodyHandle handle)
+{
+    if (handle.slot != ~0u && (handle.slot & STATIC_HANDLE))
+    {
+        handle.slot &= ~STATIC_HANDLE;
+        return staticBodies.remove(handle);
+    }
+
+    // Take the body off the sleeping list, if it's there.
+    RigidBody *body = bodies.get(handle);
+    if (body && !sleepingBodies.empty())
+    {
+        SleepingBody key = {body, 0};
+        std::vector<SleepingBody>::iterator found = std::lower_bound(
+            sleepingBodies.begin(), sleepingBodies.end(), key);
+        if (found != sleepingBodies.end() && found->body == body)
+        {
+            sleepingBodies.erase(found);
+        }
+    }
+    return bodies.remove(handle);
+}
+
+RigidBody* World::getBody(BodyHandle handle) const
+{
+    if (handle.slot != ~0u && (handle.slot & STATIC_HANDLE))
+    {
+        handle.slot &= ~STATIC_HANDLE;
+        return staticBodies.get(handle);
+    }
+    return bodies.get(handle);
+}
+
+unsigned World::getBodyCount() const
+{
+    return bodies.size();
+}
+
+RigidBody* const* World::getBodies() const
+{
+    return bodies.data();
+}
+
+unsigned World::getStaticBodyCount() const
+{
+    return staticBodies.size();
+}
+
+RigidBody* const* World::getStaticBodies() const
+{
+    return staticBodies.data();
+}
+
+BatchedForceRegistry& World::getForceRegistry()
+{
+    return registry;
+}
+
+ContactGenHandle World::addContactGenerator(ContactGenerator *generator)
+{
+    return contactGenerators.add(generator);
+}
+
+bool World::removeContactGenerator(ContactGenHandle handle)
+{
+    return contactGenerators.remove(handle);
+}
+
+/**
+ * Clears the accumulators of a range of bodies, for starting the
+ * frame in parallel.
+ */
+class StartFrameTask : public ParallelTask
+{
+public:
+    RigidBody * const *bodies;
+
+    virtual void run(unsigned begin, unsigned end, unsigned thread)
+    {
+        for (unsigned i = begin; i < end; i++)
+        {
+            bodies[i]->clearAccumulators();
+            bodies[i]->calculateDerivedData();
+        }
+    }
+};
+
+/**
+ * Integrates a range of bodies, for integrating in parallel.
+ */
+class IntegrateTask : public ParallelTask
+{
+public:
+    RigidBody * const *bodies;
+    const DampingTable *table;
+    const unsigned *hints;
+    real duration;
+    bool sleepAlone;
+
+    virtual void run(unsigned begin, unsigned end, unsigned thread)
+    {
+        for (unsigned i = begin; i < end; i++)
+        {
+            bodies[i]->integrate(duration,
+                table->getFactor(hints[i*2]),
+                table->getFactor(hints[i*2+1]),
+                table->getSleepBias(),
+                sleepAlone);
+        }
+    }
+};
+
+/**
+ * Runs the given generator into the given buffer, giving it more
+ * room until it has space to spare, and commits its contacts.
+ * Returns the number of contacts and sets the first one.
+ */
+static unsigned runGenerator(const ContactGenerator *gen,
+                             ContactBuffer *buffer, Contact **first)
+{
+    unsigned minimum = 1;
+    for (;;)
+    {
+        unsigned limit;
+        Contact *nextContact = buffer->getSpace(minimum, &limit);
+        unsigned used = gen->addContact(nextContact, limit);
+
+        // If there was space left over, we have every contact.
+        if (used < limit)
+        {
+            buffer->commit(used);
+            *first = nextContact;
+            return used;
+        }
+
+        // Otherwise the generator may have been cut short. Run it
+        // again into a fresh chunk with twice the room, the
+        // partial results are simply never committed.
+        minimum = limit * 2;
+    }
+}
+
+/**
+ * Runs a range of contact generators, each into the buffer of the
+ * thread it runs on.
+ */
+class GenerateTask : public ParallelTask
+{
+public:
+    ContactGenerator * const *generators;
+    ContactBuffer * const *buffers;
+    Contact **firsts;
+    unsigned *counts;
+
+    virtual void run(unsigned begin, unsigned end, unsigned thread)
+    {
+        for (unsigned i = begin; i < end; i++)
+        {
+            counts[i] = runGenerator(generators[i], buffers[thread],
+                                     &firsts[i]);
+        }
+    }
+};
+
+/**
+ * Resolves a range of contact islands, each with its own copy of
+ * the world's resolver.
+ */
+class ResolveTask : public ParallelTask
+{
+public:
+    const ContactResolver *resolver;
+    bool calculateIterations;
+    Contact *contacts;
+    const unsigned *islandStarts;
+    real duration;
+
+    virtual void run(unsigned begin, unsigned end, unsigned thread)
+    {
+        for (unsigned i = begin; i < end; i++)
+        {
+            unsigned first = islandStarts[i];
+            unsigned count = islandStarts[i+1] - first;
+
+            ContactResolver local(*resolver);
+            if (calculateIterations) local.setIterations(count * 4);
+            local.resolveContacts(contacts + first, count, duration);
+        }
+    }
+};
+
 void World::startFrame()
 {
-    BodyRegistration *reg = firstBody;
-    while (reg)
+    if (jobs)
     {
-        // Remove all forces from the accumulator
-        reg->body->clearAccumulators();
-        reg->body->calculateDerivedData();
+        StartFrameTask task;
+        task.bodies = bodies.data();
+        jobs->parallelFor(task, bodies.size());
+        return;
+    }
 
-        // Get the next registration
-        reg = reg->next;
+    for (unsigned i = 0; i < bodies.size(); i++)
+    {
+        // Remove all forces from the accumulator
+        bodies[i]->clearAccumulators();
+        bodies[i]->calculateDerivedData();
     }
 }
 
 unsigned World::generateContacts()
 {
-    unsigned limit = maxContacts;
-    Contact *nextContact = contacts;
-
-    ContactGenRegistration * reg = firstContactGen;
-    while (reg)
+    contacts.reset();
+    if (!islandSleeping)
     {
-        unsigned used = reg->gen->addContact(nextContact, limit);
-        limit -= used;
-        nextContact += used;
+        runGenerators(contactGenerators.data(), contactGenerators.size());
+        return contacts.getContactCount();
+    }
 
-        // We've run out of contacts to fill. This means we're missing
-        // contacts.
-        if (limit <= 0) break;
+    // Only call the generators that might involve an awake body. If
+    // their contacts wake any islands, the generators for those get
+    // a turn too.
+    waitingGenerators.assign(contactGenerators.data(),
+        contactGenerators.data() + contactGenerators.size());
+    for (;;)
+    {
+        activeGenerators.clear();
+        unsigned waiting = 0;
+        for (unsigned i = 0; i < waitingGenerators.size(); i++)
+        {
+            ContactGenerator *gen = waitingGenerators[i];
+            if (isGeneratorAwake(gen)) activeGenerators.push_back(gen);
+            else waitingGenerators[waiting++] = gen;
+        }
+        waitingGenerators.resize(waiting);
+        if (activeGenerators.empty()) break;
 
-        reg = reg->next;
+        unsigned before = contacts.getContactCount();
+        runGenerators(&activeGenerators[0],
+                      (unsigned)activeGenerators.size());
+        unsigned added = contacts.getContactCount() - before;
+        if (added == 0) break;
+        if (!wakeTouchedIslands(contacts.gather() + before, added)) break;
     }
 
     // Return the number of contacts used.
-    return maxContacts - limit;
+    return contacts.getContactCount();
+}
+
+void World::runGenerators(ContactGenerator * const *generators,
+                          unsigned count)
+{
+    if (jobs)
+    {
+        generateContactsParallel(generators, count);
+        return;
+    }
+
+    Contact *first;
+    for (unsigned i = 0; i < count; i++)
+    {
+        runGenerator(generators[i], &contacts, &first);
+    }
+}
+
+void World::generateContactsParallel(ContactGenerator * const *generators,
+                                     unsigned count)
+{
+    if (count == 0) return;
+
+    for (unsigned i = 0; i < threadContacts.size(); i++)
+    {
+        threadContacts[i]->reset();
+    }
+    generatorContacts.resize(count);
+    generatorCounts.resize(count);
+
+    // Generators can take very different amounts of time, so hand
+    // them out one at a time.
+    GenerateTask task;
+    task.generators = generators;
+    task.buffers = &threadContacts[0];
+    task.firsts = &generatorContacts[0];
+    task.counts = &generatorCounts[0];
+    jobs->parallelFor(task, count, 1);
+
+    // Gather the contacts in generator order, so the result doesn't
+    // depend on which thread ran which generator.
+    for (unsigned i = 0; i < count; i++)
+    {
+        unsigned used = generatorCounts[i];
+        if (used == 0) continue;
+
+        unsigned limit;
+        Contact *destination = contacts.getSpace(used, &limit);
+        std::copy(generatorContacts[i], generatorContacts[i] + used,
+                  destination);
+        contacts.commit(used);
+    }
+}
+
+unsigned World::findIsland(unsigned body)
+{
+    while (islandParents[body] != body)
+    {
+        // Halve the path as we go, to keep later searches short.
+        islandParents[body] = islandParents[islandParents[body]];
+        body = islandParents[body];
+    }
+    return body;
+}
+
+void World::resolveIslands(Contact *contactArray, unsigned numContacts,
+                           real duration)
+{
+    if (numContacts == 0) return;
+
+    // Find the distinct dynamic bodies involved. The resolver never
+    // changes other bodies, so islands can safely share them.
+    islandBodies.clear();
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        for (unsigned b = 0; b < 2; b++)
+        {
+            RigidBody *body = contactArray[i].body[b];
+            if (body && body->isDynamic()) islandBodies.push_back(body);
+        }
+    }
+    std::sort(islandBodies.begin(), islandBodies.end());
+    islandBodies.erase(
+        std::unique(islandBodies.begin(), islandBodies.end()),
+        islandBodies.end());
+
+    // Join the dynamic bodies of each contact into one island. Each
+    // contact is then labelled by its first dynamic body; every
+    // contact has one, as the others have already been removed.
+    unsigned bodyCount = (unsigned)islandBodies.size();
+    islandParents.resize(bodyCount);
+    for (unsigned i = 0; i < bodyCount; i++) islandParents[i] = i;
+
+    contactIslands.resize(numContacts);
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        unsigned found[2];
+        unsigned count = 0;
+        for (unsigned b = 0; b < 2; b++)
+        {
+            RigidBody *body = contactArray[i].body[b];
+            if (!body || !body->isDynamic()) continue;
+            found[count++] = (unsigned)(std::lower_bound(
+                islandBodies.begin(), islandBodies.end(), body) -
+                islandBodies.begin());
+        }
+        contactIslands[i] = found[0];
+
+        if (count == 2)
+        {
+            unsigned a = findIsland(found[0]);
+            unsigned b = findIsland(found[1]);
+            if (a < b) islandParents[b] = a;
+            else if (b < a) islandParents[a] = b;
+        }
+    }
+
+    // Number the islands in order of their first contact, so the
+    // order doesn't depend on where bodies lie in memory. Once every
+    // contact knows its root, the parents can hold the numbers.
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        contactIslands[i] = findIsland(contactIslands[i]);
+    }
+    const unsigned unnumbered = ~0u;
+    islandParents.assign(bodyCount, unnumbered);
+    islandStarts.assign(1, 0);
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        unsigned &number = islandParents[contactIslands[i]];
+        if (number == unnumbered)
+        {
+            number = (unsigned)islandStarts.size() - 1;
+            islandStarts.push_back(0);
+        }
+        contactIslands[i] = number;
+        islandStarts[number+1]++;
+    }
+    unsigned islandCount = (unsigned)islandStarts.size() - 1;
+    for (unsigned i = 0; i < islandCount; i++)
+    {
+        islandStarts[i+1] += islandStarts[i];
+    }
+
+    // Group the contacts by island, keeping their order within each.
+    islandContacts.resize(numContacts);
+    std::vector<unsigned> &next = islandParents;
+    next.assign(islandStarts.begin(), islandStarts.end() - 1);
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        islandContacts[next[contactIslands[i]]++] = contactArray[i];
+    }
+
+    // Islands vary a lot in size, so hand them out in small batches.
+    ResolveTask task;
+    task.resolver = &resolver;
+    task.calculateIterations = calculateIterations;
+    task.contacts = &islandContacts[0];
+    task.islandStarts = &islandStarts[0];
+    task.duration = duration;
+    jobs->parallelFor(task, islandCount, 4);
+}
+
+void World::setFixedTimestep(real step, unsigned maxSubsteps)
+{
+    fixedStep = step;
+    World::maxSubsteps = maxSubsteps > 0 ? maxSubsteps : 1;
+    accumulator = 0;
+}
+
+real World::getInterpolationAlpha() const
+{
+    if (fixedStep <= 0) return 1;
+    return accumulator / fixedStep;
 }
 
 void World::runPhysics(real duration)
+{
+    if (fixedStep <= 0)
+    {
+        step(duration);
+        return;
+    }
+
+    // Drop any time we can't catch up on this frame.
+    accumulator += duration;
+    real maxTime = fixedStep * maxSubsteps;
+    if (accumulator > maxTime) accumulator = maxTime;
+
+    unsigned steps = (unsigned)(accumulator / fixedStep);
+    if (steps > maxSubsteps) steps = maxSubsteps;
+    if (steps == 0) return;
+
+    // Integration clears the accumulators, so keep the frame's forces
+    // for the steps after the first.
+    unsigned count = bodies.size();
+    if (steps > 1)
+    {
+        frameForces.resize(count);
+        frameTorques.resize(count);
+        for (unsigned i = 0; i < count; i++)
+        {
+            frameForces[i] = bodies[i]->getAccumulatedForce();
+            frameTorques[i] = bodies[i]->getAccumulatedTorque();
+        }
+    }
+
+    for (unsigned s = 0; s < steps; s++)
+    {
+        for (unsigned i = 0; i < count; i++)
+        {
+            bodies[i]->storePreviousTransform();
+            if (s > 0)
+            {
+                bodies[i]->addForce(frameForces[i]);
+                bodies[i]->addTorque(frameTorques[i]);
+            }
+        }
+        step(fixedStep);
+        accumulator -= fixedStep;
+    }
+    if (accumulator < 0) accumulator = 0;
+}
+
+void World::prepareDamping(real duration)
+{
+    dampingTable.setDuration(duration);
+
+    // Hints are checked against the damping values, so it doesn't
+    // matter if bodies have moved around since the last step.
+    unsigned count = bodies.size();
+    dampingHints.resize(count * 2, ~0u);
+    for (unsigned i = 0; i < count; i++)
+    {
+        dampingTable.updateHint(bodies[i]->getLinearDamping(),
+                                &dampingHints[i*2]);
+        dampingTable.updateHint(bodies[i]->getAngularDamping(),
+                                &dampingHints[i*2+1]);
+    }
+}
+
+void World::step(real duration)
 {
     // First apply the force generators
-    //registry.updateForces(duration);
+    registry.updateForces(duration, jobs);
+    applyExplosions(duration);
+
+    // Remember where the continuously checked spheres start
+    beginContinuousCollision();
+
+    // Bring back any islands that were disturbed since the last step
+    if (islandSleeping) wakeDisturbedIslands();
 
     // Then integrate the objects
-    BodyRegistration *reg = firstBody;
-    while (reg)
+    prepareDamping(duration);
+    if (jobs)
     {
-        // Remove all forces from the accumulator
-        reg->body->integrate(duration);
-
-        // Get the next registration
-        reg = reg->next;
+        IntegrateTask task;
+        task.bodies = bodies.data();
+        task.table = &dampingTable;
+        task.hints = dampingHints.empty() ? NULL : &dampingHints[0];
+        task.duration = duration;
+        task.sleepAlone = !islandSleeping;
+        jobs->parallelFor(task, bodies.size());
+    }
+    else
+    {
+        real sleepBias = dampingTable.getSleepBias();
+        for (unsigned i = 0; i < bodies.size(); i++)
+        {
+            bodies[i]->integrate(duration,
+                dampingTable.getFactor(dampingHints[i*2]),
+                dampingTable.getFactor(dampingHints[i*2+1]),
+                sleepBias, !islandSleeping);
+        }
     }
 
+    // Stop any fast moving bodies at their first impact
+    sweepFastBodies();
+
     // Generate contacts
     unsigned usedContacts = generateContacts();
+    Contact *contactArray = contacts.gather();
+    usedContacts = removeIdleContacts(contactArray, usedContacts);
 
     // And process them
-    if (calculateIterations) resolver.setIterations(usedContacts * 4);
-    resolver.resolveContacts(contacts, usedContacts, duration);
+    if (jobs)
+    {
+        resolveIslands(contactArray, usedContacts, duration);
+    }
+    else
+    {
+        if (calculateIterations) resolver.setIterations(usedContacts * 4);
+        resolver.resolveContacts(contactArray, usedContacts, duration);
+    }
+
+    // Put to sleep any islands that have come to rest
+    if (islandSleeping) sleepRestingIslands(contactArray, usedContacts);
+}
+
+void World::setIslandSleeping(bool enabled)
+{
+    // Sleeping bodies stay asleep, they'll be woken one at a time by
+    // the resolver from now on.
+    islandSleeping = enabled;
+    sleepingBodies.clear();
+}
+
+bool World::isGeneratorAwake(const ContactGenerator *generator)
+{
+    unsigned count = generator->getBodyCount();
+    if (count == 0) return true;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        RigidBody *body = generator->getBody(i);
+        if (body && body->getAwake()) return true;
+    }
+    return false;
+}
+
+void World::wakeIsland(RigidBody *body)
+{
+    SleepingBody key = {body, 0};
+    std::vector<SleepingBody>::iterator found = std::lower_bound(
+        sleepingBodies.begin(), sleepingBodies.end(), key);
+    if (found == sleepingBodies.end() || found->body != body)
+    {
+        // The body was put to sleep some other way, wake it alone.
+        body->setAwake();
+        return;
+    }
+
+    // Wake every body in the island, and take them off the list.
+    unsigned island = found->island;
+    unsigned kept = 0;
+    for (unsigned i = 0; i < sleepingBodies.size(); i++)
+    {
+        if (sleepingBodies[i].island == island)
+        {
+            sleepingBodies[i].body->setAwake();
+            continue;
+        }
+        sleepingBodies[kept++] = sleepingBodies[i];
+    }
+    sleepingBodies.resize(kept);
+}
+
+void World::wakeDisturbedIslands()
+{
+    for (unsigned i = 0; i < sleepingBodies.size(); )
+    {
+        // Waking takes the island off the list, so only move on if
+        // nothing was woken.
+        RigidBody *body = sleepingBodies[i].body;
+        if (body->getAwake()) wakeIsland(body);
+        else i++;
+    }
+}
+
+bool World::wakeTouchedIslands(const Contact *contactArray,
+                               unsigned numContacts)
+{
+    bool woken = false;
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        const Contact &contact = contactArray[i];
+
+        // Collisions with the world never cause a body to wake up.
+        if (!contact.body[1]) continue;
+
+        bool awake0 = contact.body[0]->getAwake();
+        bool awake1 = contact.body[1]->getAwake();
+        if (awake0 == awake1) continue;
+
+        // Bodies that aren't dynamic are never woken by contacts.
+        RigidBody *sleeper = awake0 ? contact.body[1] : contact.body[0];
+        if (!sleeper->isDynamic()) continue;
+
+        wakeIsland(sleeper);
+        woken = true;
+    }
+    return woken;
+}
+
+unsigned World::removeIdleContacts(Contact *contactArray,
+                                  unsigned numContacts) const
+{
+    unsigned kept = 0;
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        const Contact &contact = contactArray[i];
+        bool active = false;
+        for (unsigned b = 0; b < 2; b++)
+        {
+            const RigidBody *body = contact.body[b];
+            if (body && body->isDynamic() &&
+                (!islandSleeping || body->getAwake()))
+            {
+                active = true;
+            }
+        }
+        if (!active) continue;
+
+        if (kept != i) contactArray[kept] = contact;
+        kept++;
+    }
+    return kept;
+}
+
+/**
+ * Returns true if the body has been still for long enough to sleep.
+ */
+static bool isResting(const RigidBody *body, real sleepEpsilon)
+{
+    return body->getCanSleep() && body->getMotion() < sleepEpsilon;
+}
+
+void World::sleepRestingIslands(const Contact *contactArray,
+                                unsigned numContacts)
+{
+    // Find the awake bodies in contact. Bodies of infinite mass never
+    // move, so they don't hold islands together.
+    islandBodies.clear();
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        for (unsigned b = 0; b < 2; b++)
+        {
+            RigidBody *body = contactArray[i].body[b];
+            if (body && body->isDynamic() && body->getAwake() &&
+                body->getInverseMass() > 0)
+            {
+                islandBodies.push_back(body);
+            }
+        }
+    }
+    std::sort(islandBodies.begin(), islandBodies.end());
+    islandBodies.erase(
+        std::unique(islandBodies.begin(), islandBodies.end()),
+        islandBodies.end());
+
+    // Join them into islands.
+    unsigned bodyCount = (unsigned)islandBodies.size();
+    islandParents.resize(bodyCount);
+    for (unsigned i = 0; i < bodyCount; i++) islandParents[i] = i;
+
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        const Contact &contact = contactArray[i];
+        if (!contact.body[1]) continue;
+
+        std::vector<RigidBody*>::iterator first = std::lower_bound(
+            islandBodies.begin(), islandBodies.end(), contact.body[0]);
+        std::vector<RigidBody*>::iterator second = std::lower_bound(
+            islandBodies.begin(), islandBodies.end(), contact.body[1]);
+        if (first == islandBodies.end() || *first != contact.body[0] ||
+            second == islandBodies.end() || *second != contact.body[1])
+        {
+            continue;
+        }
+
+        unsigned a = findIsland((unsigned)(first - islandBodies.begin()));
+        unsigned b = findIsland((unsigned)(second - islandBodies.begin()));
+        if (a < b) islandParents[b] = a;
+        else if (b < a) islandParents[a] = b;
+    }
+
+    // An island can only sleep if every body in it is resting.
+    real sleepEpsilon = getSleepEpsilon();
+    islandResting.assign(bodyCount, true);
+    for (unsigned i = 0; i < bodyCount; i++)
+    {
+        if (!isResting(islandBodies[i], sleepEpsilon))
+        {
+            islandResting[findIsland(i)] = false;
+        }
+    }
+
+    unsigned before = (unsigned)sleepingBodies.size();
+    for (unsigned i = 0; i < bodyCount; i++)
+    {
+        unsigned root = findIsland(i);
+        if (!islandResting[root]) continue;
+
+        SleepingBody sleeper = {islandBodies[i], nextSleepingIsland + root};
+        sleepingBodies.push_back(sleeper);
+        islandBodies[i]->setAwake(false);
+    }
+    nextSleepingIsland += bodyCount;
+
+    // Bodies touching nothing else form islands of their own.
+    for (unsigned i = 0; i < bodies.size(); i++)
+    {
+        RigidBody *body = bodies[i];
+        if (!body->isDynamic() || !body->getAwake() ||
+            !isResting(body, sleepEpsilon)) continue;
+        if (std::binary_search(islandBodies.begin(), islandBodies.end(),
+                               body))
+        {
+            continue;
+        }
+
+        SleepingBody sleeper = {body, nextSleepingIsland++};
+        sleepingBodies.push_back(sleeper);
+        body->setAwake(false);
+    }
+
+    // Keep the list sorted for lookups.
+    if (sleepingBodies.size() > before)
+    {
+        std::sort(sleepingBodies.begin() + before, sleepingBodies.end());
+        std::inplace_merge(sleepingBodies.begin(),
+                           sleepingBodies.begin() + before,
+                           sleepingBodies.end());
+    }
+}
+
+void World::addContinuousSphere(CollisionSphere *sphere)
+{
+    continuousSpheres.push_back(sphere);
+}
+
+void World::removeContinuousSphere(CollisionSphere *sphere)
+{
+    continuousSpheres.erase(
+        std::remove(continuousSpheres.begin(), continuousSpheres.end(), sphere),
+        continuousSpheres.end());
+}
+
+void World::addContinuousObstacle(const CollisionBox *box)
+{
+    continuousBoxes.push_back(box);
+}
+
+void World::addContinuousObstacle(const CollisionPlane *plane)
+{
+    continuousPlanes.push_back(plane);
+}
+
+void World::removeContinuousObstacle(const CollisionBox *box)
+{
+    continuousBoxes.erase(
+        std::remove(continuousBoxes.begin(), continuousBoxes.end(), box),
+        continuousBoxes.end());
+}
+
+void World::removeContinuousObstacle(const CollisionPlane *plane)
+{
+    continuousPlanes.erase(
+        std::remove(continuousPlanes.begin(), continuousPlanes.end(), plane),
+        continuousPlanes.end());
+}
+
+void World::setContinuousThreshold(real threshold)
+{
+    continuousThreshold = threshold;
+}
+
+void World::addExplosion(Explosion *explosion)
+{
+    explosions.push_back(explosion);
+}
+
+unsigned World::getExplosionCount() const
+{
+    return (unsigned)explosions.size();
+}
+
+void World::setExplosionCellSize(real size)
+{
+    explosionGrid.setCellSize(size);
+}
+
+void World::applyExplosions(real duration)
+{
+    if (explosions.empty()) return;
+
+    // Sort the bodies once, for all the explosions to share.
+    explosionGrid.build(bodies.data(), bodies.size());
+
+    unsigned kept = 0;
+    for (unsigned i = 0; i < explosions.size(); i++)
+    {
+        Explosion *explosion = explosions[i];
+        explosionTargets.clear();
+        explosionGrid.query(explosion->detonation, explosion->getRadius(),
+                            &explosionTargets);
+        for (unsigned j = 0; j < explosionTargets.size(); j++)
+        {
+            explosion->updateForce(explosionTargets[j], duration);
+        }
+
+        explosion->advance(duration);
+        if (explosion->isActive()) explosions[kept++] = explosion;
+    }
+    explosions.resize(kept);
+}
+
+void World::beginContinuousCollision()
+{
+    sweepStarts.resize(continuousSpheres.size());
+    for (unsigned i = 0; i < continuousSpheres.size(); i++)
+    {
+        CollisionSphere *sphere = continuousSpheres[i];
+        sphere->calculateInternals();
+        sweepStarts[i] = sphere->getAxis(3);
+    }
+}
+
+void World::sweepFastBodies()
+{
+    for (unsigned i = 0; i < continuousSpheres.size(); i++)
+    {
+        CollisionSphere *sphere = continuousSpheres[i];
+        if (!sphere->body->isDynamic() || !sphere->body->getAwake()) continue;
+
+        // Find how far the sphere moved this frame.
+        sphere->calculateInternals();
+        const Vector3 &start = sweepStarts[i];
+        Vector3 end = sphere->getAxis(3);
+        Vector3 movement = end - start;
+
+        // Slow spheres can't tunnel, leave them to the generators.
+        real threshold = continuousThreshold * sphere->radius;
+        if (movement.squareMagnitude() <= threshold*threshold) continue;
+
+        // Find the first impact along the path.
+        real first = 1;
+        bool hit = false;
+        real toi;
+        Vector3 normal, firstNormal;
+        for (unsigned b = 0; b < continuousBoxes.size(); b++)
+        {
+            if (continuousBoxes[b]->body == sphere->body) continue;
+            if (SweepTests::sphereAndBox(start, end, sphere->radius,
+                *continuousBoxes[b], &toi, &normal) && toi < first)
+            {
+                first = toi;
+                firstNormal = normal;
+                hit = true;
+            }
+        }
+        for (unsigned p = 0; p < continuousPlanes.size(); p++)
+        {
+            if (SweepTests::sphereAndHalfSpace(start, end, sphere->radius,
+                *continuousPlanes[p], &toi, &normal) && toi < first)
+            {
+                first = toi;
+                firstNormal = normal;
+                hit = true;
+            }
+        }
+        if (!hit) continue;
+
+        // A sphere that started the frame touching an obstacle and
+        // is moving into it only loses the movement into it, so a
+        // sphere rolling or sliding along the obstacle keeps going.
+        if (first <= 0)
+        {
+            Vector3 position = sphere->body->getPosition();
+            position -= firstNormal * (movement * firstNormal);
+            sphere->body->setPosition(position);
+            sphere->body->calculateDerivedData();
+            sphere->calculateInternals();
+            continue;
+        }
+
+        // Move the body back to the point of impact. We leave it
+        // overlapping the obstacle by a small fraction of its radius,
+        // so the contact generators reliably report the impact.
+        real length = movement.magnitude();
+        first += sphere->radius * ((real)0.05) / length;
+        if (first >= 1) continue;
+
+        Vector3 position = sphere->body->getPosition();
+        position -= movement * (1 - first);
+        sphere->body->setPosition(position);
+        sphere->body->calculateDerivedData();
+        sphere->calculateInternals();
+    }
 }
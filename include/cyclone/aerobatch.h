@@ -0,0 +1,194 @@
+/*
+ * Interface file for the batched aerodynamic surfaces.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a batch evaluator for aerodynamic surfaces, for
+ * simulations with many aircraft. It does the same job as a set of
+ * Aero and AeroControl force generators, but keeps all the surfaces
+ * together so they can be updated in a few tight loops.
+ */
+#ifndef CYCLONE_AEROBATCH_H
+#define CYCLONE_AEROBATCH_H
+
+#include <vector>
+#include "body.h"
+
+namespace cyclone {
+
+    /**
+     * Holds the aerodynamic surfaces of many bodies, and applies
+     * their forces all at once.
+     *
+     * Each surface has a base tensor and a pair of extreme tensors
+     * that its control setting blends towards, just like
+     * AeroControl. Fixed surfaces, like Aero, use the base tensor
+     * for all three.
+     *
+     * The surface data is stored as a structure of arrays, one array
+     * per tensor or vector component, so the blending and the force
+     * calculations run as simple loops over the surfaces that the
+     * compiler can vectorise. The velocity of each body is moved
+     * into body space once, rather than once per surface, and the
+     * forces and torques are summed in body space, so each body has
+     * only one force and one torque to turn back into world space.
+     */
+    class AeroBatch
+    {
+        /**
+         * Holds the bodies that have surfaces.
+         */
+        std::vector<RigidBody*> bodies;
+
+        /**
+         * Holds the index of the body each surface is attached to.
+         */
+        std::vector<unsigned> surfaceBodies;
+
+        /**
+         * Holds the components of each surface's base tensor.
+         */
+        std::vector<real> baseTensors[9];
+
+        /**
+         * Holds the components of each surface's tensor at its
+         * minimum control setting.
+         */
+        std::vector<real> minTensors[9];
+
+        /**
+         * Holds the components of each surface's tensor at its
+         * maximum control setting.
+         */
+        std::vector<real> maxTensors[9];
+
+        /**
+         * Holds the components of each surface's position in body
+         * coordinates.
+         */
+        std::vector<real> positions[3];
+
+        /**
+         * Holds the control setting of each surface.
+         */
+        std::vector<real> controls;
+
+        /**
+         * Holds the blended tensor of each surface for this update.
+         */
+        std::vector<real> tensors[9];
+
+        /**
+         * Holds the velocity of each surface through the air, in
+         * body coordinates, for this update.
+         */
+        std::vector<real> velocities[3];
+
+        /**
+         * Holds the force of each surface, in body coordinates, for
+         * this update.
+         */
+        std::vector<real> forces[3];
+
+        /**
+         * Holds the torque of each surface, in body coordinates, for
+         * this update.
+         */
+        std::vector<real> torques[3];
+
+        /**
+         * Holds the velocity of each body through the air, in body
+         * coordinates, for this update.
+         */
+        std::vector<Vector3> bodyVelocities;
+
+        /**
+         * Holds the total force and torque on each body, in body
+         * coordinates, for this update.
+         */
+        std::vector<Vector3> bodyForces, bodyTorques;
+
+        /**
+         * Holds a pointer to the windspeed of the environment, shared
+         * by all the surfaces.
+         */
+        const Vector3 *windspeed;
+
+    public:
+        /**
+         * Creates an empty batch in the given wind.
+         */
+        AeroBatch(const Vector3 *windspeed);
+
+        /**
+         * Adds a body that surfaces can be attached to, and returns
+         * its index in the batch.
+         */
+        unsigned addBody(RigidBody *body);
+
+        /**
+         * Adds a fixed surface to the body with the given index, and
+         * returns the index of the surface. This behaves like an
+         * Aero force generator.
+         */
+        unsigned addSurface(unsigned body, const Matrix3 &tensor,
+                            const Vector3 &position);
+
+        /**
+         * Adds a control surface to the body with the given index,
+         * and returns the index of the surface. This behaves like an
+         * AeroControl force generator, with its control at zero.
+         */
+        unsigned addControlSurface(unsigned body, const Matrix3 &base,
+                                   const Matrix3 &min, const Matrix3 &max,
+                                   const Vector3 &position);
+
+        /**
+         * Sets the control setting of the surface with the given
+         * index. This should range between -1 (where the minimum
+         * tensor is used), through 0 (the base tensor) to +1 (the
+         * maximum tensor). Values outside that range are clamped.
+         */
+        void setControl(unsigned surface, real value);
+
+        /**
+         * Gets the control setting of the surface with the given
+         * index.
+         */
+        real getControl(unsigned surface) const;
+
+        /**
+         * Returns the number of bodies in the batch.
+         */
+        unsigned getBodyCount() const;
+
+        /**
+         * Returns the number of surfaces in the batch.
+         */
+        unsigned getSurfaceCount() const;
+
+        /**
+         * Removes all the bodies and surfaces.
+         */
+        void clear();
+
+        /**
+         * Calculates the forces of all the surfaces, and applies them
+         * to their bodies.
+         */
+        void updateForces(real duration);
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_AEROBATCH_H
@@ -0,0 +1,143 @@
+/*
+ * Interface file for the per-frame memory arena.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a simple linear allocator for data that only
+ * lives for a single simulation frame, such as contacts.
+ */
+#ifndef CYCLONE_ARENA_H
+#define CYCLONE_ARENA_H
+
+#include <cstddef>
+#include <new>
+
+namespace cyclone {
+
+    /**
+     * A frame arena hands out memory by bumping a pointer through
+     * large blocks, and releases everything in one go when it is
+     * reset. It is intended for data that is rebuilt every frame:
+     * allocation is a couple of additions and nothing is ever freed
+     * individually.
+     *
+     * When a frame needs more memory than the current block holds,
+     * another block is chained on. On the next reset the blocks are
+     * coalesced into a single block large enough for the whole
+     * frame, so after a few frames the arena settles on one block
+     * and stops touching the system allocator altogether.
+     *
+     * The arena is not thread safe. Give each thread its own arena.
+     */
+    class FrameArena
+    {
+        /**
+         * Holds the header of one block of arena memory. The usable
+         * memory follows directly after the header.
+         */
+        struct Block
+        {
+            Block *next;
+            size_t size;
+            size_t used;
+        };
+
+        /**
+         * Holds the block currently being allocated from. Earlier
+         * blocks in this frame are chained through their next
+         * pointers.
+         */
+        Block *current;
+
+        /**
+         * Holds the minimum size of a newly allocated block.
+         */
+        size_t blockSize;
+
+        /**
+         * Holds the total number of bytes handed out since the last
+         * reset, including alignment padding.
+         */
+        size_t bytesUsed;
+
+        /**
+         * Allocates a new block able to hold at least the given
+         * number of bytes, and makes it the current block.
+         */
+        void addBlock(size_t minimumSize);
+
+        /**
+         * Returns all blocks to the system allocator.
+         */
+        void releaseBlocks();
+
+        // Arenas own their memory, so they can't be copied.
+        FrameArena(const FrameArena &);
+        FrameArena& operator=(const FrameArena &);
+
+    public:
+        /**
+         * Creates a new arena. No memory is taken until the first
+         * allocation.
+         */
+        FrameArena(size_t blockSize = 64*1024);
+
+        /**
+         * Releases all the memory held by the arena.
+         */
+        ~FrameArena();
+
+        /**
+         * Returns a pointer to the given number of bytes, aligned to
+         * the given power of two. The memory stays valid until the
+         * next call to reset.
+         */
+        void* allocate(size_t bytes, size_t alignment = 16);
+
+        /**
+         * Allocates and default constructs an array of objects. The
+         * objects are never destructed, so this should only be used
+         * for types with a trivial destructor.
+         */
+        template<class T>
+        T* allocateArray(unsigned count)
+        {
+            T *result = static_cast<T*>(allocate(sizeof(T) * count));
+            for (unsigned i = 0; i < count; i++) new (result + i) T;
+            return result;
+        }
+
+        /**
+         * Releases every allocation made since the last reset. The
+         * memory is kept for the next frame.
+         */
+        void reset();
+
+        /**
+         * Returns the number of bytes allocated since the last reset.
+         */
+        size_t getBytesUsed() const
+        {
+            return bytesUsed;
+        }
+
+        /**
+         * Returns the number of bytes the arena can hand out without
+         * going back to the system allocator.
+         */
+        size_t getCapacity() const;
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_ARENA_H
@@ -45,6 +45,32 @@ namespace cyclone {
 
         // ... Other RigidBody code as before ...
 
+        /**
+         * Describes how a body takes part in the simulation.
+         */
+        enum Type
+        {
+            /**
+             * The body is moved by forces and contacts.
+             */
+            DYNAMIC,
+
+            /**
+             * The body moves at the velocity and rotation it is
+             * given, and is never moved by forces or contacts. It
+             * pushes dynamic bodies out of its way, like a body of
+             * infinite mass.
+             */
+            KINEMATIC,
+
+            /**
+             * The body never moves. It isn't integrated, contacts
+             * never change it, and the world keeps it apart from the
+             * moving bodies, so it costs nothing per frame.
+             */
+            STATIC
+        };
+
 
     protected:
         /**
@@ -195,6 +221,24 @@ namespace cyclone {
          */
         Matrix4 transformMatrix;
 
+        /**
+         * Holds the position of the body at the start of the last
+         * simulation step, so rendering can interpolate between
+         * steps.
+         */
+        Vector3 previousPosition;
+
+        /**
+         * Holds the orientation of the body at the start of the last
+         * simulation step.
+         */
+        Quaternion previousOrientation;
+
+        /**
+         * Holds how the body takes part in the simulation.
+         */
+        Type type;
+
         /*@}*/
 
 
@@ -247,6 +291,12 @@ namespace cyclone {
          */
         /*@{*/
 
+        /**
+         * Creates a dynamic body. The rest of the body's data must be
+         * set before it is simulated.
+         */
+        RigidBody();
+
         /*@}*/
 
 
@@ -281,6 +331,32 @@ namespace cyclone {
          */
         void integrate(real duration);
 
+        /**
+         * Integrates the rigid body forward in time by the given
+         * amount, using drag factors and a sleep bias that have
+         * already been worked out for the duration, as held in a
+         * damping table. This gives exactly the same result as
+         * integrate(duration), without the per-body powers.
+         *
+         * @param duration The duration of the step.
+         *
+         * @param linearFactor The linear damping raised to the power
+         * of the duration.
+         *
+         * @param angularFactor The angular damping raised to the
+         * power of the duration.
+         *
+         * @param sleepBias One half raised to the power of the
+         * duration.
+         *
+         * @param sleepAlone If false, the body's motion is tracked as
+         * usual but the body never falls asleep by itself, leaving the
+         * caller to put it to sleep along with the bodies it touches.
+         */
+        void integrate(real duration, real linearFactor,
+                       real angularFactor, real sleepBias,
+                       bool sleepAlone = true);
+
         /*@}*/
 
 
@@ -334,7 +410,8 @@ namespace cyclone {
         void setInverseMass(const real inverseMass);
 
         /**
-         * Gets the inverse mass of the rigid body.
+         * Gets the inverse mass of the rigid body. Kinematic and
+         * static bodies always have an inverse mass of zero.
          *
          * @return The current inverse mass of the rigid body.
          */
@@ -435,6 +512,9 @@ namespace cyclone {
          * Copies the current inverse inertia tensor of the rigid body
          * into the given matrix.
          *
+         * Kinematic and static bodies always have a zero inverse
+         * inertia tensor.
+         *
          * @param inverseInertiaTensor A pointer to a matrix to hold
          * the current inverse inertia tensor of the rigid body. The
          * inertia tensor is expressed in world space.
@@ -656,6 +736,37 @@ namespace cyclone {
          */
         Matrix4 getTransform() const;
 
+        /**
+         * Records the body's current position and orientation as its
+         * previous transform. The world calls this at the start of
+         * each fixed simulation step.
+         */
+        void storePreviousTransform();
+
+        /**
+         * Fills the given matrix with a transformation between the
+         * body's previous and current transforms. An alpha of zero
+         * gives the previous transform, and one the current.
+         *
+         * @param alpha The proportion of the way to the current
+         * transform.
+         *
+         * @param transform A pointer to the matrix to fill.
+         */
+        void getInterpolatedTransform(real alpha, Matrix4 *transform) const;
+
+        /**
+         * Fills the given matrix data structure with a transformation
+         * between the body's previous and current transforms, in the
+         * form used by getGLTransform.
+         *
+         * @param alpha The proportion of the way to the current
+         * transform.
+         *
+         * @param matrix A pointer to the matrix to fill.
+         */
+        void getInterpolatedGLTransform(real alpha, float matrix[16]) const;
+
         /**
          * Converts the given point from world space into the body's
          * local space.
@@ -822,6 +933,42 @@ namespace cyclone {
             return canSleep;
         }
 
+        /**
+         * Sets how the body takes part in the simulation. Making a
+         * body static stops it dead and puts it to sleep; making it
+         * kinematic clears its acceleration. The type should be set
+         * before the body is added to a world.
+         */
+        void setType(Type type);
+
+        /**
+         * Returns how the body takes part in the simulation.
+         */
+        Type getType() const
+        {
+            return type;
+        }
+
+        /**
+         * Returns true if the body is moved by forces and contacts.
+         * Kinematic and static bodies behave as if they had infinite
+         * mass, and contact resolution never changes them.
+         */
+        bool isDynamic() const
+        {
+            return type == DYNAMIC;
+        }
+
+        /**
+         * Returns the recency weighted mean of the body's motion,
+         * which is compared against the sleep epsilon to decide when
+         * the body can sleep.
+         */
+        real getMotion() const
+        {
+            return motion;
+        }
+
         /**
          * Sets whether the body is ever allowed to go to sleep. Bodies
          * under the player's control, or for which the set of
@@ -888,6 +1035,18 @@ namespace cyclone {
          */
         void clearAccumulators();
 
+        /**
+         * Gets the force accumulated for the next integration step,
+         * in world coordinates.
+         */
+        Vector3 getAccumulatedForce() const;
+
+        /**
+         * Gets the torque accumulated for the next integration step,
+         * in world coordinates.
+         */
+        Vector3 getAccumulatedTorque() const;
+
         /**
          * Adds the given force to centre of mass of the rigid body.
          * The force is expressed in world-coordinates.
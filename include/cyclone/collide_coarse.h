@@ -22,6 +22,7 @@
 
 #include <vector>
 #include "contacts.h"
+#include "grid.h"
 
 namespace cyclone {
 
@@ -83,6 +84,67 @@ namespace cyclone {
         RigidBody* body[2];
     };
 
+    /**
+     * Sorts bodies into a uniform grid by their positions, so the
+     * bodies near a point can be found without looking at all of
+     * them. The grid is rebuilt from scratch whenever the bodies
+     * have moved. The sorting and searching is done by a HashGrid.
+     */
+    class BodyGrid
+    {
+        /**
+         * Holds the bodies' positions, sorted into cells.
+         */
+        HashGrid grid;
+
+        /**
+         * Holds the bodies the grid was built from.
+         */
+        std::vector<RigidBody*> bodies;
+
+        /**
+         * Holds the indices of the bodies found by a query.
+         */
+        mutable std::vector<unsigned> found;
+
+    public:
+        /**
+         * Creates an empty grid with the given cell size. Queries are
+         * quickest when cells are around the size of the regions
+         * being searched.
+         */
+        BodyGrid(real cellSize = 4);
+
+        /**
+         * Sets the length of the side of each cell. This takes
+         * effect the next time the grid is built.
+         */
+        void setCellSize(real size);
+
+        /**
+         * Gets the length of the side of each cell.
+         */
+        real getCellSize() const
+        {
+            return grid.getCellSize();
+        }
+
+        /**
+         * Sorts the given bodies into the grid, replacing whatever it
+         * held before.
+         */
+        void build(RigidBody * const *bodies, unsigned count);
+
+        /**
+         * Finds the bodies whose positions, when the grid was built,
+         * were within the given radius of the given centre, and adds
+         * them to the end of the results. Returns the number of
+         * bodies found.
+         */
+        unsigned query(const Vector3 &centre, real radius,
+                       std::vector<RigidBody*> *results) const;
+    };
+
     /**
      * A base class for nodes in a bounding volume hierarchy.
      *
@@ -0,0 +1,198 @@
+/*
+ * Interface file for the convex hull collision primitive.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains the convex hull collision primitive, and the
+ * general convex tests that work with it.
+ *
+ * Rather than having a hand written routine for every pair of
+ * shapes, the convex tests only need to be able to find the point of
+ * each shape that is furthest in a given direction (its support
+ * point). The GJK algorithm uses support points to find the distance
+ * between two shapes, and the expanding polytope algorithm (EPA)
+ * uses them to find how deeply two overlapping shapes interpenetrate.
+ */
+#ifndef CYCLONE_COLLISION_CONVEX_H
+#define CYCLONE_COLLISION_CONVEX_H
+
+#include <vector>
+#include "collide_fine.h"
+
+namespace cyclone {
+
+    /**
+     * Represents a rigid body that can be treated as an arbitrary
+     * convex hull for collision detection.
+     *
+     * The hull is given by its vertices, in the body's local space.
+     * The vertices are stored as separate arrays of x, y and z
+     * coordinates, so a support query runs down three contiguous
+     * arrays rather than striding through vectors.
+     *
+     * Small hulls are searched exhaustively. For large hulls, give
+     * the triangles of the hull as well: the hull then knows which
+     * vertices are joined by an edge, and support queries walk
+     * uphill across the edges from the last support point found.
+     * Because consecutive queries from the collision tests are in
+     * similar directions, the walk usually only takes a few steps.
+     * The last support point is cached in the hull, so a hull should
+     * only be queried from one thread at a time.
+     */
+    class CollisionConvex : public CollisionPrimitive
+    {
+        /**
+         * Holds the x coordinates of the vertices in local space.
+         */
+        std::vector<real> vertexX;
+
+        /**
+         * Holds the y coordinates of the vertices in local space.
+         */
+        std::vector<real> vertexY;
+
+        /**
+         * Holds the z coordinates of the vertices in local space.
+         */
+        std::vector<real> vertexZ;
+
+        /**
+         * Holds, for each vertex, the index of its first neighbour
+         * in the adjacency array. The neighbours of vertex i are
+         * found between adjacencyStart[i] and adjacencyStart[i+1].
+         * This is empty if no triangles have been given.
+         */
+        std::vector<unsigned> adjacencyStart;
+
+        /**
+         * Holds the neighbours of every vertex, packed together.
+         */
+        std::vector<unsigned> adjacency;
+
+        /**
+         * Holds the index of the last support point found, where the
+         * next uphill walk begins.
+         */
+        mutable unsigned lastSupport;
+
+        /**
+         * Holds the distance of the furthest vertex from the origin
+         * of the hull's local space.
+         */
+        real boundingRadius;
+
+    public:
+        /**
+         * Creates an empty hull.
+         */
+        CollisionConvex();
+
+        /**
+         * Sets the vertices of the hull, in local space. Any
+         * triangles previously given are discarded.
+         */
+        void setVertices(const Vector3 *vertices, unsigned count);
+
+        /**
+         * Sets the triangles of the hull, as three vertex indices per
+         * triangle. This builds the edge information used to speed up
+         * support queries on large hulls. The vertices should be set
+         * first.
+         */
+        void setTriangles(const unsigned *indices, unsigned triangleCount);
+
+        /**
+         * Returns the number of vertices in the hull.
+         */
+        unsigned getVertexCount() const
+        {
+            return (unsigned)vertexX.size();
+        }
+
+        /**
+         * Returns the given vertex, in local space.
+         */
+        Vector3 getVertex(unsigned index) const
+        {
+            return Vector3(vertexX[index], vertexY[index], vertexZ[index]);
+        }
+
+        /**
+         * Returns the distance of the furthest vertex from the
+         * hull's origin.
+         */
+        real getBoundingRadius() const
+        {
+            return boundingRadius;
+        }
+
+        /**
+         * Returns the index of the vertex that is furthest in the
+         * given direction, given in local space.
+         */
+        unsigned findSupportIndex(const Vector3 &localDirection) const;
+
+        /**
+         * Returns the point of the hull that is furthest in the given
+         * direction. Both the direction and the result are in world
+         * space, so calculateInternals should have been called.
+         */
+        Vector3 getSupport(const Vector3 &direction) const;
+    };
+
+    /**
+     * A wrapper class that holds the general convex tests. Each takes
+     * two convex hulls whose internals are up to date.
+     */
+    class ConvexTests
+    {
+    public:
+        /**
+         * Returns true if the two hulls overlap.
+         */
+        static bool intersect(
+            const CollisionConvex &one,
+            const CollisionConvex &two
+            );
+
+        /**
+         * Returns the distance between the two hulls, or zero if they
+         * overlap. If the pointers are given, they are filled with
+         * the closest point on each hull.
+         */
+        static real distance(
+            const CollisionConvex &one,
+            const CollisionConvex &two,
+            Vector3 *pointOne = NULL,
+            Vector3 *pointTwo = NULL
+            );
+
+        /**
+         * Finds how deeply two overlapping hulls interpenetrate.
+         * Returns false if they don't overlap. Otherwise the normal
+         * is filled with the direction the first hull should move to
+         * separate them, the depth with how far it should move, and
+         * the point with a point midway through the overlap.
+         */
+        static bool penetration(
+            const CollisionConvex &one,
+            const CollisionConvex &two,
+            Vector3 *normal,
+            real *depth,
+            Vector3 *point
+            );
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_COLLISION_CONVEX_H
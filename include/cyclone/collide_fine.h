@@ -32,6 +32,9 @@ namespace cyclone {
     // Forward declarations of primitive friends
     class IntersectionTests;
     class CollisionDetector;
+    class CollisionConvex;
+    class CollisionTriangleMesh;
+    class CollisionHeightfield;
 
     /**
      * Represents a primitive to detect collisions against.
@@ -137,6 +140,40 @@ namespace cyclone {
         Vector3 halfSize;
     };
 
+    /**
+     * Represents a rigid body that can be treated as a capsule for
+     * collision detection: a sphere swept along a line segment. The
+     * segment runs along the primitive's local Y axis, centred on its
+     * origin.
+     */
+    class CollisionCapsule : public CollisionPrimitive
+    {
+    public:
+        /**
+         * The radius of the capsule.
+         */
+        real radius;
+
+        /**
+         * Half the length of the capsule's central segment. This does
+         * not include the rounded ends, so the whole capsule is
+         * 2*(halfHeight+radius) long.
+         */
+        real halfHeight;
+
+        /**
+         * Fills the given vectors with the ends of the central
+         * segment, in world coordinates.
+         */
+        void getSegment(Vector3 *start, Vector3 *end) const
+        {
+            Vector3 centre = getAxis(3);
+            Vector3 axis = getAxis(1) * halfHeight;
+            *start = centre - axis;
+            *end = centre + axis;
+        }
+    };
+
     /**
      * A wrapper class that holds fast intersection tests. These
      * can be used to drive the coarse collision detection system or
@@ -176,9 +213,61 @@ namespace cyclone {
     };
 
 
+    /**
+     * A wrapper class that holds continuous (swept) tests. Each test
+     * moves a sphere in a straight line from a start position to an
+     * end position, and finds the first moment along that path at
+     * which it touches the other object. These are used to stop fast
+     * moving objects passing straight through thin objects between
+     * one frame and the next.
+     *
+     * Each test returns true if the sphere touches the object at any
+     * point along its path. The time of impact is written as a
+     * proportion of the path, from 0 (at the start position) to 1
+     * (at the end position). If the sphere is already touching the
+     * object at the start, the time of impact is zero if it is moving
+     * further into the object, and otherwise there is no impact, as
+     * the sphere can't get any deeper. If a normal
+     * is requested it is set to the contact normal at the time of
+     * impact, pointing out of the other object towards the sphere.
+     */
+    class SweepTests
+    {
+    public:
+
+        /**
+         * Sweeps a sphere against a half-space (i.e. the normal of
+         * the plane points out of the half-space).
+         */
+        static bool sphereAndHalfSpace(
+            const Vector3 &start,
+            const Vector3 &end,
+            real radius,
+            const CollisionPlane &plane,
+            real *timeOfImpact,
+            Vector3 *normal = NULL);
+
+        /**
+         * Sweeps a sphere against an arbitrarily aligned box. The box
+         * is taken to be stationary at its current transform.
+         */
+        static bool sphereAndBox(
+            const Vector3 &start,
+            const Vector3 &end,
+            real radius,
+            const CollisionBox &box,
+            real *timeOfImpact,
+            Vector3 *normal = NULL);
+    };
+
     /**
      * A helper structure that contains information for the detector to use
      * in building its contact data.
+     *
+     * Contacts are written either into a fixed array (set contactArray
+     * and call reset), or into a growable contact buffer (set buffer
+     * and call reset). With a buffer attached the data never runs out
+     * of contacts: when a chunk fills, the next one is started.
      */
     struct CollisionData
     {
@@ -187,6 +276,10 @@ namespace cyclone {
          * in the array. This is used so that the contact pointer (below)
          * can be incremented each time a contact is detected, while
          * this pointer points to the first contact found.
+         *
+         * When a buffer is attached this is the start of the current
+         * chunk until gather is called, after which it holds every
+         * contact found.
          */
         Contact *contactArray;
 
@@ -211,20 +304,57 @@ namespace cyclone {
          */
         real tolerance;
 
+        /**
+         * Holds the growable buffer to write contacts into, or NULL
+         * if contacts are written to the fixed contactArray.
+         */
+        ContactBuffer *buffer;
+
+        /**
+         * Creates empty collision data with no storage attached.
+         */
+        CollisionData()
+        :
+        contactArray(NULL), contacts(NULL), contactsLeft(0),
+        contactCount(0), friction(0), restitution(0), tolerance(0),
+        buffer(NULL)
+        {
+        }
+
         /**
          * Checks if there are more contacts available in the contact
-         * data.
+         * data. With a buffer attached this makes sure there is room
+         * for the given number of contacts, starting a new chunk if
+         * needed, and so always succeeds. With a fixed array it only
+         * checks that at least one contact is left.
          */
-        bool hasMoreContacts()
+        bool hasMoreContacts(unsigned needed = 1)
         {
+            if (buffer && contactsLeft < (int)needed)
+            {
+                // Close off the current chunk and start another.
+                buffer->commit(contacts - contactArray);
+                unsigned available;
+                contactArray = contacts = buffer->getSpace(needed, &available);
+                contactsLeft = available;
+            }
             return contactsLeft > 0;
         }
 
         /**
          * Resets the data so that it has no used contacts recorded.
+         * If a buffer is attached the given maximum is ignored, and
+         * the buffer is emptied instead.
          */
         void reset(unsigned maxContacts)
         {
+            if (buffer)
+            {
+                unsigned available;
+                buffer->reset();
+                contactArray = buffer->getSpace(1, &available);
+                maxContacts = available;
+            }
             contactsLeft = maxContacts;
             contactCount = 0;
             contacts = contactArray;
@@ -243,6 +373,20 @@ namespace cyclone {
             // Move the array forward
             contacts += count;
         }
+
+        /**
+         * Finishes contact generation for a buffer: the contacts from
+         * every chunk are made contiguous and contactArray is set to
+         * point at them, so contactArray and contactCount can be
+         * handed to the resolver. Does nothing for a fixed array.
+         */
+        void gather()
+        {
+            if (!buffer) return;
+            buffer->commit(contacts - contactArray);
+            contactArray = contacts = buffer->gather();
+            contactsLeft = 0;
+        }
     };
 
     /**
@@ -303,6 +447,159 @@ namespace cyclone {
             const CollisionSphere &sphere,
             CollisionData *data
             );
+
+        /**
+         * Does a collision test on a capsule and a half-space. Each
+         * end of the capsule that is inside the half-space generates
+         * a contact, so a capsule lying on the plane is supported at
+         * both ends.
+         */
+        static unsigned capsuleAndHalfSpace(
+            const CollisionCapsule &capsule,
+            const CollisionPlane &plane,
+            CollisionData *data
+            );
+
+        static unsigned capsuleAndSphere(
+            const CollisionCapsule &capsule,
+            const CollisionSphere &sphere,
+            CollisionData *data
+            );
+
+        /**
+         * Does a collision test on two capsules. Capsules lying
+         * alongside one another generate a contact at each end of
+         * the overlap, otherwise a single contact is generated
+         * between the closest points of their segments.
+         */
+        static unsigned capsuleAndCapsule(
+            const CollisionCapsule &one,
+            const CollisionCapsule &two,
+            CollisionData *data
+            );
+
+        static unsigned capsuleAndBox(
+            const CollisionCapsule &capsule,
+            const CollisionBox &box,
+            CollisionData *data
+            );
+
+        /**
+         * Does a collision test on a sphere and a single triangle of
+         * static geometry. The triangle is given as three vertices,
+         * and faces the side its vertices are anticlockwise from. A
+         * sphere whose centre has sunk behind the triangle, by less
+         * than its radius, is pushed back out of the front.
+         */
+        static unsigned sphereAndTriangle(
+            const CollisionSphere &sphere,
+            const Vector3 *triangle,
+            CollisionData *data
+            );
+
+        /**
+         * Does a collision test on a capsule and a single triangle of
+         * static geometry. Each end of the capsule touching the
+         * triangle generates a contact, and the middle of the capsule
+         * can also touch one of the triangle's edges.
+         */
+        static unsigned capsuleAndTriangle(
+            const CollisionCapsule &capsule,
+            const Vector3 *triangle,
+            CollisionData *data
+            );
+
+        /**
+         * Does a collision test on a box and a single triangle of
+         * static geometry. Box vertices behind the triangle and
+         * triangle vertices inside the box generate contacts, in the
+         * same way as the box and half-space and box and point tests.
+         * If the box is closest to getting out across an edge of the
+         * triangle, as when it rests on a ridge, an edge contact is
+         * added, as in the box and box test.
+         */
+        static unsigned boxAndTriangle(
+            const CollisionBox &box,
+            const Vector3 *triangle,
+            CollisionData *data
+            );
+
+        /**
+         * Does a collision test on a sphere and a static triangle
+         * mesh, testing each nearby triangle in turn. This and the
+         * other mesh and heightfield routines are implemented in
+         * collide_mesh.cpp.
+         */
+        static unsigned sphereAndMesh(
+            const CollisionSphere &sphere,
+            const CollisionTriangleMesh &mesh,
+            CollisionData *data
+            );
+
+        static unsigned capsuleAndMesh(
+            const CollisionCapsule &capsule,
+            const CollisionTriangleMesh &mesh,
+            CollisionData *data
+            );
+
+        static unsigned boxAndMesh(
+            const CollisionBox &box,
+            const CollisionTriangleMesh &mesh,
+            CollisionData *data
+            );
+
+        static unsigned sphereAndHeightfield(
+            const CollisionSphere &sphere,
+            const CollisionHeightfield &heightfield,
+            CollisionData *data
+            );
+
+        static unsigned capsuleAndHeightfield(
+            const CollisionCapsule &capsule,
+            const CollisionHeightfield &heightfield,
+            CollisionData *data
+            );
+
+        static unsigned boxAndHeightfield(
+            const CollisionBox &box,
+            const CollisionHeightfield &heightfield,
+            CollisionData *data
+            );
+
+        /**
+         * Does a collision test on a convex hull and a half-space.
+         * Each vertex of the hull that is inside the half-space
+         * generates a contact. These routines are implemented in
+         * collide_convex.cpp.
+         */
+        static unsigned convexAndHalfSpace(
+            const CollisionConvex &convex,
+            const CollisionPlane &plane,
+            CollisionData *data
+            );
+
+        static unsigned convexAndSphere(
+            const CollisionConvex &convex,
+            const CollisionSphere &sphere,
+            CollisionData *data
+            );
+
+        static unsigned convexAndBox(
+            const CollisionConvex &convex,
+            const CollisionBox &box,
+            CollisionData *data
+            );
+
+        /**
+         * Does a collision test on two convex hulls, using GJK and
+         * EPA. A single contact is generated at the deepest point of
+         * the overlap.
+         */
+        static unsigned convexAndConvex(
+            const CollisionConvex &one,
+            const CollisionConvex &two,
+            CollisionData *data
+            );
     };
 
 
@@ -0,0 +1,295 @@
+/*
+ * Interface file for the static triangle mesh and heightfield
+ * colliders.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains colliders for large pieces of static level
+ * geometry: arbitrary triangle meshes and regular heightfields.
+ *
+ * Like the collision plane, these are not primitives: they don't
+ * represent a rigid body, and contacts against them have no second
+ * body. Each keeps its own bounding volume hierarchy, so a query
+ * only visits the handful of triangles near the object being tested.
+ * The hierarchies store their bounds as 16-bit integers relative to
+ * the bounds of the whole shape, to keep memory low for very large
+ * levels.
+ */
+#ifndef CYCLONE_COLLISION_MESH_H
+#define CYCLONE_COLLISION_MESH_H
+
+#include <vector>
+#include "collide_fine.h"
+
+namespace cyclone {
+
+    /**
+     * Holds one node of a triangle mesh's bounding volume hierarchy.
+     * Nodes are stored depth first, so the first child of an internal
+     * node directly follows it.
+     */
+    struct QuantizedNode
+    {
+        /**
+         * Holds the quantized lower corner of the node's bounds.
+         */
+        unsigned short min[3];
+
+        /**
+         * Holds the quantized upper corner of the node's bounds.
+         */
+        unsigned short max[3];
+
+        /**
+         * For an internal node, holds the index of the first node
+         * after its subtree. For a leaf, the top bit is set, the next
+         * three bits hold the number of triangles and the remaining
+         * bits hold the index of the first triangle.
+         */
+        unsigned data;
+    };
+
+    /**
+     * A static collider made of an arbitrary set of triangles. The
+     * triangles are one sided: they face the side their vertices are
+     * anticlockwise from.
+     *
+     * The mesh stores its vertices once, its triangles as three
+     * vertex indices, and a hierarchy node for every two triangles
+     * or so: around 26 bytes per triangle for a typical mesh.
+     */
+    class CollisionTriangleMesh
+    {
+        /**
+         * Holds the vertex coordinates, three per vertex.
+         */
+        std::vector<real> vertices;
+
+        /**
+         * Holds the vertex indices, three per triangle. Triangles
+         * are reordered when the hierarchy is built, so each leaf
+         * refers to a contiguous run of them.
+         */
+        std::vector<unsigned> indices;
+
+        /**
+         * Holds the hierarchy nodes. The first is the root.
+         */
+        std::vector<QuantizedNode> nodes;
+
+        /**
+         * Holds the lower corner of the mesh's bounds, which
+         * quantized coordinates are relative to.
+         */
+        Vector3 boundsMin;
+
+        /**
+         * Holds the number of quantization steps per unit distance
+         * along each axis.
+         */
+        Vector3 quantization;
+
+        /**
+         * Quantizes a point, rounding either down or up.
+         */
+        void quantize(const Vector3 &point, bool roundUp,
+                      unsigned short *result) const;
+
+        /**
+         * Builds the hierarchy over the given range of triangles,
+         * returning the index of the node created.
+         */
+        unsigned buildNode(std::vector<unsigned> &order,
+                           const std::vector<Vector3> &centres,
+                           unsigned begin, unsigned end);
+
+    public:
+        /**
+         * Sets the triangles of the mesh and builds its hierarchy.
+         * The indices give three vertices for each triangle.
+         */
+        void setMesh(const Vector3 *vertices, unsigned vertexCount,
+                     const unsigned *indices, unsigned triangleCount);
+
+        /**
+         * Returns the number of triangles in the mesh.
+         */
+        unsigned getTriangleCount() const
+        {
+            return (unsigned)(indices.size() / 3);
+        }
+
+        /**
+         * Fills the given array with the three vertices of the given
+         * triangle. Triangle indices refer to the order after the
+         * hierarchy is built, as returned by findTriangles.
+         */
+        void getTriangle(unsigned index, Vector3 *triangle) const;
+
+        /**
+         * Appends to the given list the index of every triangle whose
+         * bounds might overlap the given box.
+         */
+        void findTriangles(const Vector3 &min, const Vector3 &max,
+                           std::vector<unsigned> *results) const;
+
+        /**
+         * Returns the number of bytes of mesh and hierarchy data.
+         */
+        unsigned getMemoryUsed() const;
+    };
+
+    /**
+     * A static collider made of a regular grid of heights, such as
+     * terrain. The grid lies in the XZ plane, with heights along Y.
+     * Each grid cell is split into two triangles.
+     *
+     * Rather than a general hierarchy, the heightfield keeps the
+     * quantized height range of square blocks of cells, and of
+     * successively larger groups of blocks, so it stores little more
+     * than the heights themselves.
+     */
+    class CollisionHeightfield
+    {
+        /**
+         * Holds the height of each sample, row by row.
+         */
+        std::vector<real> heights;
+
+        /**
+         * Holds the number of samples along X.
+         */
+        unsigned columns;
+
+        /**
+         * Holds the number of samples along Z.
+         */
+        unsigned rows;
+
+        /**
+         * Holds the position of the first sample, with a height of
+         * zero.
+         */
+        Vector3 origin;
+
+        /**
+         * Holds the distance between samples along X.
+         */
+        real spacingX;
+
+        /**
+         * Holds the distance between samples along Z.
+         */
+        real spacingZ;
+
+        /**
+         * Holds the lowest height, which quantized heights are
+         * relative to.
+         */
+        real minHeight;
+
+        /**
+         * Holds the number of quantization steps per unit height.
+         */
+        real quantization;
+
+        /**
+         * Holds the quantized lowest and highest heights of each node
+         * of the hierarchy, level by level. Level zero has a node for
+         * each block of cells, and each level above has a node for
+         * each two by two group of nodes below.
+         */
+        std::vector<unsigned short> bounds;
+
+        /**
+         * Holds the index in the bounds of the first node of each
+         * level.
+         */
+        std::vector<unsigned> levelOffset;
+
+        /**
+         * Holds the number of nodes along X in each level.
+         */
+        std::vector<unsigned> levelColumns;
+
+        /**
+         * Holds the number of nodes along Z in each level.
+         */
+        std::vector<unsigned> levelRows;
+
+        /**
+         * Finds the triangles of the given node that might overlap
+         * the given range of cells and quantized heights.
+         */
+        void findInNode(unsigned level, unsigned column, unsigned row,
+                        const unsigned *cellRange,
+                        const unsigned short *heightRange,
+                        real minY, real maxY,
+                        std::vector<unsigned> *results) const;
+
+    public:
+        /**
+         * Creates an empty heightfield.
+         */
+        CollisionHeightfield();
+
+        /**
+         * Sets the heights and builds the hierarchy. The heights are
+         * given row by row, with columns samples in each of rows
+         * rows. The first sample is at the origin (offset by its
+         * height), and the others are spaced out along X and Z.
+         */
+        void setHeights(const real *heights,
+                        unsigned columns, unsigned rows,
+                        const Vector3 &origin,
+                        real spacingX, real spacingZ);
+
+        /**
+         * Returns the height of the given sample.
+         */
+        real getHeight(unsigned column, unsigned row) const
+        {
+            return heights[row * columns + column];
+        }
+
+        /**
+         * Returns the number of triangles in the heightfield.
+         */
+        unsigned getTriangleCount() const
+        {
+            if (columns < 2 || rows < 2) return 0;
+            return (columns-1) * (rows-1) * 2;
+        }
+
+        /**
+         * Fills the given array with the three vertices of the given
+         * triangle.
+         */
+        void getTriangle(unsigned index, Vector3 *triangle) const;
+
+        /**
+         * Appends to the given list the index of every triangle whose
+         * bounds might overlap the given box.
+         */
+        void findTriangles(const Vector3 &min, const Vector3 &max,
+                           std::vector<unsigned> *results) const;
+
+        /**
+         * Returns the number of bytes of height and hierarchy data.
+         */
+        unsigned getMemoryUsed() const;
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_COLLISION_MESH_H
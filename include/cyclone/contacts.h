@@ -27,6 +27,7 @@
 #define CYCLONE_CONTACTS_H
 
 #include "body.h"
+#include "arena.h"
 
 namespace cyclone {
 
@@ -420,6 +421,129 @@ namespace cyclone {
             real duration);
     };
 
+    /**
+     * Holds the contacts generated in one frame, in a chain of
+     * fixed size chunks taken from a frame arena. The buffer grows
+     * on demand, so a spike in the number of contacts never drops
+     * any of them, and the memory is recycled when the buffer is
+     * reset at the start of the next frame.
+     *
+     * A buffer has a single writer. When contacts are generated on
+     * several threads, give each thread its own buffer and gather
+     * them in a fixed order afterwards.
+     */
+    class ContactBuffer
+    {
+        /**
+         * Holds one chunk of contacts in the chain.
+         */
+        struct Chunk
+        {
+            Contact *contacts;
+            unsigned used;
+            unsigned capacity;
+            Chunk *next;
+        };
+
+        /**
+         * Holds the arena that chunks are allocated from.
+         */
+        FrameArena arena;
+
+        /**
+         * Holds the first and last chunks in the chain. New contacts
+         * are always written into the last chunk.
+         */
+        Chunk *firstChunk;
+        Chunk *lastChunk;
+
+        /**
+         * Holds the number of contacts in each newly created chunk.
+         */
+        unsigned chunkSize;
+
+        /**
+         * Holds the number of contacts committed across all chunks.
+         */
+        unsigned contactCount;
+
+        /**
+         * Holds the number of chunks in the chain.
+         */
+        unsigned chunkCount;
+
+        /**
+         * Adds a new chunk to the end of the chain with room for at
+         * least the given number of contacts.
+         */
+        void addChunk(unsigned minimum);
+
+        // Buffers own arena memory, so they can't be copied.
+        ContactBuffer(const ContactBuffer &);
+        ContactBuffer& operator=(const ContactBuffer &);
+
+    public:
+        /**
+         * Creates a new buffer that grows in chunks of the given
+         * number of contacts.
+         */
+        ContactBuffer(unsigned chunkSize = 256);
+
+        /**
+         * Throws away all the contacts in the buffer, recycling
+         * their memory for the next frame.
+         */
+        void reset();
+
+        /**
+         * Returns a pointer to free space for contacts that is at
+         * least the given number of contacts long, starting a new
+         * chunk if the current one doesn't have enough room. The
+         * number of contacts that may be written is returned through
+         * the available pointer. The contacts are not part of the
+         * buffer until they are committed.
+         */
+        Contact* getSpace(unsigned minimum, unsigned *available);
+
+        /**
+         * Marks the given number of contacts, written at the start
+         * of the last space returned by getSpace, as used.
+         */
+        void commit(unsigned count);
+
+        /**
+         * Returns the number of contacts committed to the buffer.
+         */
+        unsigned getContactCount() const
+        {
+            return contactCount;
+        }
+
+        /**
+         * Returns the number of chunks in use this frame.
+         */
+        unsigned getChunkCount() const
+        {
+            return chunkCount;
+        }
+
+        /**
+         * Returns all the committed contacts as one contiguous
+         * array, ready for the contact resolver. If only one chunk
+         * was needed this is the chunk itself, otherwise the chunks
+         * are copied into a single array from the arena. The array
+         * is valid until the buffer is reset, and writing further
+         * contacts after gathering invalidates it.
+         */
+        Contact* gather();
+
+        /**
+         * Copies all the committed contacts, in order, into the
+         * given array, which must be large enough to hold them.
+         */
+        void copyTo(Contact *destination) const;
+    };
+
     /**
      * This is the basic polymorphic interface for contact generators
      * applying to rigid bodies.
@@ -436,6 +560,27 @@ namespace cyclone {
          * been written.
          */
         virtual unsigned addContact(Contact *contact, unsigned limit) const = 0;
+
+        /**
+         * Returns the number of bodies this generator's contacts can
+         * involve. A world that sleeps whole islands only calls a
+         * generator while at least one of these bodies is awake. The
+         * default of zero means the bodies aren't known, so the
+         * generator is always called.
+         */
+        virtual unsigned getBodyCount() const
+        {
+            return 0;
+        }
+
+        /**
+         * Returns one of the bodies this generator's contacts can
+         * involve. Scenery can be given as NULL.
+         */
+        virtual RigidBody* getBody(unsigned index) const
+        {
+            return NULL;
+        }
     };
 
 } // namespace cyclone
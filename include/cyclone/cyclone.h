@@ -17,6 +17,8 @@
 #include "pcontacts.h"
 #include "pworld.h"
 #include "collide_fine.h"
+#include "collide_convex.h"
+#include "collide_mesh.h"
 #include "contacts.h"
 #include "fgen.h"
 #include "joints.h"
\ No newline at end of file
@@ -0,0 +1,130 @@
+/*
+ * Interface file for the damping table.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a table of the per-step factors used when
+ * integrating, so they can be worked out once per step rather than
+ * once per object.
+ */
+#ifndef CYCLONE_DAMPING_H
+#define CYCLONE_DAMPING_H
+
+#include <vector>
+#include "core.h"
+
+namespace cyclone {
+
+    /**
+     * Holds the drag factor for each distinct damping value in use,
+     * for one step duration, along with the sleep bias for that
+     * duration.
+     *
+     * Working out a drag factor means raising the damping to the
+     * power of the duration, which is expensive. Most objects share
+     * a handful of damping values, and with a fixed step the duration
+     * never changes, so the table only ever calculates a few powers.
+     *
+     * Objects find their entry through a hint, which the caller keeps
+     * for each object between steps. Looking up with a valid hint is
+     * just a comparison, and a stale hint is simply replaced.
+     */
+    class DampingTable
+    {
+        /**
+         * Holds the damping value of each entry.
+         */
+        std::vector<real> dampings;
+
+        /**
+         * Holds the drag factor of each entry for the current
+         * duration.
+         */
+        std::vector<real> factors;
+
+        /**
+         * Holds the duration the factors were calculated for.
+         */
+        real duration;
+
+        /**
+         * Holds the sleep bias for the current duration.
+         */
+        real sleepBias;
+
+    public:
+        /**
+         * Holds the number of entries beyond which the table is
+         * emptied when the duration is set, so damping values that
+         * are no longer used don't pile up.
+         */
+        enum { MAX_ENTRIES = 64 };
+
+        /**
+         * Creates an empty table for a duration of zero.
+         */
+        DampingTable();
+
+        /**
+         * Sets the duration of the coming step, recalculating every
+         * factor if it has changed.
+         */
+        void setDuration(real duration);
+
+        /**
+         * Returns the duration the factors are calculated for.
+         */
+        real getDuration() const
+        {
+            return duration;
+        }
+
+        /**
+         * Returns the weight given to a body's previous motion when
+         * averaging its motion for sleeping, for the current duration.
+         */
+        real getSleepBias() const
+        {
+            return sleepBias;
+        }
+
+        /**
+         * Makes sure the hint refers to the entry for the given
+         * damping, adding an entry if there isn't one. This changes
+         * the table, so it must not be called while other threads are
+         * reading from it.
+         */
+        void updateHint(real damping, unsigned *hint);
+
+        /**
+         * Returns the drag factor of the entry the given hint refers
+         * to. The hint must have been updated since the duration was
+         * last set.
+         */
+        real getFactor(unsigned hint) const
+        {
+            return factors[hint];
+        }
+
+        /**
+         * Returns the number of entries in the table.
+         */
+        unsigned getSize() const
+        {
+            return (unsigned)dampings.size();
+        }
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_DAMPING_H
@@ -0,0 +1,358 @@
+/*
+ * Interface file for the batched force registries.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains force registries that group their registrations
+ * by force generator, so each generator is called once per update
+ * with all of its objects, rather than once per object.
+ */
+#ifndef CYCLONE_FBATCH_H
+#define CYCLONE_FBATCH_H
+
+#include <vector>
+#include <map>
+#include "fgen.h"
+#include "pfgen.h"
+#include "jobs.h"
+
+namespace cyclone {
+
+    /**
+     * Holds registrations of force generators against the objects
+     * they apply to, grouped by generator. Updating calls each
+     * generator's batch updateForces once, with every object it is
+     * registered against.
+     *
+     * Groups that share no objects can be updated at the same time.
+     * The registry sorts the groups into waves, where no two groups
+     * in a wave share an object, and each wave can be run in
+     * parallel by a job system. Within a wave each object is written
+     * by only one generator, so generators must only change the
+     * objects they are given. The waves keep the groups touching any
+     * one object in registration order, so forces are accumulated in
+     * the same order, and give the same result, however the update
+     * is run.
+     *
+     * A group whose generator can be split (see canSplit) is also
+     * broken into chunks of objects, so a single generator applied
+     * to very many objects is spread over all the threads. Each
+     * object is still in only one chunk of the group.
+     *
+     * The Object type is the kind of object forces are applied to,
+     * and Generator is its force generator interface, which must
+     * have a batch updateForces method.
+     */
+    template<class Object, class Generator>
+    class BatchedRegistry
+    {
+        /**
+         * Holds a generator and the objects it applies to.
+         */
+        struct Group
+        {
+            Generator *generator;
+            std::vector<Object*> objects;
+        };
+
+        /**
+         * Holds a range of the objects in one group, the unit of work
+         * when updating in parallel.
+         */
+        struct Chunk
+        {
+            unsigned group;
+            unsigned begin;
+            unsigned end;
+        };
+
+        /**
+         * Updates a range of chunks, for updating a wave in parallel.
+         */
+        class WaveTask : public ParallelTask
+        {
+        public:
+            Group *groups;
+            const Chunk *chunks;
+            real duration;
+
+            virtual void run(unsigned begin, unsigned end, unsigned thread)
+            {
+                for (unsigned i = begin; i < end; i++)
+                {
+                    const Chunk &chunk = chunks[i];
+                    Group &group = groups[chunk.group];
+                    group.generator->updateForces(
+                        &group.objects[chunk.begin], chunk.end - chunk.begin,
+                        duration);
+                }
+            }
+        };
+
+        /**
+         * Holds the groups, in the order their generators were first
+         * registered.
+         */
+        std::vector<Group> groups;
+
+        /**
+         * Holds the group of each generator.
+         */
+        std::map<Generator*, unsigned> groupIndex;
+
+        /**
+         * Holds the chunks of every group, sorted by wave.
+         */
+        std::vector<Chunk> chunks;
+
+        /**
+         * Holds the index of the first chunk of each wave, with an
+         * extra entry for the end of the last.
+         */
+        std::vector<unsigned> waveStarts;
+
+        /**
+         * Holds the most objects in a chunk of a group that can be
+         * split.
+         */
+        unsigned chunkSize;
+
+        /**
+         * True if the registrations have changed since the waves
+         * were last worked out.
+         */
+        bool wavesDirty;
+
+        /**
+         * Sorts the groups into waves, and breaks them into chunks.
+         * Each group goes in the wave after the last one that touches
+         * any of its objects.
+         */
+        void buildWaves()
+        {
+            unsigned count = (unsigned)groups.size();
+            std::vector<unsigned> groupWave(count, 0);
+            std::map<Object*, unsigned> objectWaves;
+            unsigned waveCount = 0;
+
+            for (unsigned g = 0; g < count; g++)
+            {
+                const std::vector<Object*> &objects = groups[g].objects;
+                unsigned wave = 0;
+                for (unsigned i = 0; i < objects.size(); i++)
+                {
+                    typename std::map<Object*, unsigned>::iterator found =
+                        objectWaves.find(objects[i]);
+                    if (found != objectWaves.end() && found->second > wave)
+                    {
+                        wave = found->second;
+                    }
+                }
+
+                // The map holds one past each object's last wave.
+                groupWave[g] = wave;
+                for (unsigned i = 0; i < objects.size(); i++)
+                {
+                    objectWaves[objects[i]] = wave + 1;
+                }
+                if (wave + 1 > waveCount) waveCount = wave + 1;
+            }
+
+            // Count the chunks in each group.
+            std::vector<unsigned> groupChunks(count, 1);
+            for (unsigned g = 0; g < count; g++)
+            {
+                unsigned size = (unsigned)groups[g].objects.size();
+                if (groups[g].generator->canSplit() && size > chunkSize)
+                {
+                    groupChunks[g] = (size + chunkSize - 1) / chunkSize;
+                }
+            }
+
+            // Sort the chunks by wave, keeping registration order
+            // within each.
+            waveStarts.assign(waveCount + 1, 0);
+            for (unsigned g = 0; g < count; g++)
+            {
+                waveStarts[groupWave[g]+1] += groupChunks[g];
+            }
+            for (unsigned w = 0; w < waveCount; w++)
+            {
+                waveStarts[w+1] += waveStarts[w];
+            }
+            chunks.resize(waveStarts[waveCount]);
+            std::vector<unsigned> next(waveStarts.begin(), waveStarts.end() - 1);
+            for (unsigned g = 0; g < count; g++)
+            {
+                unsigned size = (unsigned)groups[g].objects.size();
+                for (unsigned c = 0; c < groupChunks[g]; c++)
+                {
+                    Chunk &chunk = chunks[next[groupWave[g]]++];
+                    chunk.group = g;
+                    chunk.begin = c * chunkSize;
+                    chunk.end = groupChunks[g] > 1 ?
+                        chunk.begin + chunkSize : size;
+                    if (chunk.end > size) chunk.end = size;
+                }
+            }
+            wavesDirty = false;
+        }
+
+        /**
+         * Rebuilds the generator lookup after groups are removed.
+         */
+        void rebuildIndex()
+        {
+            groupIndex.clear();
+            for (unsigned g = 0; g < groups.size(); g++)
+            {
+                groupIndex[groups[g].generator] = g;
+            }
+        }
+
+    public:
+        BatchedRegistry() : chunkSize(256), wavesDirty(true) {}
+
+        /**
+         * Sets the most objects a generator that can be split is
+         * given at once, when updating in parallel. Smaller chunks
+         * balance better across threads, at more cost per chunk.
+         */
+        void setChunkSize(unsigned size)
+        {
+            chunkSize = size ? size : 1;
+            wavesDirty = true;
+        }
+
+        /**
+         * Returns the most objects in one chunk.
+         */
+        unsigned getChunkSize() const
+        {
+            return chunkSize;
+        }
+
+        /**
+         * Registers the given force generator to apply to the given
+         * object.
+         */
+        void add(Object *object, Generator *generator)
+        {
+            typename std::map<Generator*, unsigned>::iterator found =
+                groupIndex.find(generator);
+            if (found == groupIndex.end())
+            {
+                found = groupIndex.insert(std::make_pair(
+                    generator, (unsigned)groups.size())).first;
+                groups.push_back(Group());
+                groups.back().generator = generator;
+            }
+            groups[found->second].objects.push_back(object);
+            wavesDirty = true;
+        }
+
+        /**
+         * Removes the given registered pair from the registry. If
+         * the pair is not registered, this method will have no
+         * effect.
+         */
+        void remove(Object *object, Generator *generator)
+        {
+            typename std::map<Generator*, unsigned>::iterator found =
+                groupIndex.find(generator);
+            if (found == groupIndex.end()) return;
+
+            std::vector<Object*> &objects = groups[found->second].objects;
+            for (unsigned i = 0; i < objects.size(); i++)
+            {
+                if (objects[i] != object) continue;
+
+                objects.erase(objects.begin() + i);
+                if (objects.empty())
+                {
+                    groups.erase(groups.begin() + found->second);
+                    rebuildIndex();
+                }
+                wavesDirty = true;
+                return;
+            }
+        }
+
+        /**
+         * Clears all registrations from the registry. This will not
+         * delete the objects or the force generators themselves,
+         * just the records of their connection.
+         */
+        void clear()
+        {
+            groups.clear();
+            groupIndex.clear();
+            wavesDirty = true;
+        }
+
+        /**
+         * Returns the number of generators registered.
+         */
+        unsigned getGroupCount() const
+        {
+            return (unsigned)groups.size();
+        }
+
+        /**
+         * Calls each force generator once to update the forces of
+         * all its objects. If a job system is given, groups that
+         * share no objects are updated in parallel, and generators
+         * that can be split are given their objects in chunks.
+         */
+        void updateForces(real duration, JobSystem *jobs = NULL)
+        {
+            if (groups.empty()) return;
+
+            if (!jobs)
+            {
+                for (unsigned g = 0; g < groups.size(); g++)
+                {
+                    groups[g].generator->updateForces(
+                        &groups[g].objects[0],
+                        (unsigned)groups[g].objects.size(), duration);
+                }
+                return;
+            }
+
+            if (wavesDirty) buildWaves();
+
+            WaveTask task;
+            task.groups = &groups[0];
+            task.duration = duration;
+            for (unsigned w = 0; w + 1 < waveStarts.size(); w++)
+            {
+                task.chunks = &chunks[waveStarts[w]];
+                jobs->parallelFor(task, waveStarts[w+1] - waveStarts[w], 1);
+            }
+        }
+    };
+
+    /**
+     * A batched registry of rigid body force generators.
+     */
+    typedef BatchedRegistry<RigidBody, ForceGenerator> BatchedForceRegistry;
+
+    /**
+     * A batched registry of particle force generators.
+     */
+    typedef BatchedRegistry<Particle, ParticleForceGenerator>
+        BatchedParticleForceRegistry;
+
+} // namespace cyclone
+
+#endif // CYCLONE_FBATCH_H
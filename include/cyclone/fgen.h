@@ -37,6 +37,28 @@ namespace cyclone {
          * and update the force applied to the given rigid body.
          */
         virtual void updateForce(RigidBody *body, real duration) = 0;
+
+        /**
+         * Updates the forces on a batch of bodies. By default this
+         * calls updateForce for each one; generators that apply the
+         * same kind of force to many bodies can overload it to do
+         * the whole batch in one loop. Implementations must only
+         * change the bodies they are given, so that batches for
+         * different generators can be run in parallel.
+         */
+        virtual void updateForces(RigidBody * const *bodies, unsigned count,
+                                  real duration);
+
+        /**
+         * Returns true if this generator's bodies can be split into
+         * several batches, updated at the same time on different
+         * threads. That is only safe for generators that keep no
+         * working data between bodies, so by default it is false.
+         */
+        virtual bool canSplit() const
+        {
+            return false;
+        }
     };
 
     /**
@@ -55,6 +77,16 @@ namespace cyclone {
 
         /** Applies the gravitational force to the given rigid body. */
         virtual void updateForce(RigidBody *body, real duration);
+
+        /** Applies the gravitational force to a batch of bodies. */
+        virtual void updateForces(RigidBody * const *bodies, unsigned count,
+                                  real duration);
+
+        /** Gravity keeps no working data, so can always be split. */
+        virtual bool canSplit() const
+        {
+            return true;
+        }
     };
 
     /**
@@ -213,6 +245,41 @@ namespace cyclone {
          */
         Explosion();
 
+        /**
+         * Sets the explosion off at the given location, restarting
+         * it if it has already run.
+         */
+        void detonate(const Vector3 &location);
+
+        /**
+         * Moves the explosion on by the given time. Updating forces
+         * applies the explosion as it stands, so this should be
+         * called once per frame, after the forces on all the objects
+         * it affects have been updated.
+         */
+        void advance(real duration);
+
+        /**
+         * Returns true while any phase of the explosion is still
+         * going on.
+         */
+        bool isActive() const;
+
+        /**
+         * Returns the distance from the detonation beyond which the
+         * explosion currently has no effect, so the objects it could
+         * affect can be found with a spatial query.
+         */
+        real getRadius() const;
+
+        /**
+         * Calculates the force that the explosion currently applies
+         * to an object at the given position moving with the given
+         * velocity.
+         */
+        Vector3 calculateForce(const Vector3 &position,
+                               const Vector3 &velocity) const;
+
         /**
          * Calculates and applies the force that the explosion
          * has on the given rigid body.
@@ -223,7 +290,7 @@ namespace cyclone {
          * Calculates and applies the force that the explosion has
          * on the given particle.
          */
-        virtual void updateForce(Particle *particle, real duration) = 0;
+        virtual void updateForce(Particle *particle, real duration);
 
     };
 
@@ -0,0 +1,185 @@
+/*
+ * Interface file for the hashed uniform grid.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a uniform grid of points, used to find the
+ * points near a position without looking at all of them. The body
+ * grid and the particle grid are both built on it.
+ */
+#ifndef CYCLONE_GRID_H
+#define CYCLONE_GRID_H
+
+#include <vector>
+#include "core.h"
+
+namespace cyclone {
+
+    /**
+     * Holds a pair of points found close together, by their indices.
+     */
+    struct GridPair
+    {
+        unsigned first;
+        unsigned second;
+    };
+
+    /**
+     * Sorts points into a uniform grid by their positions, so the
+     * points near a position can be found by looking in only the
+     * cells around it.
+     *
+     * The grid is rebuilt from scratch, with a single counting sort,
+     * whenever the points have moved. Cells are hashed into a table
+     * of buckets, so the grid has no bounds and its memory only
+     * depends on the number of points. The grid keeps its own copy
+     * of the positions, sorted by cell, so queries walk through
+     * memory in order.
+     *
+     * To build the grid, set the number of points, give each point
+     * its position, then sort them. Points are identified by their
+     * index.
+     */
+    class HashGrid
+    {
+        /**
+         * Holds a point and the cell it is in.
+         */
+        struct Entry
+        {
+            Vector3 position;
+            unsigned index;
+            int cell[3];
+        };
+
+        /**
+         * Holds the length of the side of each cell.
+         */
+        real cellSize;
+
+        /**
+         * Holds the entries, sorted by bucket.
+         */
+        std::vector<Entry> entries;
+
+        /**
+         * Holds the index of the first entry in each bucket, with an
+         * extra entry for the end of the last.
+         */
+        std::vector<unsigned> bucketStarts;
+
+        /**
+         * Holds the entries in index order while the grid is built.
+         */
+        std::vector<Entry> unsorted;
+
+        /**
+         * Holds the bucket of each point while the grid is built.
+         */
+        std::vector<unsigned> pointBuckets;
+
+        /**
+         * Holds the next free entry in each bucket while the grid is
+         * built.
+         */
+        std::vector<unsigned> bucketFill;
+
+        /**
+         * Holds the bucket count minus one. The count is a power of
+         * two.
+         */
+        unsigned bucketMask;
+
+        /**
+         * Finds the cell holding the given position.
+         */
+        void getCell(const Vector3 &position, int cell[3]) const;
+
+        /**
+         * Returns the bucket that the given cell hashes to.
+         */
+        unsigned getBucket(const int cell[3]) const
+        {
+            return ((unsigned)cell[0] * 73856093u ^
+                    (unsigned)cell[1] * 19349663u ^
+                    (unsigned)cell[2] * 83492791u) & bucketMask;
+        }
+
+    public:
+        /**
+         * Creates an empty grid with the given cell size.
+         */
+        HashGrid(real cellSize = 1);
+
+        /**
+         * Sets the length of the side of each cell. This takes
+         * effect the next time the grid is sorted.
+         */
+        void setCellSize(real size);
+
+        /**
+         * Gets the length of the side of each cell.
+         */
+        real getCellSize() const
+        {
+            return cellSize;
+        }
+
+        /**
+         * Sets the number of points to be sorted into the grid. Each
+         * then needs its position set before the grid is sorted.
+         */
+        void setCount(unsigned count);
+
+        /**
+         * Sets the position of the point with the given index.
+         */
+        void setPoint(unsigned index, const Vector3 &position)
+        {
+            unsorted[index].position = position;
+            unsorted[index].index = index;
+        }
+
+        /**
+         * Sorts the points into the grid, replacing whatever it held
+         * before.
+         */
+        void sort();
+
+        /**
+         * Returns the number of points in the grid.
+         */
+        unsigned getCount() const
+        {
+            return (unsigned)entries.size();
+        }
+
+        /**
+         * Finds the points within the given radius of the given
+         * centre, and adds their indices to the end of the results.
+         * Returns the number of points found.
+         */
+        unsigned findNear(const Vector3 &centre, real radius,
+                          std::vector<unsigned> *results) const;
+
+        /**
+         * Finds every pair of points within the given distance of
+         * each other, and adds them to the end of the pairs, each pair
+         * once. Returns the number of pairs found.
+         */
+        unsigned findPairs(real radius, std::vector<GridPair> *pairs) const;
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_GRID_H
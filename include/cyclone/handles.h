@@ -0,0 +1,227 @@
+/*
+ * Interface file for handle based registration arrays.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains the handles the world gives out when objects
+ * are registered with it, and the array that maps them to the
+ * registered objects.
+ */
+#ifndef CYCLONE_HANDLES_H
+#define CYCLONE_HANDLES_H
+
+#include <vector>
+
+namespace cyclone {
+
+    /**
+     * Identifies an object registered in a handle array. A handle
+     * stays valid until its object is removed. After that it is
+     * recognised as stale, even if its slot has been reused by
+     * another object, because the slot's generation will have moved
+     * on.
+     *
+     * The type parameter only keeps handles for different kinds of
+     * object apart.
+     */
+    template<class T>
+    struct RegistrationHandle
+    {
+        /**
+         * Holds the index of the handle's slot.
+         */
+        unsigned slot;
+
+        /**
+         * Holds the generation of the slot when the handle was given
+         * out.
+         */
+        unsigned generation;
+
+        /**
+         * Creates a handle that refers to nothing.
+         */
+        RegistrationHandle() : slot(~0u), generation(0) {}
+
+        bool operator==(const RegistrationHandle &other) const
+        {
+            return slot == other.slot && generation == other.generation;
+        }
+
+        bool operator!=(const RegistrationHandle &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    /**
+     * Holds pointers to a set of registered objects, densely packed
+     * so they can be iterated over as a plain array. Removing an
+     * object moves the last object into its place, so removal is
+     * constant time but doesn't preserve order. Handles refer to
+     * objects through a slot table, so they survive this movement.
+     */
+    template<class T>
+    class HandleArray
+    {
+    public:
+        typedef RegistrationHandle<T> Handle;
+
+    private:
+        /**
+         * Holds one entry in the slot table. While the slot is in
+         * use, index is the position of its object in the dense
+         * array. While it is free, index is the next free slot.
+         */
+        struct Slot
+        {
+            unsigned index;
+            unsigned generation;
+        };
+
+        /**
+         * Holds the registered objects, densely packed.
+         */
+        std::vector<T*> items;
+
+        /**
+         * Holds the slot of each object in the dense array.
+         */
+        std::vector<unsigned> itemSlots;
+
+        /**
+         * Holds the slot table.
+         */
+        std::vector<Slot> slots;
+
+        /**
+         * Holds the first free slot, or ~0 if there are none.
+         */
+        unsigned firstFree;
+
+    public:
+        HandleArray() : firstFree(~0u) {}
+
+        /**
+         * Adds an object and returns its handle.
+         */
+        Handle add(T *item)
+        {
+            unsigned slot = firstFree;
+            if (slot != ~0u)
+            {
+                firstFree = slots[slot].index;
+            }
+            else
+            {
+                slot = (unsigned)slots.size();
+                Slot fresh = {0, 1};
+                slots.push_back(fresh);
+            }
+
+            slots[slot].index = (unsigned)items.size();
+            items.push_back(item);
+            itemSlots.push_back(slot);
+
+            Handle handle;
+            handle.slot = slot;
+            handle.generation = slots[slot].generation;
+            return handle;
+        }
+
+        /**
+         * Removes the object with the given handle. Returns false if
+         * the handle is stale.
+         */
+        bool remove(Handle handle)
+        {
+            if (!isValid(handle)) return false;
+
+            // Move the last object into the hole.
+            unsigned index = slots[handle.slot].index;
+            unsigned last = (unsigned)items.size() - 1;
+            items[index] = items[last];
+            itemSlots[index] = itemSlots[last];
+            slots[itemSlots[index]].index = index;
+            items.pop_back();
+            itemSlots.pop_back();
+
+            // Retire the slot so old handles go stale.
+            slots[handle.slot].generation++;
+            slots[handle.slot].index = firstFree;
+            firstFree = handle.slot;
+            return true;
+        }
+
+        /**
+         * Returns true if the handle refers to a registered object.
+         */
+        bool isValid(Handle handle) const
+        {
+            return handle.slot < slots.size() &&
+                slots[handle.slot].generation == handle.generation;
+        }
+
+        /**
+         * Returns the object with the given handle, or NULL if the
+         * handle is stale.
+         */
+        T* get(Handle handle) const
+        {
+            if (!isValid(handle)) return 0;
+            return items[slots[handle.slot].index];
+        }
+
+        /**
+         * Returns the number of registered objects.
+         */
+        unsigned size() const
+        {
+            return (unsigned)items.size();
+        }
+
+        /**
+         * Returns the object at the given position in the dense
+         * array. Positions change as objects are removed.
+         */
+        T* operator[](unsigned index) const
+        {
+            return items[index];
+        }
+
+        /**
+         * Returns the dense array of objects, or NULL if empty.
+         */
+        T* const* data() const
+        {
+            return items.empty() ? 0 : &items[0];
+        }
+
+        /**
+         * Removes every object, making all handles stale.
+         */
+        void clear()
+        {
+            while (!items.empty())
+            {
+                Handle handle;
+                handle.slot = itemSlots.back();
+                handle.generation = slots[handle.slot].generation;
+                remove(handle);
+            }
+        }
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_HANDLES_H
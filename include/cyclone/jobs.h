@@ -0,0 +1,210 @@
+/*
+ * Interface file for the job system.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a simple job system: a pool of worker threads
+ * that the simulation can hand ranges of work to. The world uses it
+ * to integrate bodies, generate contacts and resolve islands of
+ * contacts across several cores.
+ */
+#ifndef CYCLONE_JOBS_H
+#define CYCLONE_JOBS_H
+
+#include <vector>
+
+/**
+ * The job system only runs tasks on worker threads if this is 1.
+ * The threads need the C++11 thread library, so by default it is
+ * only 1 for compilers that have one. Without it the job system has
+ * the same interface, but runs every task on the calling thread.
+ */
+#ifndef CYCLONE_THREADS
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1700)
+#define CYCLONE_THREADS 1
+#else
+#define CYCLONE_THREADS 0
+#endif
+#endif
+
+#if CYCLONE_THREADS
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#endif
+
+namespace cyclone {
+
+    /**
+     * A parallel task is a piece of work over a range of items that
+     * can be split up and run on several threads at once. Each call
+     * to run covers a sub-range of the items, and different calls
+     * may be made at the same time from different threads.
+     */
+    class ParallelTask
+    {
+    public:
+        virtual ~ParallelTask() {}
+
+        /**
+         * Processes the items from begin up to (but not including)
+         * end. The thread index is unique to the thread making the
+         * call, between zero and the job system's thread count, so it
+         * can be used to pick per-thread scratch data.
+         */
+        virtual void run(unsigned begin, unsigned end, unsigned thread) = 0;
+    };
+
+    /**
+     * A pool of worker threads that runs parallel tasks.
+     *
+     * Each parallel-for splits its range into batches that are
+     * dealt out to a queue per thread. Each thread works through its
+     * own queue first, then steals batches from the other queues, so
+     * the load evens out when batches take different times. The
+     * calling thread works alongside the workers until the whole
+     * range is done.
+     *
+     * Only one parallel-for may run at a time, and tasks must not
+     * start parallel-fors of their own.
+     *
+     * If CYCLONE_THREADS is 0 there are no workers, and each
+     * parallel-for runs its whole range on the calling thread.
+     */
+    class JobSystem
+    {
+#if CYCLONE_THREADS
+        /**
+         * Holds one batch of work.
+         */
+        struct Job
+        {
+            ParallelTask *task;
+            unsigned begin;
+            unsigned end;
+        };
+
+        /**
+         * Holds the batches waiting on one thread. The owning thread
+         * takes batches from the back, thieves from the front.
+         */
+        struct Queue
+        {
+            std::mutex lock;
+            std::deque<Job> jobs;
+        };
+
+        /**
+         * Holds the worker threads. The calling thread is thread
+         * zero, so worker i is thread i+1.
+         */
+        std::vector<std::thread> workers;
+
+        /**
+         * Holds a queue for each thread, including the caller.
+         */
+        std::vector<Queue*> queues;
+
+        /**
+         * Holds the number of batches not yet finished.
+         */
+        std::atomic<unsigned> pending;
+
+        /**
+         * Guards the sleeping and waking of threads.
+         */
+        std::mutex wakeLock;
+
+        /**
+         * Wakes workers when new work arrives, or on shutdown.
+         */
+        std::condition_variable wakeWorkers;
+
+        /**
+         * Wakes the calling thread when the last batch finishes.
+         */
+        std::condition_variable wakeCaller;
+
+        /**
+         * Holds a count of parallel-fors started, so sleeping
+         * workers can tell that new work has arrived.
+         */
+        unsigned epoch;
+
+        /**
+         * Set when the workers should exit.
+         */
+        bool shuttingDown;
+
+        /**
+         * Takes a batch from the given thread's queue, or steals one
+         * from another thread. Returns false if there is no work.
+         */
+        bool findJob(unsigned thread, Job *job);
+
+        /**
+         * Runs a batch and marks it as finished.
+         */
+        void runJob(const Job &job, unsigned thread);
+
+        /**
+         * The main loop of each worker thread.
+         */
+        void workerLoop(unsigned thread);
+#endif
+
+        // Job systems own threads, so they can't be copied.
+        JobSystem(const JobSystem &);
+        JobSystem& operator=(const JobSystem &);
+
+    public:
+        /**
+         * Creates a job system with the given number of worker
+         * threads. If no count is given, one worker is created for
+         * each hardware thread besides the caller's. Without
+         * CYCLONE_THREADS the count is ignored.
+         */
+        JobSystem(unsigned workerCount = ~0u);
+
+        /**
+         * Stops and joins all the worker threads.
+         */
+        ~JobSystem();
+
+        /**
+         * Returns the number of threads that run tasks: the workers
+         * plus the calling thread.
+         */
+        unsigned getThreadCount() const;
+
+        /**
+         * Pins the given worker thread to the given processor core.
+         * Workers are numbered from zero. Returns false if the
+         * platform doesn't support it or the call fails.
+         */
+        bool setWorkerAffinity(unsigned worker, unsigned core);
+
+        /**
+         * Runs the task over the items from zero up to count, in
+         * batches of at most the given size, and returns when all
+         * of them are done.
+         */
+        void parallelFor(ParallelTask &task, unsigned count,
+                         unsigned batchSize = 64);
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_JOBS_H
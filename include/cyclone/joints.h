@@ -69,6 +69,16 @@ namespace cyclone {
          * has been violated.
          */
         unsigned addContact(Contact *contact, unsigned limit) const;
+
+        /**
+         * Returns the two bodies connected by the joint.
+         */
+        unsigned getBodyCount() const;
+
+        /**
+         * Returns one of the two bodies connected by the joint.
+         */
+        RigidBody* getBody(unsigned index) const;
     };
 
 } // namespace cyclone
@@ -151,8 +151,10 @@ namespace cyclone {
          * adds transient forces each frame, and integrates, prior to
          * rendering.
          *
-         * Currently the only integration function provided is the
-         * first order Newton Euler method.
+         * The integrate functions use the first order Newton Euler
+         * method. The predict function is the first half of a
+         * position-based step, as used by a ParticleWorld in its
+         * position-based mode.
          */
         /*@{*/
 
@@ -164,6 +166,35 @@ namespace cyclone {
          */
         void integrate(real duration);
 
+        /**
+         * Integrates the particle forward in time by the given
+         * amount, using a drag factor that has already been worked
+         * out for the duration, as held in a damping table. This
+         * gives exactly the same result as integrate(duration).
+         *
+         * @param duration The duration of the step.
+         *
+         * @param dampingFactor The damping raised to the power of
+         * the duration.
+         */
+        void integrate(real duration, real dampingFactor);
+
+        /**
+         * Moves the particle to where it would be at the end of the
+         * given duration if nothing constrained it. Unlike integrate,
+         * the velocity is updated from the forces first, and the new
+         * velocity moves the particle, so forces show up in the
+         * position straight away. Constraints can then move the
+         * particle directly, and the velocity is worked out again
+         * from where it ends up.
+         *
+         * @param duration The duration of the step.
+         *
+         * @param dampingFactor The damping raised to the power of
+         * the duration.
+         */
+        void predict(real duration, real dampingFactor);
+
         /*@}*/
 
 
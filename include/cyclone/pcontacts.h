@@ -24,6 +24,8 @@
 #ifndef CYCLONE_PCONTACTS_H
 #define CYCLONE_PCONTACTS_H
 
+#include <vector>
+#include <functional>
 #include "particle.h"
 
 namespace cyclone {
@@ -33,6 +35,7 @@ namespace cyclone {
      * documentation.
      */
     class ParticleContactResolver;
+    class JobSystem;
 
     /**
      * A Contact represents two objects in contact (in this case
@@ -95,6 +98,14 @@ namespace cyclone {
          */
         real calculateSeparatingVelocity() const;
 
+        /**
+         * Calculates the change in separating velocity needed to
+         * resolve this contact, given its current separating
+         * velocity, which should be closing or zero.
+         */
+        real calculateVelocityChange(real separatingVelocity,
+                                     real duration) const;
+
     private:
         /**
          * Handles the impulse calculations for this collision.
@@ -114,6 +125,47 @@ namespace cyclone {
      */
     class ParticleContactResolver
     {
+    public:
+        /**
+         * Describes how the resolver picks the next contact to
+         * resolve. SCAN and INDEXED resolve the same contacts in the
+         * same order, and so give the same result; they differ only
+         * in how quickly they find each contact.
+         */
+        enum Mode
+        {
+            /**
+             * Each iteration recalculates the separating velocity of
+             * every contact, and looks through all of them for the
+             * worst. This has the least set-up, so it is quickest for
+             * a handful of contacts.
+             */
+            SCAN,
+
+            /**
+             * The separating velocities are kept in a heap, and after
+             * each resolution only the contacts that share a particle
+             * with the resolved contact are updated. This is much
+             * quicker when there are many contacts that are each
+             * joined to only a few others, as in ropes and bridges.
+             */
+            INDEXED,
+
+            /**
+             * Every contact works out its correction at once, from
+             * the same starting state, and each particle then moves
+             * by the average of the corrections of the contacts it is
+             * in. This is repeated for a fixed number of passes,
+             * rather than for the number of iterations. Each pass can
+             * be split across the threads of a job system, and gives
+             * the same result however many threads there are. It
+             * converges more slowly than resolving one contact at a
+             * time, but suits large numbers of links, as in ropes and
+             * cloth.
+             */
+            JACOBI
+        };
+
     protected:
         /**
          * Holds the number of iterations allowed.
@@ -126,6 +178,179 @@ namespace cyclone {
          */
         unsigned iterationsUsed;
 
+        /**
+         * Holds how the next contact is picked.
+         */
+        Mode mode;
+
+        /**
+         * Holds one end of a contact, for finding the contacts that
+         * share a particle.
+         */
+        struct ContactEnd
+        {
+            Particle *particle;
+            unsigned contact;
+
+            bool operator<(const ContactEnd &other) const
+            {
+                if (particle != other.particle)
+                {
+                    return std::less<Particle*>()(particle, other.particle);
+                }
+                return contact < other.contact;
+            }
+        };
+
+        /**
+         * Holds the ends of all the contacts, grouped by particle.
+         */
+        std::vector<ContactEnd> ends;
+
+        /**
+         * Holds the index of the first end in each particle's group,
+         * with an extra entry for the end of the last group.
+         */
+        std::vector<unsigned> groupStarts;
+
+        /**
+         * Holds the group of each end of each contact, two per
+         * contact, or ~0 where the contact has no second particle.
+         */
+        std::vector<unsigned> contactGroups;
+
+        /**
+         * Holds the separating velocity of each contact.
+         */
+        std::vector<real> separatingVelocities;
+
+        /**
+         * Holds the contacts in heap order, worst first.
+         */
+        std::vector<unsigned> heap;
+
+        /**
+         * Holds the position of each contact in the heap.
+         */
+        std::vector<unsigned> heapPositions;
+
+        /**
+         * Holds the last iteration in which each contact was updated,
+         * so a contact sharing both particles is updated only once.
+         */
+        std::vector<unsigned> updateStamps;
+
+        /**
+         * Resolves the contacts, checking all of them each iteration.
+         */
+        void resolveScan(ParticleContact *contactArray,
+            unsigned numContacts, real duration);
+
+        /**
+         * Resolves the contacts, updating only those that share a
+         * particle with each resolved contact.
+         */
+        void resolveIndexed(ParticleContact *contactArray,
+            unsigned numContacts, real duration);
+
+        /**
+         * Groups the ends of the contacts by particle.
+         */
+        void buildGroups(ParticleContact *contactArray,
+            unsigned numContacts);
+
+        /**
+         * Returns true if the first contact should be resolved before
+         * the second.
+         */
+        bool isWorse(ParticleContact *contactArray,
+            unsigned one, unsigned two) const;
+
+        /**
+         * Moves the contact at the given heap position to where it
+         * belongs in the heap.
+         */
+        void updateHeap(ParticleContact *contactArray, unsigned position);
+
+        /**
+         * Moves the contact at the given heap position down past any
+         * children that should be resolved before it.
+         */
+        void siftDown(ParticleContact *contactArray, unsigned position);
+
+        /**
+         * Runs one stage of a Jacobi pass over a range of items.
+         */
+        class JacobiTask;
+
+        /**
+         * Holds the number of passes made in the Jacobi mode.
+         */
+        unsigned passes;
+
+        /**
+         * Holds the job system to run Jacobi passes on, or NULL.
+         */
+        JobSystem *jobs;
+
+        /**
+         * Holds the contacts and duration being resolved in the
+         * Jacobi mode, for the tasks to work on.
+         */
+        ParticleContact *jacobiContacts;
+        real jacobiDuration;
+
+        /**
+         * Holds the impulse per unit of inverse mass each contact
+         * wants to apply in this pass.
+         */
+        std::vector<Vector3> contactImpulses;
+
+        /**
+         * Holds the movement per unit of inverse mass each contact
+         * wants to make in this pass.
+         */
+        std::vector<Vector3> contactMoves;
+
+        /**
+         * Holds whether each contact needs resolving in this pass.
+         */
+        std::vector<unsigned char> contactActive;
+
+        /**
+         * Holds the movement given to each particle in this pass.
+         */
+        std::vector<Vector3> groupMoves;
+
+        /**
+         * Holds the number of contacts needing resolution found by
+         * each thread in this pass.
+         */
+        std::vector<unsigned> threadActive;
+
+        /**
+         * Resolves the contacts with a number of Jacobi passes.
+         */
+        void resolveJacobi(ParticleContact *contactArray,
+            unsigned numContacts, real duration);
+
+        /**
+         * Works out the correction each contact in the range wants.
+         */
+        void findCorrections(unsigned begin, unsigned end, unsigned thread);
+
+        /**
+         * Applies the averaged corrections to the particles in the
+         * range of groups.
+         */
+        void applyCorrections(unsigned begin, unsigned end);
+
+        /**
+         * Updates the penetrations of the range of contacts for the
+         * movement made in this pass.
+         */
+        void updatePenetrations(unsigned begin, unsigned end);
+
     public:
         /**
          * Creates a new contact resolver.
@@ -137,6 +362,29 @@ namespace cyclone {
          */
         void setIterations(unsigned iterations);
 
+        /**
+         * Sets how the resolver picks the next contact to resolve.
+         */
+        void setMode(Mode mode);
+
+        /**
+         * Gets how the resolver picks the next contact to resolve.
+         */
+        Mode getMode() const;
+
+        /**
+         * Sets the number of passes made in the Jacobi mode. Passes
+         * stop early once no contact needs resolving.
+         */
+        void setPasses(unsigned passes);
+
+        /**
+         * Sets the job system that passes in the Jacobi mode are
+         * split across, or NULL to run them on the calling thread.
+         * The other modes always run on the calling thread.
+         */
+        void setJobSystem(JobSystem *jobs);
+
         /**
          * Resolves a set of particle contacts for both penetration
          * and velocity.
@@ -169,6 +417,21 @@ namespace cyclone {
         void resolveContacts(ParticleContact *contactArray,
             unsigned numContacts,
             real duration);
+
+        /**
+         * Moves the particles of a set of contacts apart to remove
+         * their penetration, without changing any velocities. This
+         * makes one pass through the contacts in order, whatever the
+         * mode, and before each contact is resolved its penetration
+         * is brought up to date with the movement already made by
+         * its particles. The contacts themselves are left unchanged.
+         *
+         * This is the constraint projection step of position-based
+         * integration, where the contacts are generated again and
+         * projected several times each frame.
+         */
+        void projectPositions(ParticleContact *contactArray,
+            unsigned numContacts);
     };
 
     /**
@@ -37,6 +37,29 @@ namespace cyclone {
          * and update the force applied to the given particle.
          */
         virtual void updateForce(Particle *particle, real duration) = 0;
+
+        /**
+         * Updates the forces on a batch of particles. By default this
+         * calls updateForce for each one; generators that apply the
+         * same kind of force to many particles can overload it to do
+         * the whole batch in one loop. Implementations must only
+         * change the particles they are given, so that batches for
+         * different generators can be run in parallel.
+         */
+        virtual void updateForces(Particle * const *particles, unsigned count,
+                                  real duration);
+
+        /**
+         * Returns true if this generator's particles can be split
+         * into several batches, updated at the same time on
+         * different threads. That is only safe for generators that
+         * keep no working data between particles, so by default it
+         * is false.
+         */
+        virtual bool canSplit() const
+        {
+            return false;
+        }
     };
 
     /**
@@ -59,6 +82,16 @@ namespace cyclone {
         
 		/** Applies the gravitational force to the given particle. */
         virtual void updateForce(Particle *particle, real duration);
+
+        /** Applies the gravitational force to a batch of particles. */
+        virtual void updateForces(Particle * const *particles, unsigned count,
+                                  real duration);
+
+        /** Gravity keeps no working data, so can always be split. */
+        virtual bool canSplit() const
+        {
+            return true;
+        }
     };
 
     /**
@@ -80,6 +113,12 @@ namespace cyclone {
 
         /** Applies the drag force to the given particle. */
         virtual void updateForce(Particle *particle, real duration);
+
+        /** Drag keeps no working data, so can always be split. */
+        virtual bool canSplit() const
+        {
+            return true;
+        }
     };
 
     /**
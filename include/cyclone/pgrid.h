@@ -0,0 +1,122 @@
+/*
+ * Interface file for the particle neighbour grid.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a grid for finding the particles near a point,
+ * for force generators that act between nearby particles, such as
+ * cohesion or fluid forces.
+ */
+#ifndef CYCLONE_PGRID_H
+#define CYCLONE_PGRID_H
+
+#include <vector>
+#include "grid.h"
+#include "particle.h"
+#include "pset.h"
+
+namespace cyclone {
+
+    /**
+     * Holds a pair of particles found close together, by their
+     * indices.
+     */
+    typedef GridPair ParticlePair;
+
+    /**
+     * Sorts particles into a uniform grid by their positions, so the
+     * neighbours of a particle can be found by looking in only the
+     * cells around it. Without it, a force between every pair of
+     * nearby particles means checking every particle against every
+     * other; with it the cost grows with the number of neighbours
+     * instead. The sorting and searching is done by a HashGrid.
+     *
+     * Particles are identified by their index in the array or set
+     * the grid was built from. Queries are most efficient when the
+     * search radius is no more than the cell size.
+     */
+    class ParticleGrid
+    {
+        /**
+         * Holds the particles' positions, sorted into cells.
+         */
+        HashGrid grid;
+
+        /**
+         * Holds the particles the grid was built from, if it was
+         * built from an array of particles.
+         */
+        Particle * const *particles;
+
+    public:
+        /**
+         * Creates an empty grid with the given cell size.
+         */
+        ParticleGrid(real cellSize = 1);
+
+        /**
+         * Sets the length of the side of each cell. This takes
+         * effect the next time the grid is built.
+         */
+        void setCellSize(real size);
+
+        /**
+         * Gets the length of the side of each cell.
+         */
+        real getCellSize() const;
+
+        /**
+         * Sorts the given particles into the grid, replacing whatever
+         * it held before. The array must stay valid while the grid is
+         * in use.
+         */
+        void build(Particle * const *particles, unsigned count);
+
+        /**
+         * Sorts the particles of the given set into the grid,
+         * replacing whatever it held before.
+         */
+        void build(const ParticleSet &set);
+
+        /**
+         * Returns the number of particles in the grid.
+         */
+        unsigned getCount() const;
+
+        /**
+         * Returns the particle with the given index, if the grid was
+         * built from an array of particles, or NULL otherwise.
+         */
+        Particle* getParticle(unsigned index) const;
+
+        /**
+         * Finds the particles within the given radius of the given
+         * centre, and adds their indices to the end of the results.
+         * Returns the number of particles found.
+         */
+        unsigned findNeighbours(const Vector3 &centre, real radius,
+                                std::vector<unsigned> *results) const;
+
+        /**
+         * Finds every pair of particles within the given distance of
+         * each other, and adds them to the end of the pairs, each pair
+         * once. Returns the number of pairs found. The radius should
+         * be no more than the cell size.
+         */
+        unsigned findPairs(real radius,
+                           std::vector<ParticlePair> *pairs) const;
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_PGRID_H
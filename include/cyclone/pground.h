@@ -0,0 +1,208 @@
+/*
+ * Interface file for the ground that particles rest on.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a heightfield describing the shape of the
+ * ground, and a contact generator that keeps particles above it.
+ */
+#ifndef CYCLONE_PGROUND_H
+#define CYCLONE_PGROUND_H
+
+#include <vector>
+#include "pcontacts.h"
+#include "pset.h"
+
+namespace cyclone {
+
+    /**
+     * A heightfield gives the height of the ground at each point in
+     * the XZ plane, from a regular grid of samples, interpolating
+     * between them. Outside the grid the height of the nearest edge
+     * is used. Without any samples the ground is flat.
+     */
+    class Heightfield
+    {
+        /**
+         * Holds the samples, row by row along the Z axis, each row
+         * running along the X axis.
+         */
+        std::vector<real> samples;
+
+        /**
+         * Holds the number of samples along the X and Z axes.
+         */
+        unsigned columns, rows;
+
+        /**
+         * Holds the distance between neighbouring samples.
+         */
+        real spacing;
+
+        /**
+         * Holds the position of the first sample in the XZ plane.
+         */
+        real originX, originZ;
+
+        /**
+         * Holds the height of the ground when there are no samples.
+         */
+        real flatHeight;
+
+        /**
+         * Finds the cell holding the given point, and how far across
+         * the cell the point is. The point is clamped to the grid.
+         */
+        void findCell(real x, real z, unsigned *column, unsigned *row,
+                      real *fracX, real *fracZ) const;
+
+    public:
+        /**
+         * Creates flat ground at the given height.
+         */
+        Heightfield(real height = 0);
+
+        /**
+         * Makes the ground flat, at the given height.
+         */
+        void setFlat(real height);
+
+        /**
+         * Sets the shape of the ground from a grid of heights. The
+         * heights are given row by row along the Z axis, each row
+         * running along the X axis from the origin, so there should
+         * be columns times rows of them. Both counts must be at least
+         * two.
+         */
+        void setSamples(unsigned columns, unsigned rows, real spacing,
+                        real originX, real originZ, const real *heights);
+
+        /**
+         * Returns true if the ground is flat.
+         */
+        bool isFlat() const;
+
+        /**
+         * Returns the height of the ground at the given point.
+         */
+        real getHeight(real x, real z) const;
+
+        /**
+         * Works out the height of the ground at each of the given
+         * points, writing them to the heights array.
+         */
+        void getHeights(const real *x, const real *z, unsigned count,
+                        real *heights) const;
+
+        /**
+         * Returns the direction straight out of the ground at the
+         * given point.
+         */
+        Vector3 getNormal(real x, real z) const;
+    };
+
+    /**
+     * A contact generator that keeps a list of particles above the
+     * ground, where the ground can be any heightfield and each
+     * particle can have its own restitution.
+     *
+     * Rather than visiting the particles one at a time, the generator
+     * gathers their positions into arrays, finds the ground height
+     * under them all in one go, works out every depth in one
+     * vectorised loop, and then writes out a contact for each
+     * particle below the ground.
+     */
+    class ParticleGroundContacts : public ParticleContactGenerator
+    {
+        /**
+         * Holds the particles to keep above the ground.
+         */
+        std::vector<Particle*> *particles;
+
+        /**
+         * Holds the ground, or NULL for flat ground at zero height.
+         */
+        const Heightfield *ground;
+
+        /**
+         * Holds the restitution of each particle that has been given
+         * one.
+         */
+        std::vector<real> restitutions;
+
+        /**
+         * Holds the restitution of the particles that haven't been
+         * given one.
+         */
+        real defaultRestitution;
+
+        /**
+         * Hold the positions of the particles, as last gathered.
+         */
+        mutable AlignedArray<real> positionX;
+        mutable AlignedArray<real> positionY;
+        mutable AlignedArray<real> positionZ;
+
+        /**
+         * Holds the height of the ground under each particle, and
+         * then how far the particle is below it.
+         */
+        mutable AlignedArray<real> depths;
+
+    public:
+        /**
+         * Creates a generator for flat ground at zero height.
+         */
+        ParticleGroundContacts();
+
+        /**
+         * Sets the list of particles to keep above the ground.
+         */
+        void init(std::vector<Particle*> *particles);
+
+        /**
+         * Sets the ground, or NULL for flat ground at zero height.
+         * The heightfield must stay valid while the generator is in
+         * use.
+         */
+        void setGround(const Heightfield *ground);
+
+        /**
+         * Sets the restitution used for particles that haven't been
+         * given their own.
+         */
+        void setDefaultRestitution(real restitution);
+
+        /**
+         * Sets the restitution of the particle with the given index
+         * in the list.
+         */
+        void setRestitution(unsigned index, real restitution);
+
+        /**
+         * Gets the restitution of the particle with the given index
+         * in the list.
+         */
+        real getRestitution(unsigned index) const;
+
+        /**
+         * Fills the given contacts with those needed to keep the
+         * particles above the ground.
+         */
+        virtual unsigned addContact(ParticleContact *contact,
+                                    unsigned limit) const;
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_PGROUND_H
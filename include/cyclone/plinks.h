@@ -19,7 +19,9 @@
 #ifndef CYCLONE_PLINKS_H
 #define CYCLONE_PLINKS_H
 
+#include <vector>
 #include "pcontacts.h"
+#include "pset.h"
 
 namespace cyclone {
 
@@ -193,6 +195,184 @@ namespace cyclone {
         virtual unsigned addContact(ParticleContact *contact,
             unsigned limit) const;
     };
+
+    /**
+     * A link set holds any number of links between the particles of
+     * a list, as one contact generator. The links are stored as
+     * arrays of particle indices and lengths, rather than as an
+     * object each, and all their lengths are measured in one pass,
+     * so a structure made of thousands of links costs one virtual
+     * call per frame rather than thousands. It is used as a base
+     * class for sets of cables and sets of rods.
+     *
+     * Links refer to particles by their index in the list the set
+     * was initialised with, such as the particle world's list of
+     * particles.
+     */
+    class ParticleLinkSet : public ParticleContactGenerator
+    {
+    protected:
+        /**
+         * Holds the particles the links connect.
+         */
+        std::vector<Particle*> *particles;
+
+        /**
+         * Holds the index of the first particle of each link.
+         */
+        AlignedArray<unsigned> firsts;
+
+        /**
+         * Holds the index of the second particle of each link.
+         */
+        AlignedArray<unsigned> seconds;
+
+        /**
+         * Holds the length of each link.
+         */
+        AlignedArray<real> lengths;
+
+        /**
+         * Hold the separation of each link's particles, from the
+         * first to the second, as last measured.
+         */
+        mutable AlignedArray<real> separationX;
+        mutable AlignedArray<real> separationY;
+        mutable AlignedArray<real> separationZ;
+
+        /**
+         * Holds the current length of each link, as last measured.
+         */
+        mutable AlignedArray<real> currentLengths;
+
+        /**
+         * Adds a link and returns its index.
+         */
+        unsigned addLink(unsigned first, unsigned second, real length);
+
+        /**
+         * Measures the separation and current length of every link.
+         */
+        void measure() const;
+
+        /**
+         * Fills in the particles and normal of a contact for the
+         * given link, with the normal pointing from the first
+         * particle to the second.
+         */
+        void fillContact(ParticleContact *contact, unsigned index) const;
+
+    public:
+        /**
+         * Creates an empty set of links.
+         */
+        ParticleLinkSet();
+
+        /**
+         * Sets the list of particles that the links index into.
+         */
+        void init(std::vector<Particle*> *particles);
+
+        /**
+         * Returns the number of links in the set.
+         */
+        unsigned getCount() const;
+
+        /**
+         * Returns the particle at the first end of the given link.
+         */
+        Particle* getFirst(unsigned index) const;
+
+        /**
+         * Returns the particle at the second end of the given link.
+         */
+        Particle* getSecond(unsigned index) const;
+
+        /**
+         * Gets the length of the given link.
+         */
+        real getLength(unsigned index) const;
+
+        /**
+         * Sets the length of the given link.
+         */
+        void setLength(unsigned index, real length);
+
+        /**
+         * Removes the given link. The last link in the set takes its
+         * index.
+         */
+        virtual void remove(unsigned index);
+
+        /**
+         * Removes all the links.
+         */
+        virtual void clear();
+    };
+
+    /**
+     * A set of cables, each generating a contact if its particles
+     * stray too far apart. The length of each link is the maximum
+     * length of its cable.
+     */
+    class ParticleCableSet : public ParticleLinkSet
+    {
+        /**
+         * Holds the restitution (bounciness) of each cable.
+         */
+        AlignedArray<real> restitutions;
+
+    public:
+        /**
+         * Adds a cable between the particles with the given indices,
+         * and returns its index in the set.
+         */
+        unsigned add(unsigned first, unsigned second,
+                     real maxLength, real restitution);
+
+        /**
+         * Gets the restitution of the given cable.
+         */
+        real getRestitution(unsigned index) const;
+
+        /**
+         * Sets the restitution of the given cable.
+         */
+        void setRestitution(unsigned index, real restitution);
+
+        virtual void remove(unsigned index);
+
+        virtual void clear();
+
+        /**
+         * Fills the given contacts with those needed to keep the
+         * cables from over-extending.
+         */
+        virtual unsigned addContact(ParticleContact *contact,
+                                    unsigned limit) const;
+    };
+
+    /**
+     * A set of rods, each generating a contact if its particles
+     * stray too far apart or too close.
+     */
+    class ParticleRodSet : public ParticleLinkSet
+    {
+    public:
+        /**
+         * Adds a rod between the particles with the given indices,
+         * and returns its index in the set.
+         */
+        unsigned add(unsigned first, unsigned second, real length);
+
+        /**
+         * Fills the given contacts with those needed to keep the
+         * rods from extending or compressing.
+         */
+        virtual unsigned addContact(ParticleContact *contact,
+                                    unsigned limit) const;
+    };
+
 } // namespace cyclone
 
 #endif // CYCLONE_CONTACTS_H
\ No newline at end of file
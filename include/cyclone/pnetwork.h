@@ -0,0 +1,237 @@
+/*
+ * Interface file for implicitly integrated networks of springs.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a network of springs between particles, whose
+ * forces are worked out implicitly so that stiff networks stay stable
+ * at large time steps.
+ */
+#ifndef CYCLONE_PNETWORK_H
+#define CYCLONE_PNETWORK_H
+
+#include <vector>
+#include "particle.h"
+
+namespace cyclone {
+
+    /**
+     * A network of springs between the particles in a list, such as
+     * the springs of a piece of cloth or a soft body.
+     *
+     * Springs applied one at a time, as force generators, work out
+     * their force from where the particles are at the start of the
+     * step. Stiff springs then overshoot, and the step has to shrink
+     * as the stiffness grows. The network instead works out all its
+     * forces together, with a backward Euler step: the forces are
+     * those of the springs at the end of the step, linearised about
+     * the start of it. That needs a linear system to be solved, with
+     * a 3x3 block for each particle and for each spring, which is
+     * done with a preconditioned conjugate gradient solver. Each
+     * frame's solve starts from the last frame's solution, which is
+     * usually close, so a handful of iterations is enough. The cost
+     * of each frame is bounded by the maximum number of iterations.
+     *
+     * The network is not a force generator, as it needs all of its
+     * particles at once. Call updateForces once each frame, after the
+     * force accumulators have been cleared and before the particles
+     * are integrated; the forces it adds give each particle the
+     * velocity change of the implicit step. The step is only
+     * implicit if the particles are then moved with their new
+     * velocities, as Particle::predict does in the position-based
+     * mode of ParticleWorld. Particle::integrate moves them with
+     * their old velocities, and stiff networks will still blow up.
+     * Particles of infinite mass are held still by the solve, and
+     * can be used to pin the network in place.
+     */
+    class ParticleSpringNetwork
+    {
+        /**
+         * Holds one spring of the network.
+         */
+        struct Spring
+        {
+            /** Holds the indices of the particles at each end. */
+            unsigned first;
+            unsigned second;
+
+            /** Holds the stiffness of the spring. */
+            real springConstant;
+
+            /** Holds the length at which the spring has no force. */
+            real restLength;
+
+            /**
+             * Holds the damping of the spring, against the speed at
+             * which its ends move apart.
+             */
+            real damping;
+
+            /**
+             * True if the spring only pulls, like a bungee, and has
+             * no force when it is shorter than its rest length.
+             */
+            bool pullOnly;
+        };
+
+        /**
+         * Holds the particles the springs join.
+         */
+        std::vector<Particle*> *particles;
+
+        /**
+         * Holds the springs.
+         */
+        std::vector<Spring> springs;
+
+        /**
+         * Holds the most conjugate gradient iterations per frame.
+         */
+        unsigned iterations;
+
+        /**
+         * Holds the number of iterations used in the last frame.
+         */
+        unsigned iterationsUsed;
+
+        /**
+         * Holds the residual, relative to the right hand side, at
+         * which the solve stops early.
+         */
+        real tolerance;
+
+        /**
+         * Holds the block each spring adds to the system, for the
+         * step being solved.
+         */
+        std::vector<Matrix3> springBlocks;
+
+        /**
+         * Holds the inverse of each particle's diagonal block, used
+         * to precondition the solve.
+         */
+        std::vector<Matrix3> preconditioner;
+
+        /**
+         * Holds the mass of each particle, or zero for those that
+         * are held still.
+         */
+        std::vector<real> masses;
+
+        /**
+         * Holds the velocity change of each particle, kept between
+         * frames to start the next solve from.
+         */
+        std::vector<Vector3> solution;
+
+        /**
+         * Holds the right hand side, and the working vectors of the
+         * conjugate gradient solver.
+         */
+        std::vector<Vector3> rhs;
+        std::vector<Vector3> residual;
+        std::vector<Vector3> preconditioned;
+        std::vector<Vector3> direction;
+        std::vector<Vector3> product;
+
+        /**
+         * Works out the spring forces and blocks for the current
+         * state of the particles, and fills the right hand side and
+         * the preconditioner.
+         */
+        void buildSystem(real duration);
+
+        /**
+         * Multiplies the given vector by the system matrix, leaving
+         * out the rows of particles that are held still.
+         */
+        void multiply(const Vector3 *vector, Vector3 *result) const;
+
+        /**
+         * Solves the system, starting from the current solution.
+         */
+        void solve();
+
+    public:
+        /**
+         * Creates an empty network.
+         */
+        ParticleSpringNetwork();
+
+        /**
+         * Sets the list of particles the springs refer to, by index.
+         */
+        void init(std::vector<Particle*> *particles);
+
+        /**
+         * Adds a spring between the particles with the given indices,
+         * and returns its index.
+         */
+        unsigned addSpring(unsigned first, unsigned second,
+                           real springConstant, real restLength,
+                           real damping = 0);
+
+        /**
+         * Adds a spring between the particles with the given indices
+         * that only pulls them together, as a ParticleBungee does,
+         * and returns its index.
+         */
+        unsigned addBungee(unsigned first, unsigned second,
+                           real springConstant, real restLength,
+                           real damping = 0);
+
+        /**
+         * Returns the number of springs.
+         */
+        unsigned getSpringCount() const;
+
+        /**
+         * Removes all the springs, and forgets the last solution.
+         */
+        void clear();
+
+        /**
+         * Sets the most conjugate gradient iterations made each
+         * frame. This bounds the cost of the solve: with too few the
+         * forces are less accurate, and the network is softer than
+         * it should be, but stays stable.
+         */
+        void setIterations(unsigned iterations);
+
+        /**
+         * Gets the most conjugate gradient iterations made each
+         * frame.
+         */
+        unsigned getIterations() const;
+
+        /**
+         * Returns the number of iterations used in the last frame.
+         */
+        unsigned getIterationsUsed() const;
+
+        /**
+         * Sets the residual, relative to the size of the right hand
+         * side, at which the solve is close enough and stops early.
+         */
+        void setTolerance(real tolerance);
+
+        /**
+         * Works out the forces of all the springs for a step of the
+         * given duration, and adds them to the particles.
+         */
+        void updateForces(real duration);
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_PNETWORK_H
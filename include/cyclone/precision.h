@@ -63,6 +63,12 @@ namespace cyclone {
 
     /** Defines the precision of the floating point modulo operator. */
     #define real_fmod fmodf
+
+    /** Defines the precision of the floor operator. */
+    #define real_floor floorf
+
+    /** Defines the precision of the ceiling operator. */
+    #define real_ceil ceilf
     
     /** Defines the number e on which 1+e == 1 **/
     #define real_epsilon FLT_EPSILON
@@ -79,6 +85,8 @@ namespace cyclone {
     #define real_exp exp
     #define real_pow pow
     #define real_fmod fmod
+    #define real_floor floor
+    #define real_ceil ceil
     #define real_epsilon DBL_EPSILON
     #define R_PI 3.14159265358979
 #endif
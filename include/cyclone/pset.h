@@ -0,0 +1,464 @@
+/*
+ * Interface file for the structure-of-arrays particle set.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a container for very large numbers of
+ * particles. Rather than one object per particle, it keeps each
+ * property of all the particles in its own contiguous array, so the
+ * particles can be integrated in loops the compiler can vectorise.
+ */
+#ifndef CYCLONE_PSET_H
+#define CYCLONE_PSET_H
+
+#include <cstddef>
+#include "particle.h"
+
+/**
+ * Marks a pointer as the only way its data is reached in a loop, so
+ * the compiler can vectorise loops over several arrays without
+ * checking whether they overlap. The arrays given to a function
+ * taking such pointers must never overlap one another.
+ */
+#define CYCLONE_RESTRICT __restrict
+
+namespace cyclone {
+
+    /**
+     * Holds a growable array of plain values, with its storage
+     * aligned for the widest vector instructions, so loops over it
+     * can use aligned loads and stores. Its capacity is always a
+     * whole number of vectors.
+     */
+    template<class T>
+    class AlignedArray
+    {
+    public:
+        /** The alignment of the storage, in bytes. */
+        enum { ALIGNMENT = 32 };
+
+    private:
+        /** Holds the storage as it was allocated. */
+        char *buffer;
+
+        /** Holds the aligned start of the storage. */
+        T *items;
+
+        /** Holds the number of values in use. */
+        unsigned count;
+
+        /** Holds the number of values there is room for. */
+        unsigned capacity;
+
+        // Arrays own their storage, so they can't be copied.
+        AlignedArray(const AlignedArray &);
+        AlignedArray& operator=(const AlignedArray &);
+
+    public:
+        AlignedArray() : buffer(0), items(0), count(0), capacity(0) {}
+
+        ~AlignedArray()
+        {
+            delete [] buffer;
+        }
+
+        /**
+         * Makes room for at least the given number of values,
+         * keeping the ones already held.
+         */
+        void reserve(unsigned size)
+        {
+            if (size <= capacity) return;
+
+            // Round up to a whole number of vectors.
+            const unsigned lanes = ALIGNMENT / sizeof(T);
+            unsigned newCapacity = capacity ? capacity * 2 : lanes;
+            while (newCapacity < size) newCapacity *= 2;
+            newCapacity = (newCapacity + lanes - 1) / lanes * lanes;
+
+            char *newBuffer = new char[newCapacity * sizeof(T) + ALIGNMENT];
+            size_t offset = (size_t)newBuffer % ALIGNMENT;
+            T *newItems = (T*)(newBuffer + (offset ? ALIGNMENT - offset : 0));
+            for (unsigned i = 0; i < count; i++) newItems[i] = items[i];
+
+            delete [] buffer;
+            buffer = newBuffer;
+            items = newItems;
+            capacity = newCapacity;
+        }
+
+        /**
+         * Sets the number of values, filling any new ones with the
+         * given value.
+         */
+        void resize(unsigned size, const T &value = T())
+        {
+            reserve(size);
+            for (unsigned i = count; i < size; i++) items[i] = value;
+            count = size;
+        }
+
+        /** Adds a value to the end. */
+        void push_back(const T &value)
+        {
+            if (count == capacity) reserve(count + 1);
+            items[count++] = value;
+        }
+
+        /** Removes the last value. */
+        void pop_back()
+        {
+            count--;
+        }
+
+        /**
+         * Removes the values at the given indices, which must be in
+         * increasing order, moving values from the end into the gaps.
+         * Working from the last index back means a value moved into a
+         * gap is never one that is also being removed.
+         */
+        void removeSorted(const unsigned *indices, unsigned removeCount)
+        {
+            for (unsigned i = removeCount; i-- > 0; )
+            {
+                items[indices[i]] = items[--count];
+            }
+        }
+
+        /** Removes all the values, keeping the storage. */
+        void clear()
+        {
+            count = 0;
+        }
+
+        /** Returns the number of values. */
+        unsigned size() const
+        {
+            return count;
+        }
+
+        /** Returns the aligned storage. */
+        T* data()
+        {
+            return items;
+        }
+
+        /** Returns the aligned storage. */
+        const T* data() const
+        {
+            return items;
+        }
+
+        T& operator[](unsigned index)
+        {
+            return items[index];
+        }
+
+        const T& operator[](unsigned index) const
+        {
+            return items[index];
+        }
+    };
+
+    class ParticleSet;
+
+    /**
+     * Refers to one particle in a particle set, and gives it the
+     * same interface as a Particle. A reference stays valid until the
+     * set is changed by adding or removing particles.
+     */
+    class ParticleRef
+    {
+        /** Holds the set the particle belongs to. */
+        ParticleSet *set;
+
+        /** Holds the index of the particle in the set. */
+        unsigned index;
+
+    public:
+        /** Creates a reference to the given particle in a set. */
+        ParticleRef(ParticleSet *set, unsigned index)
+            : set(set), index(index) {}
+
+        /** Returns the index of the particle in its set. */
+        unsigned getIndex() const
+        {
+            return index;
+        }
+
+        /**
+         * Sets the mass of the particle. The mass may not be zero.
+         */
+        void setMass(const real mass);
+
+        /**
+         * Gets the mass of the particle.
+         */
+        real getMass() const;
+
+        /**
+         * Sets the inverse mass of the particle. Zero gives an
+         * immovable particle.
+         */
+        void setInverseMass(const real inverseMass);
+
+        /**
+         * Gets the inverse mass of the particle.
+         */
+        real getInverseMass() const;
+
+        /**
+         * Returns true if the mass of the particle is not-infinite.
+         */
+        bool hasFiniteMass() const;
+
+        /**
+         * Sets the damping of the particle.
+         */
+        void setDamping(const real damping);
+
+        /**
+         * Gets the damping of the particle.
+         */
+        real getDamping() const;
+
+        /**
+         * Sets the position of the particle.
+         */
+        void setPosition(const Vector3 &position);
+
+        /**
+         * Sets the position of the particle by component.
+         */
+        void setPosition(const real x, const real y, const real z);
+
+        /**
+         * Gets the position of the particle.
+         */
+        Vector3 getPosition() const;
+
+        /**
+         * Sets the velocity of the particle.
+         */
+        void setVelocity(const Vector3 &velocity);
+
+        /**
+         * Sets the velocity of the particle by component.
+         */
+        void setVelocity(const real x, const real y, const real z);
+
+        /**
+         * Gets the velocity of the particle.
+         */
+        Vector3 getVelocity() const;
+
+        /**
+         * Sets the constant acceleration of the particle.
+         */
+        void setAcceleration(const Vector3 &acceleration);
+
+        /**
+         * Sets the constant acceleration of the particle by
+         * component.
+         */
+        void setAcceleration(const real x, const real y, const real z);
+
+        /**
+         * Gets the acceleration of the particle.
+         */
+        Vector3 getAcceleration() const;
+
+        /**
+         * Clears the forces applied to the particle.
+         */
+        void clearAccumulator();
+
+        /**
+         * Adds the given force to the particle, to be applied at the
+         * next integration only.
+         */
+        void addForce(const Vector3 &force);
+    };
+
+    /**
+     * Holds a set of particles as a structure of arrays: each
+     * property of the particles is stored in its own contiguous,
+     * aligned array. Integrating the whole set is then a few simple
+     * loops that the compiler can turn into vector instructions, with
+     * no pointer chasing and no virtual calls, which is what makes
+     * millions of particles per frame affordable.
+     *
+     * The particles behave exactly like Particle objects, and
+     * integrate to the same results. Each one can be reached through
+     * a ParticleRef, which has the same interface as Particle, and
+     * particles can be copied to and from Particle objects. The raw
+     * arrays are also available, for code that processes the whole
+     * set at once.
+     *
+     * Removing a particle moves the last particle into its place, so
+     * indices are not stable across removals.
+     */
+    class ParticleSet
+    {
+    public:
+        /**
+         * Identifies the arrays that make up the set.
+         */
+        enum Array
+        {
+            POSITION_X, POSITION_Y, POSITION_Z,
+            VELOCITY_X, VELOCITY_Y, VELOCITY_Z,
+            ACCELERATION_X, ACCELERATION_Y, ACCELERATION_Z,
+            FORCE_X, FORCE_Y, FORCE_Z,
+            INVERSE_MASS,
+            DAMPING,
+            ARRAY_COUNT
+        };
+
+    private:
+        /**
+         * Holds the arrays of particle properties.
+         */
+        AlignedArray<real> arrays[ARRAY_COUNT];
+
+        /**
+         * Holds each particle's damping raised to the power of the
+         * last integration duration, so the power only has to be
+         * worked out again when the duration or damping changes.
+         */
+        AlignedArray<real> dampingFactors;
+
+        /**
+         * Holds one for each particle that moves, and zero for each
+         * one of infinite mass, during integration.
+         */
+        AlignedArray<real> movingMasks;
+
+        /**
+         * Holds the duration the damping factors were worked out
+         * for, or zero if they haven't been.
+         */
+        real factorDuration;
+
+        // Sets can be very large, so they can't be copied by
+        // accident.
+        ParticleSet(const ParticleSet &);
+        ParticleSet& operator=(const ParticleSet &);
+
+    public:
+        /**
+         * Creates an empty set.
+         */
+        ParticleSet();
+
+        /**
+         * Makes room for the given number of particles.
+         */
+        void reserve(unsigned count);
+
+        /**
+         * Adds a particle at rest at the origin, with the given mass
+         * and damping, and returns its index.
+         */
+        unsigned add(real mass = 1, real damping = (real)0.99);
+
+        /**
+         * Adds the given number of particles at rest at the origin,
+         * all with the given mass and damping, and returns the index
+         * of the first. This is much quicker than adding them one at
+         * a time.
+         */
+        unsigned addBlock(unsigned count, real mass = 1,
+                          real damping = (real)0.99);
+
+        /**
+         * Adds a copy of the given particle, without any forces
+         * applied to it, and returns its index.
+         */
+        unsigned add(const Particle &particle);
+
+        /**
+         * Removes the particle with the given index, moving the last
+         * particle into its place.
+         */
+        void remove(unsigned index);
+
+        /**
+         * Removes the particles with the given indices, which must be
+         * in increasing order, moving particles from the end into
+         * their places. This does each array in turn, so it is much
+         * quicker than removing the particles one at a time.
+         */
+        void removeSorted(const unsigned *indices, unsigned count);
+
+        /**
+         * Removes all the particles.
+         */
+        void clear();
+
+        /**
+         * Returns the number of particles.
+         */
+        unsigned size() const;
+
+        /**
+         * Returns a reference to the particle with the given index.
+         */
+        ParticleRef operator[](unsigned index);
+
+        /**
+         * Copies the particle with the given index into the given
+         * Particle, apart from the forces applied to it.
+         */
+        void get(unsigned index, Particle *particle) const;
+
+        /**
+         * Copies the given Particle into the particle with the given
+         * index, apart from the forces applied to it.
+         */
+        void set(unsigned index, const Particle &particle);
+
+        /**
+         * Returns one of the arrays of particle properties, holding
+         * size() values. Writing a particle's damping through this
+         * array bypasses the cached damping factors, so use setDamping
+         * for that.
+         */
+        real* getArray(Array array);
+
+        /**
+         * Returns one of the arrays of particle properties.
+         */
+        const real* getArray(Array array) const;
+
+        /**
+         * Sets the damping of the particle with the given index.
+         */
+        void setDamping(unsigned index, real damping);
+
+        /**
+         * Clears the forces applied to all the particles.
+         */
+        void clearAccumulators();
+
+        /**
+         * Integrates all the particles forward in time by the given
+         * duration. This gives the same results as calling
+         * Particle::integrate on each of them.
+         */
+        void integrateAll(real duration);
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_PSET_H
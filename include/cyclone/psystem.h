@@ -0,0 +1,329 @@
+/*
+ * Interface file for particle systems.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a particle system: a pool of short-lived
+ * particles created by emitters, that can burst into more particles
+ * when they die, as fireworks do.
+ */
+#ifndef CYCLONE_PSYSTEM_H
+#define CYCLONE_PSYSTEM_H
+
+#include <vector>
+#include "pset.h"
+#include "random.h"
+
+namespace cyclone {
+
+    /**
+     * A particle rule controls how long particles of one type live,
+     * how they start moving, and the particles they burst into when
+     * they die.
+     */
+    struct ParticleRule
+    {
+        /**
+         * A payload is a number of particles of one type, created
+         * where a particle dies.
+         */
+        struct Payload
+        {
+            /** The type of the new particles. */
+            unsigned type;
+
+            /** The number of new particles. */
+            unsigned count;
+        };
+
+        /** The shortest life of a particle of this type. */
+        real minAge;
+
+        /** The longest life of a particle of this type. */
+        real maxAge;
+
+        /**
+         * The smallest velocity of a new particle, relative to the
+         * velocity it was created with.
+         */
+        Vector3 minVelocity;
+
+        /**
+         * The largest velocity of a new particle, relative to the
+         * velocity it was created with.
+         */
+        Vector3 maxVelocity;
+
+        /** The damping of particles of this type. */
+        real damping;
+
+        /** The mass of particles of this type. */
+        real mass;
+
+        /** The constant acceleration of particles of this type. */
+        Vector3 acceleration;
+
+        /** The particles created when one of this type dies. */
+        std::vector<Payload> payloads;
+
+        /**
+         * Creates a rule for particles of unit mass that live for one
+         * second, start still, and fall under gravity.
+         */
+        ParticleRule();
+
+        /**
+         * Sets the life, starting velocity and damping in one go.
+         */
+        void setParameters(real minAge, real maxAge,
+                           const Vector3 &minVelocity,
+                           const Vector3 &maxVelocity,
+                           real damping);
+
+        /**
+         * Adds a payload of the given number of particles of the
+         * given type.
+         */
+        void addPayload(unsigned type, unsigned count);
+    };
+
+    /**
+     * An emitter creates particles of one type at a steady rate.
+     */
+    struct ParticleEmitter
+    {
+        /** The type of particle to create. */
+        unsigned type;
+
+        /** Where to create the particles. */
+        Vector3 position;
+
+        /**
+         * The velocity the particles are created with, before the
+         * random velocity from their rule is added.
+         */
+        Vector3 velocity;
+
+        /** The number of particles to create each second. */
+        real rate;
+
+        /** Holds the part of a particle still waiting to be created. */
+        real pending;
+
+        /**
+         * Creates an emitter that emits nothing.
+         */
+        ParticleEmitter();
+    };
+
+    /**
+     * A particle system holds a pool of particles that each live for
+     * a limited time. Particles are created by emitters, directly by
+     * calling spawn, or as the payloads of particles that die.
+     *
+     * The particles are held in a particle set, with their age and
+     * type in arrays alongside, so updating them walks straight
+     * through memory. Room for the whole pool is made up front, so
+     * creating and destroying particles never allocates; once the
+     * pool is full, new particles are dropped. Dead particles are
+     * removed by moving the last particle into their place, so the
+     * live particles are always the first ones in the set, but their
+     * order changes.
+     */
+    class ParticleSystem
+    {
+        /**
+         * Holds the particles.
+         */
+        ParticleSet particles;
+
+        /**
+         * Holds the time each particle has left to live.
+         */
+        AlignedArray<real> ages;
+
+        /**
+         * Holds the type of each particle.
+         */
+        AlignedArray<unsigned> types;
+
+        /**
+         * Holds the rule for each type of particle.
+         */
+        std::vector<ParticleRule> rules;
+
+        /**
+         * Holds the rule used for types that haven't been given one.
+         */
+        ParticleRule defaultRule;
+
+        /**
+         * Holds the emitters.
+         */
+        std::vector<ParticleEmitter> emitters;
+
+        /**
+         * Holds the indices of the particles that died in this update.
+         */
+        std::vector<unsigned> dead;
+
+        /**
+         * Holds where a particle that died in this update was, and
+         * how it was moving, so its payloads can be created once it
+         * has been removed.
+         */
+        struct Burst
+        {
+            unsigned type;
+            Vector3 position;
+            Vector3 velocity;
+        };
+
+        /**
+         * Holds the particles with payloads that died in this update.
+         */
+        std::vector<Burst> bursts;
+
+        /**
+         * Holds the most particles the system can hold.
+         */
+        unsigned capacity;
+
+        /**
+         * Holds the height below which particles die.
+         */
+        real killHeight;
+
+        /**
+         * Holds the random number source for new particles.
+         */
+        Random random;
+
+        /**
+         * Returns the rule for the given type, without adding one.
+         */
+        const ParticleRule& findRule(unsigned type) const;
+
+        // Systems hold a particle set, which can't be copied.
+        ParticleSystem(const ParticleSystem &);
+        ParticleSystem& operator=(const ParticleSystem &);
+
+    public:
+        /**
+         * Creates a system that can hold up to the given number of
+         * particles.
+         */
+        ParticleSystem(unsigned capacity);
+
+        /**
+         * Returns the most particles the system can hold.
+         */
+        unsigned getCapacity() const;
+
+        /**
+         * Sets the rule for particles of the given type.
+         */
+        void setRule(unsigned type, const ParticleRule &rule);
+
+        /**
+         * Returns the rule for particles of the given type. Types
+         * without a rule of their own use the default rule.
+         */
+        ParticleRule& getRule(unsigned type);
+
+        /**
+         * Adds an emitter and returns its index.
+         */
+        unsigned addEmitter(const ParticleEmitter &emitter);
+
+        /**
+         * Returns the emitter with the given index.
+         */
+        ParticleEmitter& getEmitter(unsigned index);
+
+        /**
+         * Returns the number of emitters.
+         */
+        unsigned getEmitterCount() const;
+
+        /**
+         * Removes all the emitters.
+         */
+        void clearEmitters();
+
+        /**
+         * Sets the height below which particles die, as if they had
+         * reached the end of their life. By default there is none.
+         */
+        void setKillHeight(real height);
+
+        /**
+         * Sets the seed of the random numbers used for new particles.
+         */
+        void setSeed(unsigned seed);
+
+        /**
+         * Creates the given number of particles of the given type, at
+         * the given position. Each moves at the given velocity plus a
+         * random velocity from its rule. Returns the number created,
+         * which is less than asked for if the pool fills up.
+         */
+        unsigned spawn(unsigned type, unsigned count,
+                       const Vector3 &position,
+                       const Vector3 &velocity = Vector3());
+
+        /**
+         * Moves the system on by the given duration. Emitters create
+         * their particles, all the particles are integrated using the
+         * forces applied to them since the last update, then those
+         * forces are cleared. Particles that have come to the end of
+         * their life create their payloads and are removed.
+         */
+        void update(real duration);
+
+        /**
+         * Removes all the particles.
+         */
+        void clear();
+
+        /**
+         * Returns the number of live particles.
+         */
+        unsigned size() const;
+
+        /**
+         * Returns the particles, for applying forces and drawing.
+         * Particles shouldn't be added or removed through the set.
+         */
+        ParticleSet& getParticles();
+
+        /**
+         * Returns the particles.
+         */
+        const ParticleSet& getParticles() const;
+
+        /**
+         * Returns the type of the particle with the given index.
+         */
+        unsigned getType(unsigned index) const;
+
+        /**
+         * Returns the time the particle with the given index has left
+         * to live.
+         */
+        real getAge(unsigned index) const;
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_PSYSTEM_H
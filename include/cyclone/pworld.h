@@ -21,6 +21,10 @@
 
 #include "pfgen.h"
 #include "plinks.h"
+#include "damping.h"
+#include "pgrid.h"
+#include "fbatch.h"
+#include "jobs.h"
 
 namespace cyclone {
 
@@ -34,6 +38,36 @@ namespace cyclone {
         typedef std::vector<Particle*> Particles;
         typedef std::vector<ParticleContactGenerator*> ContactGenerators;
 
+        /**
+         * The ways the world can move its particles on each frame.
+         */
+        enum IntegrationMode
+        {
+            /**
+             * Each particle is integrated with its forces, then the
+             * contacts are found and resolved with impulses, and by
+             * moving the particles apart. This is the default.
+             */
+            EULER,
+
+            /**
+             * Each particle is first moved as if nothing constrained
+             * it, then the contacts are found and the particles moved
+             * directly to satisfy them, a number of times over. The
+             * velocities are then worked out from how far the
+             * particles actually moved, in the manner of Verlet
+             * integration.
+             *
+             * Links here behave as infinitely stiff springs that
+             * can't overshoot, so ropes and cloth built from rods and
+             * cables stay stable at ordinary frame rates where stiff
+             * spring forces would need many small steps. Restitution
+             * is ignored: particles come to rest against whatever
+             * they hit.
+             */
+            POSITION_BASED
+        };
+
     protected:
         /**
          * Holds the particles
@@ -51,6 +85,12 @@ namespace cyclone {
          */
         ParticleForceRegistry registry;
 
+        /**
+         * Holds the force generators that are run in batches, and can
+         * be spread across the threads of the job system.
+         */
+        BatchedParticleForceRegistry batchedRegistry;
+
         /**
          * Holds the resolver for contacts.
          */
@@ -72,6 +112,124 @@ namespace cyclone {
          */
         unsigned maxContacts;
 
+        /**
+         * Holds the drag factors for the current step.
+         */
+        DampingTable dampingTable;
+
+        /**
+         * Holds each particle's hint into the damping table.
+         */
+        std::vector<unsigned> dampingHints;
+
+        /**
+         * Holds the grid of particle positions, for force generators
+         * that need to find nearby particles.
+         */
+        ParticleGrid grid;
+
+        /**
+         * True if the grid should be rebuilt at each frame.
+         */
+        bool gridEnabled;
+
+        /**
+         * Holds how the particles are moved on each frame.
+         */
+        IntegrationMode integrationMode;
+
+        /**
+         * Holds the number of times contacts are found and projected
+         * on each frame of position-based integration.
+         */
+        unsigned positionIterations;
+
+        /**
+         * Holds the position of each particle at the start of the
+         * frame, during position-based integration.
+         */
+        std::vector<Vector3> previousPositions;
+
+        /**
+         * Works out the drag factor for each particle for the given
+         * duration.
+         */
+        void prepareDamping(real duration);
+
+        /**
+         * Moves all the particles as if they were unconstrained, for
+         * position-based integration, keeping their previous
+         * positions.
+         */
+        void predict(real duration);
+
+        /**
+         * Sets each particle's velocity from how far it has moved
+         * since it was predicted.
+         */
+        void updateVelocities(real duration);
+
+        /**
+         * Runs a frame of position-based integration, once the
+         * forces have been applied.
+         */
+        void runPositionBased(real duration);
+
+        /**
+         * Holds the contacts reported by the generators run on one
+         * thread, when generating in parallel.
+         */
+        struct ThreadContacts
+        {
+            /** Holds the contacts, and room for more. */
+            std::vector<ParticleContact> contacts;
+
+            /** Holds the number of contacts in use. */
+            unsigned used;
+        };
+
+        /**
+         * Runs contact generators on the threads of the job system.
+         */
+        class GenerateTask;
+
+        /**
+         * Holds the job system used to run the simulation across
+         * several threads, or NULL to run it on the calling thread.
+         */
+        JobSystem *jobs;
+
+        /**
+         * Holds the contacts for each thread of the job system, so
+         * generators running at the same time don't share any.
+         */
+        std::vector<ThreadContacts*> threadContacts;
+
+        /**
+         * Holds the thread each generator ran on this frame, when
+         * generating in parallel.
+         */
+        std::vector<unsigned> generatorThreads;
+
+        /**
+         * Holds the index of the first contact each generator
+         * reported this frame in its thread's contacts.
+         */
+        std::vector<unsigned> generatorStarts;
+
+        /**
+         * Holds the number of contacts each generator reported this
+         * frame, when generating in parallel.
+         */
+        std::vector<unsigned> generatorCounts;
+
+        /**
+         * Runs the contact generators in parallel and gathers their
+         * contacts, in generator order. Returns the number of
+         * contacts.
+         */
+        unsigned generateContactsParallel();
+
     public:
 
         /**
@@ -88,6 +246,29 @@ namespace cyclone {
          */
         ~ParticleWorld();
 
+        /**
+         * Sets the job system used to run the simulation, or NULL
+         * (the default) to run it all on the calling thread. The
+         * world does not take ownership of the job system.
+         *
+         * With a job system, the particles are split into chunks
+         * that have their forces cleared and are integrated in
+         * parallel. Force generators in the batched force registry
+         * that share no particles run at the same time, and those
+         * that can be split are given their particles in chunks; the
+         * plain force registry is run on the calling thread. Contact
+         * generators are run in
+         * parallel, each into the contacts of the thread it runs on,
+         * so they must not share any state they modify. Their
+         * contacts are then gathered in generator order, and the
+         * resolver uses the job system in its Jacobi mode.
+         *
+         * None of this changes the order in which anything is added
+         * up, so the results are exactly the same as running without
+         * a job system, whatever the number of threads.
+         */
+        void setJobSystem(JobSystem *jobs);
+
         /**
          * Calls each of the registered contact generators to report
          * their contacts. Returns the number of generated contacts.
@@ -127,6 +308,66 @@ namespace cyclone {
          * Returns the force registry.
          */
         ParticleForceRegistry& getForceRegistry();
+
+        /**
+         * Returns the batched force registry. Its generators are run
+         * after those of the force registry, each once with all of
+         * its particles, and the work is spread across the threads
+         * of the job system if there is one. Each particle's forces
+         * are added in the order its generators were first added to
+         * this registry, rather than the order of registration.
+         */
+        BatchedParticleForceRegistry& getBatchedForceRegistry();
+
+        /**
+         * Returns the contact resolver, so its mode can be changed.
+         */
+        ParticleContactResolver& getContactResolver();
+
+        /**
+         * Sets how the particles are moved on each frame.
+         */
+        void setIntegrationMode(IntegrationMode mode);
+
+        /**
+         * Gets how the particles are moved on each frame.
+         */
+        IntegrationMode getIntegrationMode() const;
+
+        /**
+         * Sets the number of times contacts are found and projected
+         * on each frame of position-based integration. More
+         * iterations give stiffer links, at the cost of running
+         * the contact generators more often. The default is four.
+         */
+        void setPositionIterations(unsigned iterations);
+
+        /**
+         * Gets the number of times contacts are found and projected
+         * on each frame of position-based integration.
+         */
+        unsigned getPositionIterations() const;
+
+        /**
+         * Turns on the neighbour grid, with the given cell size. Once
+         * on, the grid is rebuilt from the particles at the start of
+         * each frame's physics, before the force generators run, so
+         * generators can use it to find the particles near each
+         * other. Particle indices in the grid are positions in the
+         * list of particles.
+         */
+        void enableNeighbourGrid(real cellSize);
+
+        /**
+         * Turns off the neighbour grid.
+         */
+        void disableNeighbourGrid();
+
+        /**
+         * Returns the neighbour grid, as built at the start of the
+         * last frame's physics.
+         */
+        const ParticleGrid& getNeighbourGrid() const;
     };
 
     /**
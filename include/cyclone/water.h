@@ -0,0 +1,318 @@
+/*
+ * Interface file for the water surface and the generators that float
+ * objects on it.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a moving water surface made of a sum of
+ * Gerstner waves, and buoyancy force generators that float rigid
+ * bodies and particles on it.
+ */
+#ifndef CYCLONE_WATER_H
+#define CYCLONE_WATER_H
+
+#include <vector>
+#include "fgen.h"
+#include "pfgen.h"
+
+namespace cyclone {
+
+    /**
+     * A water surface made of a sum of Gerstner waves, moving with
+     * time. Gerstner waves move the water sideways as well as up and
+     * down, giving sharper crests and flatter troughs than plain
+     * sine waves.
+     *
+     * Working out the height at a point means summing every wave
+     * several times, so the surface can keep a cache: a square tile
+     * of heights that is worked out once each update, and repeats
+     * across the whole plane. Heights are then looked up from the
+     * tile, so floating objects cost the same however many waves
+     * there are. For the tile to repeat seamlessly, the waves are
+     * adjusted so that a whole number of each fits across it.
+     */
+    class WaterSurface
+    {
+        /**
+         * Holds the properties of one wave.
+         */
+        struct Wave
+        {
+            /** The direction the wave travels, in the XZ plane. */
+            real directionX, directionZ;
+
+            /** The height of the wave crests above the base height. */
+            real amplitude;
+
+            /** The wave number, two pi over the wavelength. */
+            real waveNumber;
+
+            /** The angular frequency, from the wave number. */
+            real frequency;
+
+            /** How sharp the crests are, from zero to one. */
+            real steepness;
+
+            /** How far the water moves sideways, from the steepness. */
+            real sideways;
+        };
+
+        /**
+         * Holds the waves, as they were given.
+         */
+        std::vector<Wave> waves;
+
+        /**
+         * Holds the waves adjusted to repeat across the tile. These
+         * are the ones the surface is made of.
+         */
+        std::vector<Wave> tiledWaves;
+
+        /**
+         * Holds the height of the water with no waves.
+         */
+        real baseHeight;
+
+        /**
+         * Holds the time since the surface was created.
+         */
+        real time;
+
+        /**
+         * Holds the length of the side of the cached tile.
+         */
+        real tileSize;
+
+        /**
+         * Holds the number of cached heights along each side of the
+         * tile, or zero if heights aren't cached.
+         */
+        unsigned tileResolution;
+
+        /**
+         * Holds the cached heights, row by row along z.
+         */
+        std::vector<real> tile;
+
+        /**
+         * Rounds the waves so they repeat across the tile.
+         */
+        void fitWavesToTile();
+
+        /**
+         * Refills the cached tile for the current time.
+         */
+        void fillTile();
+
+    public:
+        /**
+         * Creates a flat surface at the given height, with no tile
+         * cache.
+         */
+        WaterSurface(real baseHeight = 0);
+
+        /**
+         * Adds a wave travelling in the given direction in the XZ
+         * plane. The steepness runs from zero, for a sine wave, to
+         * one, where the crests come to a point. The steepnesses of
+         * all the waves should add up to less than one, or the
+         * surface loops over itself and heights are not well
+         * defined.
+         */
+        void addWave(real directionX, real directionZ, real amplitude,
+                     real wavelength, real steepness = 0.5f);
+
+        /**
+         * Removes all the waves.
+         */
+        void clearWaves();
+
+        /**
+         * Sets up the cache of heights, with the given number of
+         * heights along each side of a tile of the given size. A
+         * resolution of zero turns the cache off.
+         */
+        void setTile(real size, unsigned resolution);
+
+        /**
+         * Moves the surface on by the given time.
+         */
+        void update(real duration);
+
+        /**
+         * Returns the time that the surface has been moving for.
+         */
+        real getTime() const;
+
+        /**
+         * Works out the height of the surface above the given point
+         * directly from the waves, without using the cache.
+         */
+        real calculateHeight(real x, real z) const;
+
+        /**
+         * Returns the height of the surface above the given point.
+         */
+        real getHeight(real x, real z) const;
+
+        /**
+         * Finds the height of the surface above each of the given
+         * points, ignoring their heights, and writes them to the
+         * heights array.
+         */
+        void getHeights(const Vector3 *points, unsigned count,
+                        real *heights) const;
+    };
+
+    /**
+     * A force generator that floats a rigid body on a water surface.
+     * The buoyancy is split between several sample points on the
+     * body, so it tilts and rolls with the waves.
+     *
+     * When updated as a batch, the sample points of all the bodies
+     * are looked up on the water surface together.
+     */
+    class WaterBuoyancy : public ForceGenerator
+    {
+        /**
+         * Holds the water the body floats on.
+         */
+        const WaterSurface *water;
+
+        /**
+         * Holds the sample points, in body coordinates.
+         */
+        std::vector<Vector3> samples;
+
+        /**
+         * The depth below the surface at which a sample point is
+         * fully submerged. Sample points this far above the surface
+         * are fully out of the water.
+         */
+        real maxDepth;
+
+        /**
+         * The volume of the object.
+         */
+        real volume;
+
+        /**
+         * The density of the liquid. Pure water has a density of
+         * 1000kg per cubic meter.
+         */
+        real liquidDensity;
+
+        /**
+         * Holds the sample points in world coordinates, for all the
+         * bodies in an update.
+         */
+        std::vector<Vector3> points;
+
+        /**
+         * Holds the height of the water above each point.
+         */
+        std::vector<real> heights;
+
+        /**
+         * Applies the buoyancy at the sample points of the given
+         * body, once the points and heights have been found.
+         */
+        void applyForces(RigidBody *body, const Vector3 *bodyPoints,
+                         const real *bodyHeights) const;
+
+    public:
+        /** Creates a new buoyancy force with the given parameters. */
+        WaterBuoyancy(const WaterSurface *water, real maxDepth,
+                      real volume, real liquidDensity = 1000.0f);
+
+        /**
+         * Adds a sample point, in body coordinates. The volume of
+         * the body is shared equally between its sample points.
+         */
+        void addSample(const Vector3 &point);
+
+        /**
+         * Applies the force to the given rigid body.
+         */
+        virtual void updateForce(RigidBody *body, real duration);
+
+        /**
+         * Applies the force to a batch of bodies, looking up all of
+         * their sample points on the water together.
+         */
+        virtual void updateForces(RigidBody * const *bodies, unsigned count,
+                                  real duration);
+    };
+
+    /**
+     * A force generator that floats a particle on a water surface.
+     */
+    class ParticleWaterBuoyancy : public ParticleForceGenerator
+    {
+        /**
+         * Holds the water the particle floats on.
+         */
+        const WaterSurface *water;
+
+        /**
+         * The maximum submersion depth of the object before
+         * it generates its maximum buoyancy force.
+         */
+        real maxDepth;
+
+        /**
+         * The volume of the object.
+         */
+        real volume;
+
+        /**
+         * The density of the liquid. Pure water has a density of
+         * 1000kg per cubic meter.
+         */
+        real liquidDensity;
+
+        /**
+         * Holds the positions of the particles in an update.
+         */
+        std::vector<Vector3> points;
+
+        /**
+         * Holds the height of the water above each particle.
+         */
+        std::vector<real> heights;
+
+        /**
+         * Applies the buoyancy to a particle at the given depth
+         * below the surface.
+         */
+        void applyForce(Particle *particle, real depth) const;
+
+    public:
+        /** Creates a new buoyancy force with the given parameters. */
+        ParticleWaterBuoyancy(const WaterSurface *water, real maxDepth,
+                              real volume, real liquidDensity = 1000.0f);
+
+        /** Applies the buoyancy force to the given particle. */
+        virtual void updateForce(Particle *particle, real duration);
+
+        /**
+         * Applies the buoyancy force to a batch of particles, looking
+         * them all up on the water together.
+         */
+        virtual void updateForces(Particle * const *particles,
+                                  unsigned count, real duration);
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_WATER_H
@@ -19,10 +19,27 @@
 #ifndef CYCLONE_WORLD_H
 #define CYCLONE_WORLD_H
 
+#include <vector>
 #include "body.h"
 #include "contacts.h"
+#include "collide_fine.h"
+#include "collide_coarse.h"
+#include "handles.h"
+#include "jobs.h"
+#include "damping.h"
+#include "fbatch.h"
 
 namespace cyclone {
+
+    /**
+     * Identifies a rigid body registered with a world.
+     */
+    typedef RegistrationHandle<RigidBody> BodyHandle;
+
+    /**
+     * Identifies a contact generator registered with a world.
+     */
+    typedef RegistrationHandle<ContactGenerator> ContactGenHandle;
     /**
      * The world represents an independent simulation of physics.  It
      * keeps track of a set of rigid bodies, and provides the means to
@@ -38,18 +55,20 @@ namespace cyclone {
         bool calculateIterations;
 
         /**
-         * Holds a single rigid body in a linked list of bodies.
+         * Holds the registered dynamic and kinematic bodies.
          */
-        struct BodyRegistration
-        {
-            RigidBody *body;
-            BodyRegistration * next;
-        };
+        HandleArray<RigidBody> bodies;
 
         /**
-         * Holds the head of the list of registered bodies.
+         * Holds the registered static bodies. These are kept apart so
+         * the per-frame work never has to visit them.
          */
-        BodyRegistration *firstBody;
+        HandleArray<RigidBody> staticBodies;
+
+        /**
+         * Marks the slot of a handle to a static body.
+         */
+        enum { STATIC_HANDLE = 0x80000000u };
 
         /**
          * Holds the resolver for sets of contacts.
@@ -57,53 +76,540 @@ namespace cyclone {
         ContactResolver resolver;
 
         /**
-         * Holds one contact generators in a linked list.
+         * Holds the registered contact generators.
+         */
+        HandleArray<ContactGenerator> contactGenerators;
+
+        /**
+         * Holds the force generators applied to the bodies at the
+         * start of each step.
+         */
+        BatchedForceRegistry registry;
+
+        /**
+         * Holds the contacts for this frame, for filling by the
+         * contact generators. The buffer grows as needed and is
+         * recycled at the start of each frame.
+         */
+        ContactBuffer contacts;
+
+        /**
+         * Holds the spheres whose bodies are checked for tunnelling
+         * each frame.
+         */
+        std::vector<CollisionSphere*> continuousSpheres;
+
+        /**
+         * Holds the boxes that continuously checked spheres are
+         * swept against.
+         */
+        std::vector<const CollisionBox*> continuousBoxes;
+
+        /**
+         * Holds the half-spaces that continuously checked spheres are
+         * swept against.
+         */
+        std::vector<const CollisionPlane*> continuousPlanes;
+
+        /**
+         * Holds the centre of each continuously checked sphere at the
+         * start of the current frame.
+         */
+        std::vector<Vector3> sweepStarts;
+
+        /**
+         * Holds the distance, as a proportion of its radius, that a
+         * sphere has to move in one frame before it is swept.
+         */
+        real continuousThreshold;
+
+        /**
+         * Records the start position of each continuously checked
+         * sphere, ready for sweeping after integration.
+         */
+        void beginContinuousCollision();
+
+        /**
+         * Sweeps each fast moving sphere from its start position to
+         * its integrated position, and moves any that hit an obstacle
+         * back to their first point of impact.
+         */
+        void sweepFastBodies();
+
+        /**
+         * Holds the explosions that are still going off.
+         */
+        std::vector<Explosion*> explosions;
+
+        /**
+         * Holds the bodies sorted by position, so each explosion
+         * only visits the bodies near it.
+         */
+        BodyGrid explosionGrid;
+
+        /**
+         * Holds the bodies found near the current explosion.
+         */
+        std::vector<RigidBody*> explosionTargets;
+
+        /**
+         * Applies each explosion to the bodies within its reach,
+         * moves it on by the given time, and drops it once it has
+         * finished.
+         */
+        void applyExplosions(real duration);
+
+        /**
+         * Holds the job system used to run the simulation across
+         * several threads, or NULL to run it on the calling thread.
+         */
+        JobSystem *jobs;
+
+        /**
+         * Holds a contact buffer for each thread of the job system,
+         * so generators running at the same time don't share one.
+         */
+        std::vector<ContactBuffer*> threadContacts;
+
+        /**
+         * Holds the first contact each generator reported this frame,
+         * when generating in parallel.
+         */
+        std::vector<Contact*> generatorContacts;
+
+        /**
+         * Holds the number of contacts each generator reported this
+         * frame, when generating in parallel.
+         */
+        std::vector<unsigned> generatorCounts;
+
+        /**
+         * Holds the distinct bodies involved in this frame's
+         * contacts, sorted so they can be looked up.
+         */
+        std::vector<RigidBody*> islandBodies;
+
+        /**
+         * Holds the parent of each body in the union-find structure
+         * used to group bodies into islands.
+         */
+        std::vector<unsigned> islandParents;
+
+        /**
+         * Holds the island of each contact.
+         */
+        std::vector<unsigned> contactIslands;
+
+        /**
+         * Holds this frame's contacts, grouped by island.
+         */
+        std::vector<Contact> islandContacts;
+
+        /**
+         * Holds the index of the first contact of each island in the
+         * grouped contacts, with an extra entry for the end of the
+         * last island.
+         */
+        std::vector<unsigned> islandStarts;
+
+        /**
+         * Runs the given contact generators in parallel, each into
+         * the contact buffer of the thread it runs on, then copies
+         * their contacts into the frame's buffer in generator order.
+         */
+        void generateContactsParallel(ContactGenerator * const *generators,
+                                      unsigned count);
+
+        /**
+         * Splits the given contacts into islands of contacts that
+         * share bodies, and resolves the islands in parallel.
+         */
+        void resolveIslands(Contact *contactArray, unsigned numContacts,
+                            real duration);
+
+        /**
+         * Finds the root of the given body's island.
+         */
+        unsigned findIsland(unsigned body);
+
+        /**
+         * Holds the duration of each fixed simulation step, or zero
+         * if each call to runPhysics runs a single step.
+         */
+        real fixedStep;
+
+        /**
+         * Holds the most fixed steps run in one call to runPhysics.
+         */
+        unsigned maxSubsteps;
+
+        /**
+         * Holds the time passed to runPhysics that hasn't yet been
+         * simulated by a fixed step.
+         */
+        real accumulator;
+
+        /**
+         * Holds the forces and torques applied to each body for the
+         * frame, so they can be reapplied for each fixed step.
+         */
+        std::vector<Vector3> frameForces;
+        std::vector<Vector3> frameTorques;
+
+        /**
+         * Holds the drag factors and sleep bias for the current step.
+         */
+        DampingTable dampingTable;
+
+        /**
+         * Holds each body's hints into the damping table, linear then
+         * angular.
+         */
+        std::vector<unsigned> dampingHints;
+
+        /**
+         * Brings the damping table and every body's hints up to date
+         * for a step of the given duration.
          */
-        struct ContactGenRegistration
+        void prepareDamping(real duration);
+
+        /**
+         * True if bodies are put to sleep and woken an island at a
+         * time, rather than one by one.
+         */
+        bool islandSleeping;
+
+        /**
+         * Holds a body in a sleeping island, along with the island's
+         * number.
+         */
+        struct SleepingBody
         {
-            ContactGenerator *gen;
-            ContactGenRegistration *next;
+            RigidBody *body;
+            unsigned island;
+
+            bool operator<(const SleepingBody &other) const
+            {
+                return body < other.body;
+            }
         };
 
         /**
-         * Holds the head of the list of contact generators.
+         * Holds the bodies in sleeping islands, sorted so they can be
+         * looked up.
+         */
+        std::vector<SleepingBody> sleepingBodies;
+
+        /**
+         * Holds whether each island found this step has come to rest.
+         */
+        std::vector<bool> islandResting;
+
+        /**
+         * Holds the number to give the next island put to sleep.
+         */
+        unsigned nextSleepingIsland;
+
+        /**
+         * Holds the contact generators still to be called this frame,
+         * and those being called in the current pass.
+         */
+        std::vector<ContactGenerator*> waitingGenerators;
+        std::vector<ContactGenerator*> activeGenerators;
+
+        /**
+         * Calls the given contact generators, adding their contacts
+         * to the frame's buffer.
+         */
+        void runGenerators(ContactGenerator * const *generators,
+                           unsigned count);
+
+        /**
+         * Returns true if the generator should be called this frame,
+         * i.e. if it might involve an awake body.
+         */
+        static bool isGeneratorAwake(const ContactGenerator *generator);
+
+        /**
+         * Wakes the whole island the given sleeping body belongs to.
+         */
+        void wakeIsland(RigidBody *body);
+
+        /**
+         * Wakes the island of any sleeping body that has been woken
+         * since the last step, by the user or by the resolver.
+         */
+        void wakeDisturbedIslands();
+
+        /**
+         * Wakes the island of any sleeping body that is in contact
+         * with an awake one. Returns true if any island was woken.
+         */
+        bool wakeTouchedIslands(const Contact *contactArray,
+                                unsigned numContacts);
+
+        /**
+         * Removes the contacts that have no dynamic body, as there's
+         * nothing for the resolver to move, and with island sleeping
+         * those that have no awake body, so sleeping bodies aren't
+         * disturbed. Returns the number of contacts left.
          */
-        ContactGenRegistration *firstContactGen;
+        unsigned removeIdleContacts(Contact *contactArray,
+                                    unsigned numContacts) const;
 
         /**
-         * Holds an array of contacts, for filling by the contact
-         * generators.
+         * Groups the awake bodies into islands through the given
+         * contacts, and puts to sleep every island whose bodies have
+         * all come to rest.
          */
-        Contact *contacts;
+        void sleepRestingIslands(const Contact *contactArray,
+                                 unsigned numContacts);
 
         /**
-         * Holds the maximum number of contacts allowed (i.e. the size
-         * of the contacts array).
+         * Runs a single simulation step of the given duration.
          */
-        unsigned maxContacts;
+        void step(real duration);
 
     public:
         /**
-         * Creates a new simulator that can handle up to the given
-         * number of contacts per frame. You can also optionally give
-         * a number of contact-resolution iterations to use. If you
-         * don't give a number of iterations, then four times the
-         * number of detected contacts will be used for each frame.
+         * Creates a new simulator. Contacts are stored in chunks of
+         * the given size, more chunks are added when a frame needs
+         * more contacts, so no contacts are ever dropped. You can
+         * also optionally give a number of contact-resolution
+         * iterations to use. If you don't give a number of
+         * iterations, then four times the number of detected
+         * contacts will be used for each frame.
          */
         World(unsigned maxContacts, unsigned iterations=0);
         ~World();
 
+        /**
+         * Sets the job system used to run the simulation, or NULL
+         * (the default) to run it all on the calling thread. The
+         * world does not take ownership of the job system.
+         *
+         * With a job system, bodies are integrated in parallel and
+         * contact generators are run in parallel, so generators must
+         * not share any state they modify. Contacts are then split
+         * into islands of contacts that share bodies, and each island
+         * is resolved on its own thread. Static and kinematic bodies
+         * don't join islands, as the resolver never changes them, but
+         * dynamic bodies of infinite mass do: scenery should be made
+         * static, or all the contacts touching it will end up in one
+         * island.
+         *
+         * The results don't depend on the number of threads, but do
+         * differ slightly from running without a job system, as
+         * contacts in different islands are no longer resolved
+         * together.
+         */
+        void setJobSystem(JobSystem *jobs);
+
         /**
          * Calls each of the registered contact generators to report
          * their contacts. Returns the number of generated contacts.
+         *
+         * A generator that fills all the space it was given may have
+         * had more contacts to report, so it is called again with a
+         * larger chunk until it has room to spare.
          */
         unsigned generateContacts();
 
         /**
          * Processes all the physics for the world.
+         *
+         * In fixed step mode the duration is added to an accumulator,
+         * and as many whole fixed steps are run as it holds, with any
+         * remainder carried over to the next call. Forces applied
+         * since startFrame are applied in full to each of the steps.
+         * If the duration is too short for a step to run, they are
+         * discarded.
          */
         void runPhysics(real duration);
 
+        /**
+         * Sets whether bodies sleep and wake as islands (off by
+         * default).
+         *
+         * An island is a group of awake bodies joined by contacts,
+         * and it goes to sleep only when all its bodies have come to
+         * rest. A sleeping island is then left out of the simulation
+         * entirely: contact generators whose bodies are all asleep
+         * aren't called, and contacts with no awake body aren't
+         * resolved. When an awake body touches a sleeping one, or a
+         * sleeping body is woken by hand, the whole island wakes.
+         *
+         * For generators to be skipped they must report their bodies
+         * through ContactGenerator::getBodyCount and getBody. Bodies
+         * of infinite mass don't join islands together.
+         */
+        void setIslandSleeping(bool enabled);
+
+        /**
+         * Puts the world into fixed step mode, where runPhysics
+         * always advances the simulation in steps of the given
+         * duration, however long the frame was. Giving a step of zero
+         * turns fixed step mode off again.
+         *
+         * At most maxSubsteps steps are run in one frame. If the
+         * simulation can't keep up, time beyond that is dropped and
+         * the simulation slows down, rather than each frame taking
+         * longer to simulate than the last.
+         */
+        void setFixedTimestep(real step, unsigned maxSubsteps = 4);
+
+        /**
+         * Returns how far, as a proportion of a fixed step, the frame
+         * time has run ahead of the simulation. Rendering each body
+         * with getInterpolatedTransform at this value gives smooth
+         * motion at any frame rate. Without a fixed step this is
+         * always one.
+         */
+        real getInterpolationAlpha() const;
+
+        /**
+         * Registers a rigid body with the world, so it is simulated
+         * each frame. The world does not take ownership of the body.
+         * Returns a handle that can be used to remove it again. The
+         * body's current transform is taken as its previous transform
+         * for interpolation, so it should be positioned first.
+         *
+         * Static bodies are held separately from the others, and are
+         * never touched again after they are added: their derived
+         * data is calculated once, here. A body's type shouldn't
+         * change between static and not while it is registered.
+         */
+        BodyHandle addBody(RigidBody *body);
+
+        /**
+         * Removes a rigid body from the world. Returns false if the
+         * handle is stale, i.e. the body was already removed.
+         */
+        bool removeBody(BodyHandle handle);
+
+        /**
+         * Returns the body with the given handle, or NULL if the
+         * handle is stale.
+         */
+        RigidBody* getBody(BodyHandle handle) const;
+
+        /**
+         * Returns the number of registered dynamic and kinematic
+         * bodies.
+         */
+        unsigned getBodyCount() const;
+
+        /**
+         * Returns the registered dynamic and kinematic bodies as a
+         * contiguous array of getBodyCount() pointers. Removing a
+         * body moves the last body into its place, so the order is
+         * not stable.
+         */
+        RigidBody* const* getBodies() const;
+
+        /**
+         * Returns the number of registered static bodies.
+         */
+        unsigned getStaticBodyCount() const;
+
+        /**
+         * Returns the registered static bodies as a contiguous array
+         * of getStaticBodyCount() pointers.
+         */
+        RigidBody* const* getStaticBodies() const;
+
+        /**
+         * Returns the force registry, whose generators are applied
+         * to their bodies at the start of each step. With a job
+         * system, generators that share no bodies are run in
+         * parallel.
+         */
+        BatchedForceRegistry& getForceRegistry();
+
+        /**
+         * Registers a contact generator with the world, so it is
+         * asked for contacts each frame. The world does not take
+         * ownership of the generator.
+         */
+        ContactGenHandle addContactGenerator(ContactGenerator *generator);
+
+        /**
+         * Removes a contact generator from the world. Returns false
+         * if the handle is stale.
+         */
+        bool removeContactGenerator(ContactGenHandle handle);
+
+        /**
+         * Adds a sphere to the continuous collision pass. Each frame,
+         * if the sphere's body moves further than the continuous
+         * threshold, its path is swept against the continuous
+         * obstacles, and the body is stopped at its first impact so
+         * it can't pass through them. The sphere's body should also
+         * be registered with the world, and contacts for the impact
+         * are still left to the contact generators.
+         */
+        void addContinuousSphere(CollisionSphere *sphere);
+
+        /**
+         * Removes a sphere from the continuous collision pass. If the
+         * sphere was not added, this method has no effect.
+         */
+        void removeContinuousSphere(CollisionSphere *sphere);
+
+        /**
+         * Adds a box that continuously checked spheres can't pass
+         * through. The box's internals should be kept up to date.
+         */
+        void addContinuousObstacle(const CollisionBox *box);
+
+        /**
+         * Adds a half-space that continuously checked spheres can't
+         * pass through.
+         */
+        void addContinuousObstacle(const CollisionPlane *plane);
+
+        /**
+         * Removes a box from the continuous collision obstacles.
+         */
+        void removeContinuousObstacle(const CollisionBox *box);
+
+        /**
+         * Removes a half-space from the continuous collision
+         * obstacles.
+         */
+        void removeContinuousObstacle(const CollisionPlane *plane);
+
+        /**
+         * Sets how far a sphere has to move in one frame, as a
+         * proportion of its radius, before it is swept. Slower
+         * spheres can't tunnel, so they are left to the contact
+         * generators alone. The default is 0.5.
+         */
+        void setContinuousThreshold(real threshold);
+
+        /**
+         * Adds an explosion to the world. Each step, the explosion
+         * is applied to the bodies within its current radius and
+         * moved on, until it has finished, when the world drops it.
+         * The bodies are found with a grid, so an explosion only
+         * costs as much as the bodies it reaches. The world does not
+         * take ownership of the explosion, and an explosion should
+         * be detonated before it is added.
+         */
+        void addExplosion(Explosion *explosion);
+
+        /**
+         * Returns the number of explosions still going off.
+         */
+        unsigned getExplosionCount() const;
+
+        /**
+         * Sets the size of the grid cells used to find the bodies
+         * near explosions. Cells around the size of a typical blast
+         * radius work best. The default is 4.
+         */
+        void setExplosionCellSize(real size);
+
         /**
          * Initialises the world for a simulation frame. This clears
          * the force and torque accumulators for bodies in the